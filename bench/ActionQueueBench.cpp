@@ -0,0 +1,311 @@
+/**
+* @file ActionQueueBench.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+* @section DESCRIPTION
+* 
+* Compares sound action throughput of name keyed, heap allocated requests
+* against plain data requests resolved through a sound table. The request
+* and lookup paths mirror OgreOggSoundManager without needing OpenAL/Ogre.
+*/
+
+#include "LocklessQueue.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace OgreOggSound;
+
+namespace
+{
+	enum Opcode { OP_PLAY, OP_STOP, OP_SET_EFX_PROPERTY };
+
+	struct Sound
+	{
+		unsigned long mPlays;
+		unsigned long mStops;
+		float mRolloff;
+	};
+
+	/** Request layout prior to v1.27
+	 */
+	struct LegacyEfxProperty
+	{
+		std::string mEffectName;
+		std::string mFilterName;
+		float mAirAbsorption;
+		float mRolloff;
+		float mConeHF;
+		unsigned int mSlotID;
+	};
+
+	struct LegacyAction
+	{
+		std::string mSound;
+		Opcode mAction;
+		bool mImmediately;
+		void* mParams;
+	};
+
+	/** Current request layout
+	 */
+	struct EfxProperty
+	{
+		unsigned int mEffect;
+		unsigned int mFilter;
+		float mAirAbsorption;
+		float mRolloff;
+		float mConeHF;
+		unsigned int mSlotID;
+	};
+
+	struct Action
+	{
+		unsigned int mSlot;
+		unsigned int mGeneration;
+		Opcode mAction;
+		bool mImmediately;
+		union
+		{
+			EfxProperty mEfx;
+		} mParams;
+	};
+
+	struct Slot
+	{
+		Sound* mSound;
+		unsigned int mGeneration;
+	};
+
+	std::vector<Sound> gSounds;
+	std::vector<std::string> gNames;
+	std::mutex gSoundMutex;
+
+	// Every 8th command carries parameters, the rest are play/stop
+	inline Opcode opcodeFor(size_t i)
+	{
+		return (i & 7)==7 ? OP_SET_EFX_PROPERTY : ((i & 1) ? OP_STOP : OP_PLAY);
+	}
+
+	void perform(Sound* s, Opcode op, float rolloff)
+	{
+		switch ( op )
+		{
+		case OP_PLAY: ++s->mPlays; break;
+		case OP_STOP: ++s->mStops; break;
+		case OP_SET_EFX_PROPERTY: s->mRolloff = rolloff; break;
+		}
+	}
+
+	void reset()
+	{
+		for ( size_t i=0; i<gSounds.size(); ++i )
+		{
+			gSounds[i].mPlays = 0;
+			gSounds[i].mStops = 0;
+			gSounds[i].mRolloff = 0.f;
+		}
+	}
+
+	unsigned long checksum()
+	{
+		unsigned long total = 0;
+		for ( size_t i=0; i<gSounds.size(); ++i )
+			total += gSounds[i].mPlays + gSounds[i].mStops + (gSounds[i].mRolloff!=0.f ? 1 : 0);
+		return total;
+	}
+
+	/** String keyed requests with heap parameters, resolved by hasSound() + getSound()
+	 */
+	double benchLegacy(size_t capacity, size_t count)
+	{
+		std::map<std::string, Sound*> soundMap;
+		for ( size_t i=0; i<gSounds.size(); ++i )
+			soundMap[gNames[i]] = &gSounds[i];
+
+		LocklessQueue<LegacyAction> queue(capacity);
+		reset();
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		std::thread consumer([&]()
+		{
+			LegacyAction act;
+			for ( size_t i=0; i<count; )
+			{
+				if ( !queue.pop(act) ) { std::this_thread::yield(); continue; }
+
+				Sound* s = 0;
+				{
+					std::lock_guard<std::mutex> lock(gSoundMutex);
+					if ( soundMap.find(act.mSound)!=soundMap.end() )
+						s = soundMap.find(act.mSound)->second;
+				}
+
+				LegacyEfxProperty* e = static_cast<LegacyEfxProperty*>(act.mParams);
+				if ( s ) perform(s, act.mAction, e ? e->mRolloff : 0.f);
+				delete e;
+				++i;
+			}
+		});
+
+		for ( size_t i=0; i<count; )
+		{
+			LegacyAction action;
+			action.mSound = gNames[i % gNames.size()];
+			action.mAction = opcodeFor(i);
+			action.mImmediately = false;
+			action.mParams = 0;
+			if ( action.mAction==OP_SET_EFX_PROPERTY )
+			{
+				LegacyEfxProperty* e = new LegacyEfxProperty;
+				e->mEffectName = "";
+				e->mFilterName = "";
+				e->mSlotID = 255;
+				e->mAirAbsorption = 0.f;
+				e->mRolloff = 1.f;
+				e->mConeHF = 0.f;
+				action.mParams = e;
+			}
+
+			while ( !queue.push(action) ) std::this_thread::yield();
+			++i;
+		}
+
+		consumer.join();
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return count / elapsed.count();
+	}
+
+	/** Plain data requests resolved through the sound table
+	 */
+	double benchSlots(size_t capacity, size_t count)
+	{
+		std::vector<Slot> slots(gSounds.size());
+		for ( size_t i=0; i<gSounds.size(); ++i )
+		{
+			slots[i].mSound = &gSounds[i];
+			slots[i].mGeneration = 0;
+		}
+
+		LocklessQueue<Action> queue(capacity);
+		reset();
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		std::thread consumer([&]()
+		{
+			Action act;
+			for ( size_t i=0; i<count; )
+			{
+				if ( !queue.pop(act) ) { std::this_thread::yield(); continue; }
+
+				Sound* s = 0;
+				{
+					std::lock_guard<std::mutex> lock(gSoundMutex);
+					if ( act.mSlot<slots.size() && slots[act.mSlot].mGeneration==act.mGeneration )
+						s = slots[act.mSlot].mSound;
+				}
+
+				if ( s ) perform(s, act.mAction, act.mParams.mEfx.mRolloff);
+				++i;
+			}
+		});
+
+		for ( size_t i=0; i<count; )
+		{
+			Action action;
+			action.mSlot = static_cast<unsigned int>(i % slots.size());
+			action.mGeneration = 0;
+			action.mAction = opcodeFor(i);
+			action.mImmediately = false;
+			if ( action.mAction==OP_SET_EFX_PROPERTY )
+			{
+				EfxProperty& e = action.mParams.mEfx;
+				e.mEffect = 0;
+				e.mFilter = 0;
+				e.mSlotID = 255;
+				e.mAirAbsorption = 0.f;
+				e.mRolloff = 1.f;
+				e.mConeHF = 0.f;
+			}
+
+			while ( !queue.push(action) ) std::this_thread::yield();
+			++i;
+		}
+
+		consumer.join();
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return count / elapsed.count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = argc>1 ? static_cast<size_t>(std::strtoull(argv[1], 0, 10)) : 5000000;
+	size_t numSounds = argc>2 ? static_cast<size_t>(std::strtoull(argv[2], 0, 10)) : 1000;
+	const size_t capacity = 100;
+
+	if ( !numSounds ) numSounds = 1;
+
+	gSounds.resize(numSounds);
+	for ( size_t i=0; i<numSounds; ++i )
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "GameSound_%04lu", (unsigned long)i);
+		gNames.push_back(name);
+	}
+
+	std::printf("Sound actions: %lu commands, %lu sounds, queue size %lu\n", (unsigned long)count, (unsigned long)numSounds, (unsigned long)capacity);
+
+	double legacy = benchLegacy(capacity, count);
+	unsigned long legacySum = checksum();
+	std::printf("  name + heap params : %12.0f commands/sec\n", legacy);
+
+	double slots = benchSlots(capacity, count);
+	unsigned long slotsSum = checksum();
+	std::printf("  slot + inline POD  : %12.0f commands/sec (%.2fx)\n", slots, slots / legacy);
+
+	// Both paths must have performed the same work
+	if ( legacySum!=slotsSum )
+	{
+		std::fprintf(stderr, "checksum mismatch!\n");
+		return 1;
+	}
+
+	return 0;
+}
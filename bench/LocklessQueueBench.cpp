@@ -0,0 +1,144 @@
+/**
+* @file LocklessQueueBench.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+* @section DESCRIPTION
+* 
+* Measures LocklessQueue throughput between a producer and consumer thread
+*/
+
+#include "LocklessQueue.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using namespace OgreOggSound;
+
+namespace
+{
+	/** Pushes/pops count items one at a time, returns ops/sec.
+	 */
+	double benchSingle(size_t capacity, size_t count)
+	{
+		LocklessQueue<size_t> queue(capacity);
+		size_t checksum = 0;
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		std::thread consumer([&]()
+		{
+			size_t item;
+			for ( size_t i=0; i<count; )
+			{
+				if ( queue.pop(item) ) { checksum += item; ++i; }
+				else std::this_thread::yield();
+			}
+		});
+
+		for ( size_t i=0; i<count; )
+		{
+			if ( queue.push(i) ) ++i;
+			else std::this_thread::yield();
+		}
+
+		consumer.join();
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		// Every item must arrive exactly once
+		if ( checksum != (count * (count - 1)) / 2 )
+		{
+			std::fprintf(stderr, "checksum mismatch!\n");
+			std::exit(1);
+		}
+
+		return count / elapsed.count();
+	}
+
+	/** Pushes/pops count items in batches, returns ops/sec.
+	 */
+	double benchBatched(size_t capacity, size_t count, size_t batch)
+	{
+		LocklessQueue<size_t> queue(capacity);
+		size_t checksum = 0;
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		std::thread consumer([&]()
+		{
+			size_t items[256];
+			for ( size_t i=0; i<count; )
+			{
+				size_t n = queue.pop_n(items, batch);
+				if ( !n ) { std::this_thread::yield(); continue; }
+				for ( size_t j=0; j<n; ++j ) checksum += items[j];
+				i += n;
+			}
+		});
+
+		size_t items[256];
+		for ( size_t i=0; i<count; )
+		{
+			size_t n = batch < (count - i) ? batch : (count - i);
+			for ( size_t j=0; j<n; ++j ) items[j] = i + j;
+			size_t pushed = queue.push_n(items, n);
+			if ( !pushed ) std::this_thread::yield();
+			i += pushed;
+		}
+
+		consumer.join();
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		if ( checksum != (count * (count - 1)) / 2 )
+		{
+			std::fprintf(stderr, "checksum mismatch!\n");
+			std::exit(1);
+		}
+
+		return count / elapsed.count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = argc>1 ? static_cast<size_t>(std::strtoull(argv[1], 0, 10)) : 20000000;
+	const size_t capacity = 1024;
+
+	std::printf("LocklessQueue: %lu items, capacity %lu\n", (unsigned long)count, (unsigned long)capacity);
+	std::printf("  push/pop      : %12.0f ops/sec\n", benchSingle(capacity, count));
+
+	const size_t batches[] = { 8, 32, 128 };
+	for ( size_t i=0; i<sizeof(batches)/sizeof(batches[0]); ++i )
+		std::printf("  push_n/pop_n %3lu: %12.0f ops/sec\n", (unsigned long)batches[i], benchBatched(capacity, count, batches[i]));
+
+	return 0;
+}
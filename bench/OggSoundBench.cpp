@@ -0,0 +1,857 @@
+/**
+* @file OggSoundBench.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+* @section DESCRIPTION
+* 
+* Runs the plugin headless against OpenAL Soft's null backend and writes the
+* results as JSON, for catching performance regressions on build machines.
+* Test audio is generated at startup, Ogg scenarios need libvorbisenc or a
+* file passed with --ogg.
+*
+* The IMA4 encoder is checked against a reference decoder first, a failed
+* check exits with an error.
+*
+* Usage: oggsound_bench [--json file] [--ogg file] [--device name] [--seconds n]
+*/
+
+#include "OgreOggSound.h"
+#include "OgreOggSoundAdpcm.h"
+#include "OgreOggSoundKernels.h"
+
+#include <OgreRoot.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreSceneManager.h>
+
+#include <vorbis/vorbisfile.h>
+#ifdef HAVE_VORBISENC
+#	include <vorbis/vorbisenc.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace OgreOggSound;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const char* WAV_MONO_FILE = "oggsound_bench_mono.wav";
+	const char* WAV_STEREO_FILE = "oggsound_bench_stereo.wav";
+	const char* OGG_FILE = "oggsound_bench_stereo.ogg";
+
+	const int SAMPLE_RATE = 44100;
+	const unsigned int NUM_SOURCES = 64;
+
+	//! Named metrics of a single scenario
+	struct Result
+	{
+		std::string mName;
+		std::vector< std::pair<std::string, double> > mMetrics;
+
+		Result(const std::string& name) : mName(name) {}
+		void add(const std::string& metric, double value) { mMetrics.push_back(std::make_pair(metric, value)); }
+	};
+
+	inline double secondsSince(const Clock::time_point& start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	/** Generates a sweep with a little noise so the encoder has something to do
+	 */
+	std::vector<short> generateSignal(int channels, float seconds)
+	{
+		const size_t frames = static_cast<size_t>(seconds * SAMPLE_RATE);
+		std::vector<short> pcm(frames * channels);
+		unsigned int seed = 12345;
+		double phase = 0.0;
+		for ( size_t i=0; i<frames; ++i )
+		{
+			const double freq = 110.0 + 880.0 * (static_cast<double>(i) / frames);
+			phase += 2.0 * 3.14159265358979 * freq / SAMPLE_RATE;
+			for ( int c=0; c<channels; ++c )
+			{
+				seed = seed * 1103515245 + 12345;
+				const double noise = ((seed >> 16) & 0x7FFF) / 32768.0 - 0.5;
+				pcm[i * channels + c] = static_cast<short>((std::sin(phase + c) * 0.5 + noise * 0.1) * 32767.0);
+			}
+		}
+		return pcm;
+	}
+
+	void writeLE(FILE* f, unsigned int value, int bytes)
+	{
+		for ( int i=0; i<bytes; ++i ) std::fputc((value >> (i * 8)) & 0xFF, f);
+	}
+
+	bool writeWav(const char* file, const std::vector<short>& pcm, int channels)
+	{
+		FILE* f = std::fopen(file, "wb");
+		if ( !f ) return false;
+
+		const unsigned int dataSize = static_cast<unsigned int>(pcm.size() * sizeof(short));
+		std::fwrite("RIFF", 1, 4, f);
+		writeLE(f, 36 + dataSize, 4);
+		std::fwrite("WAVEfmt ", 1, 8, f);
+		writeLE(f, 16, 4);
+		writeLE(f, 1, 2);
+		writeLE(f, channels, 2);
+		writeLE(f, SAMPLE_RATE, 4);
+		writeLE(f, SAMPLE_RATE * channels * 2, 4);
+		writeLE(f, channels * 2, 2);
+		writeLE(f, 16, 2);
+		std::fwrite("data", 1, 4, f);
+		writeLE(f, dataSize, 4);
+		for ( size_t i=0; i<pcm.size(); ++i ) writeLE(f, static_cast<unsigned short>(pcm[i]), 2);
+
+		return std::fclose(f)==0;
+	}
+
+#ifdef HAVE_VORBISENC
+	void writePages(FILE* f, ogg_stream_state& os, bool flush)
+	{
+		ogg_page og;
+		while ( flush ? ogg_stream_flush(&os, &og) : ogg_stream_pageout(&os, &og) )
+		{
+			std::fwrite(og.header, 1, og.header_len, f);
+			std::fwrite(og.body, 1, og.body_len, f);
+		}
+	}
+
+	bool writeOgg(const char* file, const std::vector<short>& pcm, int channels)
+	{
+		vorbis_info vi;
+		vorbis_info_init(&vi);
+		if ( vorbis_encode_init_vbr(&vi, channels, SAMPLE_RATE, 0.4f)!=0 )
+		{
+			vorbis_info_clear(&vi);
+			return false;
+		}
+
+		FILE* f = std::fopen(file, "wb");
+		if ( !f )
+		{
+			vorbis_info_clear(&vi);
+			return false;
+		}
+
+		vorbis_comment vc;
+		vorbis_dsp_state vd;
+		vorbis_block vb;
+		ogg_stream_state os;
+		vorbis_comment_init(&vc);
+		vorbis_analysis_init(&vd, &vi);
+		vorbis_block_init(&vd, &vb);
+		ogg_stream_init(&os, 1);
+
+		// Headers get pages of their own
+		ogg_packet header, comments, codebooks;
+		vorbis_analysis_headerout(&vd, &vc, &header, &comments, &codebooks);
+		ogg_stream_packetin(&os, &header);
+		ogg_stream_packetin(&os, &comments);
+		ogg_stream_packetin(&os, &codebooks);
+		writePages(f, os, true);
+
+		const size_t frames = pcm.size() / channels;
+		size_t pos = 0;
+		bool eos = false;
+		while ( !eos )
+		{
+			const size_t count = std::min<size_t>(1024, frames - pos);
+			if ( count==0 )
+			{
+				vorbis_analysis_wrote(&vd, 0);
+				eos = true;
+			}
+			else
+			{
+				float** buffer = vorbis_analysis_buffer(&vd, static_cast<int>(count));
+				for ( size_t i=0; i<count; ++i )
+					for ( int c=0; c<channels; ++c )
+						buffer[c][i] = pcm[(pos + i) * channels + c] / 32768.f;
+				vorbis_analysis_wrote(&vd, static_cast<int>(count));
+				pos += count;
+			}
+
+			while ( vorbis_analysis_blockout(&vd, &vb)==1 )
+			{
+				vorbis_analysis(&vb, 0);
+				vorbis_bitrate_addblock(&vb);
+
+				ogg_packet op;
+				while ( vorbis_bitrate_flushpacket(&vd, &op) )
+				{
+					ogg_stream_packetin(&os, &op);
+					writePages(f, os, false);
+				}
+			}
+		}
+		writePages(f, os, true);
+
+		ogg_stream_clear(&os);
+		vorbis_block_clear(&vb);
+		vorbis_dsp_clear(&vd);
+		vorbis_comment_clear(&vc);
+		vorbis_info_clear(&vi);
+
+		return std::fclose(f)==0;
+	}
+#endif
+
+	/** Size of the decoded PCM of an Ogg file (16 bit)
+	 */
+	double oggPCMBytes(const std::string& file)
+	{
+		OggVorbis_File vf;
+		if ( ov_fopen(file.c_str(), &vf)!=0 ) return 0.0;
+		const double bytes = static_cast<double>(ov_pcm_total(&vf, -1)) * ov_info(&vf, -1)->channels * 2.0;
+		ov_clear(&vf);
+		return bytes;
+	}
+
+	Ogre::String soundName(const char* prefix, size_t i)
+	{
+		char name[64];
+		std::snprintf(name, sizeof(name), "%s_%05lu", prefix, (unsigned long)i);
+		return name;
+	}
+
+	/** Runs the manager at 60Hz of wall clock time
+	 */
+	void runFrames(OgreOggSoundManager& mgr, double seconds, double* maxUpdate=0, double* totalUpdate=0, unsigned long* frames=0)
+	{
+		const std::chrono::microseconds frame(16667);
+		Clock::time_point start = Clock::now();
+		Clock::time_point next = start;
+		while ( secondsSince(start)<seconds )
+		{
+			Clock::time_point t = Clock::now();
+			mgr.update(1.f / 60.f);
+			const double elapsed = secondsSince(t);
+			if ( maxUpdate ) *maxUpdate = std::max(*maxUpdate, elapsed);
+			if ( totalUpdate ) *totalUpdate += elapsed;
+			if ( frames ) ++*frames;
+
+			next += frame;
+			std::this_thread::sleep_until(next);
+		}
+	}
+
+	/** Creates and destroys many static sounds sharing one buffer
+	 */
+	Result benchCreateDestroy(OgreOggSoundManager& mgr, size_t count)
+	{
+		std::vector<OgreOggISound*> sounds;
+		sounds.reserve(count);
+
+		Clock::time_point start = Clock::now();
+		for ( size_t i=0; i<count; ++i )
+			sounds.push_back(mgr.createSound(soundName("create", i), WAV_MONO_FILE, false, false, false, 0, true));
+		const double create = secondsSince(start);
+
+		start = Clock::now();
+		for ( size_t i=0; i<count; ++i )
+			mgr.destroySound(sounds[i]);
+		const double destroy = secondsSince(start);
+
+		Result r("create_destroy");
+		r.add("sounds", static_cast<double>(count));
+		r.add("create_per_sec", count / create);
+		r.add("destroy_per_sec", count / destroy);
+		r.add("create_us", create * 1e6 / count);
+		r.add("destroy_us", destroy * 1e6 / count);
+		return r;
+	}
+
+	/** Loads a static Ogg sound repeatedly, releasing its buffer each time
+	 */
+	Result benchOggDecode(OgreOggSoundManager& mgr, const std::string& file)
+	{
+		const double bytes = oggPCMBytes(file);
+		size_t iterations = 0;
+		double total = 0.0;
+		double fastest = 0.0;
+
+		mgr.setSharedBufferBudget(0);
+		while ( iterations<3 || (total<2.0 && iterations<100) )
+		{
+			Clock::time_point start = Clock::now();
+			OgreOggISound* sound = mgr.createSound(soundName("decode", iterations), file, false, false, false, 0, true);
+			const double elapsed = secondsSince(start);
+			mgr.destroySound(sound);
+
+			fastest = iterations ? std::min(fastest, elapsed) : elapsed;
+			total += elapsed;
+			++iterations;
+		}
+
+		Result r("ogg_decode");
+		r.add("iterations", static_cast<double>(iterations));
+		r.add("pcm_bytes", bytes);
+		r.add("mb_per_sec", bytes * iterations / total / (1024.0 * 1024.0));
+		r.add("best_mb_per_sec", bytes / fastest / (1024.0 * 1024.0));
+		r.add("load_ms", total * 1e3 / iterations);
+		return r;
+	}
+
+	/** Decodes an Ogg file through both the 16-bit and float paths
+	 */
+	Result benchOggDecodeFloat(OgreOggSoundManager& mgr, const std::string& file)
+	{
+		Result r("ogg_decode_float");
+		const int FRAMES = 4096;
+		std::vector<float> out(FRAMES * 8);
+
+		// Codec only, ov_read() against ov_read_float() plus interleaving
+		for ( int pass=0; pass<2; ++pass )
+		{
+			const bool useFloat = ( pass==1 );
+			size_t iterations = 0;
+			double total = 0.0;
+			double frames = 0.0;
+
+			while ( iterations<3 || (total<2.0 && iterations<100) )
+			{
+				OggVorbis_File vf;
+				if ( ov_fopen(file.c_str(), &vf)!=0 ) return r;
+				const int channels = ov_info(&vf, -1)->channels;
+				int section = 0;
+				long n = 0;
+
+				Clock::time_point start = Clock::now();
+				do
+				{
+					if ( useFloat )
+					{
+						float** pcm = 0;
+						n = ov_read_float(&vf, &pcm, FRAMES, &section);
+						if ( n>0 ) 
+						{
+							OgreOggSoundKernels::interleaveFloat(pcm, channels, static_cast<size_t>(n), &out[0]);
+							frames += n;
+						}
+					}
+					else
+					{
+						n = ov_read(&vf, reinterpret_cast<char*>(&out[0]), FRAMES * channels * 2, 0, 2, 1, &section);
+						if ( n>0 ) frames += n / (channels * 2);
+					}
+				}
+				while ( n>0 || n==OV_HOLE );
+				total += secondsSince(start);
+
+				ov_clear(&vf);
+				++iterations;
+			}
+
+			r.add(useFloat ? "float_mframes_per_sec" : "int16_mframes_per_sec", frames / total / 1e6);
+		}
+
+		// Whole static loads, needs AL_EXT_FLOAT32
+		r.add("float32_supported", mgr.hasFloat32Support() ? 1.0 : 0.0);
+		if ( mgr.hasFloat32Support() )
+		{
+			mgr.setSharedBufferBudget(0);
+			for ( int pass=0; pass<2; ++pass )
+			{
+				mgr.setFloatDecoding(pass==1);
+				size_t iterations = 0;
+				double total = 0.0;
+				while ( iterations<3 || (total<2.0 && iterations<100) )
+				{
+					Clock::time_point start = Clock::now();
+					OgreOggISound* sound = mgr.createSound(soundName("decode_float", iterations), file, false, false, false, 0, true);
+					total += secondsSince(start);
+					mgr.destroySound(sound);
+					++iterations;
+				}
+				r.add(pass ? "float_load_ms" : "int16_load_ms", total * 1e3 / iterations);
+			}
+			mgr.setFloatDecoding(false);
+		}
+
+		return r;
+	}
+
+	/** Plays looping streams in real time and reads the refill statistics
+	 */
+	Result benchStreamRefill(OgreOggSoundManager& mgr, const std::string& file, size_t count, double seconds)
+	{
+		std::vector<OgreOggISound*> sounds;
+		for ( size_t i=0; i<count; ++i )
+		{
+			OgreOggISound* sound = mgr.createSound(soundName("stream", i), file, true, true, true, 0, true);
+			sound->disable3D(true);
+			sound->play(true);
+			sounds.push_back(sound);
+		}
+
+		const SoundStatistics before = mgr.getStatistics();
+		double maxUpdate = 0.0, totalUpdate = 0.0;
+		unsigned long frames = 0;
+		runFrames(mgr, seconds, &maxUpdate, &totalUpdate, &frames);
+		const SoundStatistics after = mgr.getStatistics();
+
+		for ( size_t i=0; i<count; ++i )
+			mgr.destroySound(sounds[i]);
+
+		Result r("stream_refill");
+		r.add("streams", static_cast<double>(count));
+		r.add("seconds", seconds);
+		r.add("refills", static_cast<double>(after.mStreamRefills - before.mStreamRefills));
+		r.add("underruns", static_cast<double>(after.mStreamUnderruns - before.mStreamUnderruns));
+		r.add("refill_ms", after.mRefillLatency);
+		r.add("max_refill_ms", after.mMaxRefillLatency);
+		r.add("decode_mb_per_sec", after.mDecodeBytesPerSecond / (1024.0 * 1024.0));
+		r.add("min_queue_depth", after.mMinQueueDepth);
+		r.add("update_us", frames ? totalUpdate * 1e6 / frames : 0.0);
+		r.add("max_update_us", maxUpdate * 1e6);
+		return r;
+	}
+
+	/** Plays more emitters than there are sources whilst the listener moves
+	 */
+	Result benchVoiceStealing(OgreOggSoundManager& mgr, size_t count, double seconds)
+	{
+		std::vector<OgreOggISound*> sounds;
+		unsigned int seed = 4321;
+		for ( size_t i=0; i<count; ++i )
+		{
+			OgreOggISound* sound = mgr.createSound(soundName("emitter", i), WAV_MONO_FILE, false, true, false, 0, true);
+			seed = seed * 1103515245 + 12345;
+			const float x = ((seed >> 8) % 2000) * 0.1f - 100.f;
+			seed = seed * 1103515245 + 12345;
+			const float z = ((seed >> 8) % 2000) * 0.1f - 100.f;
+			sound->setPosition(x, 0.f, z);
+			sound->setPriority(static_cast<Ogre::uint8>(i % 4));
+			sounds.push_back(sound);
+		}
+
+		const SoundStatistics before = mgr.getStatistics();
+		Clock::time_point start = Clock::now();
+		for ( size_t i=0; i<count; ++i )
+			sounds[i]->play(true);
+		const double play = secondsSince(start);
+
+		// Circle the listener so sources keep changing hands
+		OgreOggListener* listener = mgr.getListener();
+		const std::chrono::microseconds frame(16667);
+		Clock::time_point next = Clock::now();
+		double maxUpdate = 0.0, totalUpdate = 0.0;
+		unsigned long frames = 0;
+		start = Clock::now();
+		while ( secondsSince(start)<seconds )
+		{
+			const float angle = frames * 0.02f;
+			listener->setPosition(std::cos(angle) * 80.f, 0.f, std::sin(angle) * 80.f);
+
+			Clock::time_point t = Clock::now();
+			mgr.update(1.f / 60.f);
+			const double elapsed = secondsSince(t);
+			maxUpdate = std::max(maxUpdate, elapsed);
+			totalUpdate += elapsed;
+			++frames;
+
+			next += frame;
+			std::this_thread::sleep_until(next);
+		}
+		const SoundStatistics after = mgr.getStatistics();
+
+		for ( size_t i=0; i<count; ++i )
+			mgr.destroySound(sounds[i]);
+		listener->setPosition(0.f, 0.f, 0.f);
+
+		Result r("voice_stealing");
+		r.add("emitters", static_cast<double>(count));
+		r.add("sources", after.mSourcesTotal);
+		r.add("play_us", play * 1e6 / count);
+		r.add("sources_stolen", static_cast<double>(after.mSourcesStolen - before.mSourcesStolen));
+		r.add("virtual_sounds", after.mVirtualSounds);
+		r.add("update_us", frames ? totalUpdate * 1e6 / frames : 0.0);
+		r.add("max_update_us", maxUpdate * 1e6);
+		return r;
+	}
+
+	/** Issues play/stop requests as fast as possible
+	 */
+	Result benchActionQueue(OgreOggSoundManager& mgr, size_t count)
+	{
+		const size_t numSounds = 32;
+		std::vector<OgreOggISound*> sounds;
+		for ( size_t i=0; i<numSounds; ++i )
+		{
+			OgreOggISound* sound = mgr.createSound(soundName("action", i), WAV_MONO_FILE, false, false, false, 0, true);
+			sound->disable3D(true);
+			sounds.push_back(sound);
+		}
+
+		const SoundStatistics before = mgr.getStatistics();
+		Clock::time_point start = Clock::now();
+		for ( size_t i=0; i<count; ++i )
+		{
+			OgreOggISound* sound = sounds[i % numSounds];
+			if ( (i / numSounds) & 1 ) sound->stop(); else sound->play();
+
+			// Let the queue drain as a game would between frames
+			if ( (i % 1024)==1023 ) mgr.update(0.f);
+		}
+		const double elapsed = secondsSince(start);
+
+		// Drain before tearing down
+		runFrames(mgr, 0.1);
+		const SoundStatistics after = mgr.getStatistics();
+
+		for ( size_t i=0; i<numSounds; ++i )
+			mgr.destroySound(sounds[i]);
+
+		Result r("action_queue");
+		r.add("requests", static_cast<double>(count));
+		r.add("requests_per_sec", count / elapsed);
+		r.add("high_water", after.mActionQueueHighWater);
+		r.add("dropped", static_cast<double>(after.mActionsDropped - before.mActionsDropped));
+		return r;
+	}
+
+	/** Moves the listener every frame with nothing playing
+	 */
+	Result benchListenerUpdate(OgreOggSoundManager& mgr, size_t count)
+	{
+		OgreOggListener* listener = mgr.getListener();
+		unsigned long alCalls = 0;
+
+		Clock::time_point start = Clock::now();
+		for ( size_t i=0; i<count; ++i )
+		{
+			const float angle = i * 0.01f;
+			listener->setPosition(std::cos(angle) * 10.f, 1.f, std::sin(angle) * 10.f);
+			listener->setOrientation(Ogre::Quaternion(Ogre::Radian(angle), Ogre::Vector3::UNIT_Y));
+			listener->setVelocity(1.f, 0.f, 0.f);
+			mgr.update(1.f / 60.f);
+			alCalls += mgr.getALCallsPerFrame();
+		}
+		const double elapsed = secondsSince(start);
+
+		Result r("listener_update");
+		r.add("frames", static_cast<double>(count));
+		r.add("frame_us", elapsed * 1e6 / count);
+		r.add("al_calls_per_frame", static_cast<double>(alCalls) / count);
+		return r;
+	}
+
+	//! Reference IMA ADPCM step sizes
+	const int IMA_STEPS[89] =
+	{
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+		50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+		253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+		1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+		3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+		12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+
+	//! Reference IMA ADPCM step index adjustments
+	const int IMA_INDEX_ADJUST[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+	/** Decodes IMA4 blocks as OpenAL does, independently of the encoder
+	 */
+	std::vector<short> decodeIma4(const std::vector<char>& data, size_t frames, int channels, int samplesPerBlock)
+	{
+		const size_t blockSize = static_cast<size_t>(channels) * (4 + (samplesPerBlock - 1) / 2);
+		std::vector<short> pcm(frames * channels);
+		for ( size_t b=0; b * blockSize<data.size(); ++b )
+		{
+			const unsigned char* block = reinterpret_cast<const unsigned char*>(&data[b * blockSize]);
+			const size_t first = b * samplesPerBlock;
+			for ( int c=0; c<channels; ++c )
+			{
+				int predictor = static_cast<short>(block[c * 4] | (block[c * 4 + 1] << 8));
+				int index = std::min<int>(block[c * 4 + 2], 88);
+				if ( first<frames ) pcm[first * channels + c] = static_cast<short>(predictor);
+
+				const unsigned char* nibbles = block + channels * 4 + c * 4;
+				for ( int i=1; i<samplesPerBlock; ++i )
+				{
+					const int n = i - 1;
+					const unsigned char byte = nibbles[(n / 8) * channels * 4 + (n % 8) / 2];
+					const int nibble = (n & 1) ? (byte >> 4) : (byte & 0x0F);
+
+					const int step = IMA_STEPS[index];
+					int diff = step >> 3;
+					if ( nibble & 4 ) diff += step;
+					if ( nibble & 2 ) diff += step >> 1;
+					if ( nibble & 1 ) diff += step >> 2;
+					predictor = std::max(-32768, std::min(32767, (nibble & 8) ? predictor - diff : predictor + diff));
+					index = std::max(0, std::min(88, index + IMA_INDEX_ADJUST[nibble & 7]));
+
+					if ( first + i<frames ) pcm[(first + i) * channels + c] = static_cast<short>(predictor);
+				}
+			}
+		}
+		return pcm;
+	}
+
+	/** Round trips a sine through the IMA4 encoder
+	@remarks
+		Covers the block sizes used with and without AL_SOFT_block_alignment,
+		a frame count which leaves a partial last block, and both channel layouts.
+	 */
+	Result checkIma4RoundTrip(bool& passed)
+	{
+		const int blockSamples[] = { IMA4_DEFAULT_BLOCK_SAMPLES, 1017 };
+		const size_t frames = SAMPLE_RATE / 2 + 123;
+		double minSNR = 1e9;
+		int maxError = 0;
+		passed = true;
+
+		for ( int channels=1; channels<=2; ++channels )
+		{
+			std::vector<short> pcm(frames * channels);
+			for ( size_t i=0; i<frames; ++i )
+				for ( int c=0; c<channels; ++c )
+					pcm[i * channels + c] = static_cast<short>(std::sin(2.0 * 3.14159265358979 * (440.0 * (c + 1)) * i / SAMPLE_RATE) * 16000.0);
+
+			for ( size_t s=0; s<sizeof(blockSamples)/sizeof(blockSamples[0]); ++s )
+			{
+				const int samplesPerBlock = blockSamples[s];
+
+				// OpenAL derives the block size from the sample count, which must be one more than a multiple of 8
+				const size_t blockSize = OgreOggSoundAdpcm::getIma4BlockSize(channels, samplesPerBlock);
+				const size_t blocks = (frames + samplesPerBlock - 1) / samplesPerBlock;
+				std::vector<char> data;
+				const size_t written = OgreOggSoundAdpcm::encodeIma4(&pcm[0], frames, channels, samplesPerBlock, data);
+				if ( (samplesPerBlock - 1) % 8!=0 ||
+					blockSize!=static_cast<size_t>(channels) * (4 + (samplesPerBlock - 1) / 2) ||
+					written!=blocks || data.size()!=blocks * blockSize )
+				{
+					std::fprintf(stderr, "IMA4 block layout mismatch: %d channel(s), %d samples per block\n", channels, samplesPerBlock);
+					passed = false;
+					continue;
+				}
+
+				const std::vector<short> decoded = decodeIma4(data, frames, channels, samplesPerBlock);
+				double signal = 0.0, noise = 0.0;
+				for ( size_t i=0; i<pcm.size(); ++i )
+				{
+					const int error = std::abs(decoded[i] - pcm[i]);
+					maxError = std::max(maxError, error);
+					signal += static_cast<double>(pcm[i]) * pcm[i];
+					noise += static_cast<double>(error) * error;
+				}
+				const double snr = 10.0 * std::log10(signal / std::max(noise, 1.0));
+				minSNR = std::min(minSNR, snr);
+
+				// 4-bit ADPCM of a clean tone comfortably clears this
+				if ( snr<30.0 )
+				{
+					std::fprintf(stderr, "IMA4 round trip too noisy: %d channel(s), %d samples per block, %.1fdB\n", channels, samplesPerBlock, snr);
+					passed = false;
+				}
+			}
+		}
+
+		Result r("ima4_roundtrip");
+		r.add("min_snr_db", minSNR);
+		r.add("max_error", maxError);
+		r.add("passed", passed ? 1.0 : 0.0);
+		return r;
+	}
+
+	void writeJSON(FILE* f, const Ogre::String& device, const std::vector<Result>& results, const std::vector<std::string>& skipped)
+	{
+		std::fprintf(f, "{\n");
+		std::fprintf(f, "  \"benchmark\": \"oggsound_bench\",\n");
+		std::fprintf(f, "  \"version\": \"%s\",\n", OgreOggSoundManager::OGREOGGSOUND_VERSION_STRING.c_str());
+		std::fprintf(f, "  \"threaded\": %s,\n", OGGSOUND_THREADED ? "true" : "false");
+		std::fprintf(f, "  \"device\": \"%s\",\n", device.c_str());
+		std::fprintf(f, "  \"results\": {");
+		for ( size_t i=0; i<results.size(); ++i )
+		{
+			std::fprintf(f, "%s\n    \"%s\": {", i ? "," : "", results[i].mName.c_str());
+			for ( size_t m=0; m<results[i].mMetrics.size(); ++m )
+				std::fprintf(f, "%s\"%s\": %.6g", m ? ", " : " ", results[i].mMetrics[m].first.c_str(), results[i].mMetrics[m].second);
+			std::fprintf(f, " }");
+		}
+		std::fprintf(f, "\n  },\n");
+		std::fprintf(f, "  \"skipped\": [");
+		for ( size_t i=0; i<skipped.size(); ++i )
+			std::fprintf(f, "%s\"%s\"", i ? ", " : "", skipped[i].c_str());
+		std::fprintf(f, "]\n}\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string jsonFile, oggFile, device;
+	double seconds = 3.0;
+
+	for ( int i=1; i<argc; ++i )
+	{
+		const std::string arg = argv[i];
+		if ( i+1<argc && arg=="--json" ) jsonFile = argv[++i];
+		else if ( i+1<argc && arg=="--ogg" ) oggFile = argv[++i];
+		else if ( i+1<argc && arg=="--device" ) device = argv[++i];
+		else if ( i+1<argc && arg=="--seconds" ) seconds = std::atof(argv[++i]);
+		else
+		{
+			std::fprintf(stderr, "Usage: %s [--json file] [--ogg file] [--device name] [--seconds n]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// No sound card needed, OpenAL Soft renders to nothing in real time
+	if ( device.empty() )
+	{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		_putenv_s("ALSOFT_DRIVERS", "null");
+#else
+		setenv("ALSOFT_DRIVERS", "null", 1);
+#endif
+	}
+
+	// Test audio
+	const std::vector<short> mono = generateSignal(1, 1.f);
+	const std::vector<short> stereo = generateSignal(2, 10.f);
+	if ( !writeWav(WAV_MONO_FILE, mono, 1) || !writeWav(WAV_STEREO_FILE, stereo, 2) )
+	{
+		std::fprintf(stderr, "Unable to write test audio to the working directory\n");
+		return 1;
+	}
+	bool generatedOgg = false;
+#ifdef HAVE_VORBISENC
+	if ( oggFile.empty() && writeOgg(OGG_FILE, stereo, 2) )
+	{
+		oggFile = OGG_FILE;
+		generatedOgg = true;
+	}
+#endif
+
+	// Headless Ogre, logging to file only so stdout stays machine readable
+	Ogre::LogManager* logManager = OGRE_NEW Ogre::LogManager();
+	logManager->createLog("oggsound_bench.log", true, false, false);
+	Ogre::Root* root = OGRE_NEW Ogre::Root("", "", "");
+	Ogre::SceneManager* sceneMgr = root->createSceneManager("DefaultSceneManager");
+	Ogre::ResourceGroupManager::getSingleton().addResourceLocation(".", "FileSystem");
+
+	// Register as OgreOggSoundPlugin would
+	OgreOggSoundFactory* factory = OGRE_NEW_T(OgreOggSoundFactory, Ogre::MEMCATEGORY_GENERAL)();
+	root->addMovableObjectFactory(factory, true);
+	OgreOggSoundManager* manager = OGRE_NEW_T(OgreOggSoundManager, Ogre::MEMCATEGORY_GENERAL)();
+
+	int status = 0;
+	std::vector<Result> results;
+	std::vector<std::string> skipped;
+
+	// Encoder correctness, no device needed
+	std::fprintf(stderr, "ima4_roundtrip...\n");
+	bool ima4Passed;
+	results.push_back(checkIma4RoundTrip(ima4Passed));
+
+	OgreOggSoundManager& mgr = *manager;
+	if ( !ima4Passed )
+		status = 1;
+	else if ( !mgr.init(device, NUM_SOURCES, 1024, sceneMgr) )
+	{
+		std::fprintf(stderr, "Unable to initialise OpenAL device\n");
+		status = 1;
+	}
+	else
+	{
+		try
+		{
+			std::fprintf(stderr, "create_destroy...\n");
+			results.push_back(benchCreateDestroy(mgr, 2000));
+
+			if ( !oggFile.empty() )
+			{
+				std::fprintf(stderr, "ogg_decode...\n");
+				results.push_back(benchOggDecode(mgr, oggFile));
+
+				std::fprintf(stderr, "ogg_decode_float...\n");
+				results.push_back(benchOggDecodeFloat(mgr, oggFile));
+			}
+			else
+			{
+				skipped.push_back("ogg_decode");
+				skipped.push_back("ogg_decode_float");
+			}
+
+			std::fprintf(stderr, "stream_refill...\n");
+			results.push_back(benchStreamRefill(mgr, oggFile.empty() ? WAV_STEREO_FILE : oggFile, 16, seconds));
+
+			std::fprintf(stderr, "voice_stealing...\n");
+			results.push_back(benchVoiceStealing(mgr, 1000, seconds));
+
+			std::fprintf(stderr, "action_queue...\n");
+			results.push_back(benchActionQueue(mgr, 200000));
+
+			std::fprintf(stderr, "listener_update...\n");
+			results.push_back(benchListenerUpdate(mgr, 20000));
+		}
+		catch (Ogre::Exception& e)
+		{
+			std::fprintf(stderr, "%s\n", e.getFullDescription().c_str());
+			status = 1;
+		}
+	}
+
+	const Ogre::String deviceName = mgr.getOpenalDevice() ? alcGetString(const_cast<ALCdevice*>(mgr.getOpenalDevice()), ALC_DEVICE_SPECIFIER) : "";
+
+	OGRE_DELETE_T(manager, OgreOggSoundManager, Ogre::MEMCATEGORY_GENERAL);
+	root->removeMovableObjectFactory(factory);
+	OGRE_DELETE_T(factory, OgreOggSoundFactory, Ogre::MEMCATEGORY_GENERAL);
+	OGRE_DELETE root;
+	OGRE_DELETE logManager;
+
+	std::remove(WAV_MONO_FILE);
+	std::remove(WAV_STEREO_FILE);
+	if ( generatedOgg ) std::remove(OGG_FILE);
+
+	if ( status ) return status;
+
+	FILE* f = jsonFile.empty() ? stdout : std::fopen(jsonFile.c_str(), "w");
+	if ( !f )
+	{
+		std::fprintf(stderr, "Unable to write %s\n", jsonFile.c_str());
+		return 1;
+	}
+	writeJSON(f, deviceName, results, skipped);
+	if ( f!=stdout ) std::fclose(f);
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+/**
+* @file SampleKernelsBench.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+* @section DESCRIPTION
+* 
+* Checks the vector sample conversion kernels are bit exact against the scalar
+* versions, then measures the throughput of each instruction set. 
+* Exits with 1 on any mismatch.
+*
+* Usage: sample_kernels_bench [samples]
+*/
+
+#include "OgreOggSoundKernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace OgreOggSound;
+
+namespace
+{
+	typedef OgreOggSoundKernels K;
+
+	const K::InstructionSet SETS[] = { K::IS_SCALAR, K::IS_SSE2, K::IS_AVX2, K::IS_NEON };
+	const size_t NUM_SETS = sizeof(SETS) / sizeof(SETS[0]);
+
+	unsigned int sSeed = 12345;
+
+	unsigned int nextRandom()
+	{
+		sSeed = sSeed * 1103515245 + 12345;
+		return sSeed >> 8;
+	}
+
+	/** Mostly in range samples, with overs, rounding ties and non-finite values mixed in
+	 */
+	float randomSample()
+	{
+		switch(nextRandom() % 16)
+		{
+		case 0: return (static_cast<int>(nextRandom() % 65536) - 32768 + 0.5f) / 32768.f;
+		case 1: return ((nextRandom() & 1) ? 1.f : -1.f) * (1.f + (nextRandom() % 1000) / 100.f);
+		case 2: return ((nextRandom() & 1) ? 1.f : -1.f) * std::numeric_limits<float>::infinity();
+		case 3: return std::numeric_limits<float>::quiet_NaN();
+		case 4: return (nextRandom() & 1) ? -0.f : std::numeric_limits<float>::denorm_min();
+		default: return (static_cast<float>(nextRandom() % 2000001) - 1000000.f) / 1000000.f;
+		}
+	}
+
+	size_t sFailures = 0;
+
+	void check(bool same, const char* kernel, K::InstructionSet set, size_t count, int channels=1)
+	{
+		if ( same ) return;
+		std::fprintf(stderr, "%s: %s differs from scalar (%lu samples, %d channels)\n", kernel, K::getName(set), (unsigned long)count, channels);
+		++sFailures;
+	}
+
+	/** Runs every kernel with set and compares against the scalar output
+	 */
+	void checkSet(K::InstructionSet set)
+	{
+		const float gains[] = { 1.f, 0.5f, 1.7f };
+		const int channelCounts[] = { 1, 2, 3, 6, 8 };
+
+		for ( size_t count=0; count<=4133; count += (count<80 ? 1 : 1013) )
+		{
+			std::vector<unsigned char> bytes(count);
+			std::vector<float> floats(count);
+			for ( size_t i=0; i<count; ++i )
+			{
+				bytes[i] = static_cast<unsigned char>(nextRandom());
+				floats[i] = randomSample();
+			}
+
+			std::vector<short> expected(count + 1), actual(count + 1);
+			K::setInstructionSet(K::IS_SCALAR);
+			K::convert8To16(bytes.empty() ? 0 : &bytes[0], count, &expected[0]);
+			K::setInstructionSet(set);
+			K::convert8To16(bytes.empty() ? 0 : &bytes[0], count, &actual[0]);
+			check(expected==actual, "convert8To16", set, count);
+
+			for ( size_t g=0; g<sizeof(gains)/sizeof(gains[0]); ++g )
+			{
+				K::setInstructionSet(K::IS_SCALAR);
+				K::floatToInt16(floats.empty() ? 0 : &floats[0], count, &expected[0], gains[g]);
+				K::setInstructionSet(set);
+				K::floatToInt16(floats.empty() ? 0 : &floats[0], count, &actual[0], gains[g]);
+				check(expected==actual, "floatToInt16", set, count);
+			}
+
+			for ( size_t c=0; c<sizeof(channelCounts)/sizeof(channelCounts[0]); ++c )
+			{
+				const int channels = channelCounts[c];
+				std::vector< std::vector<float> > planeData(channels, std::vector<float>(count + 1));
+				std::vector<const float*> planes(channels);
+				for ( int ch=0; ch<channels; ++ch )
+				{
+					for ( size_t i=0; i<count; ++i ) planeData[ch][i] = randomSample();
+					planes[ch] = &planeData[ch][0];
+				}
+
+				// Compare bit patterns as NaN never equals itself
+				std::vector<float> expectedF(count * channels + 1), actualF(count * channels + 1);
+				K::setInstructionSet(K::IS_SCALAR);
+				K::interleaveFloat(&planes[0], channels, count, &expectedF[0]);
+				K::setInstructionSet(set);
+				K::interleaveFloat(&planes[0], channels, count, &actualF[0]);
+				check(std::memcmp(&expectedF[0], &actualF[0], expectedF.size() * sizeof(float))==0, "interleaveFloat", set, count, channels);
+
+				std::vector<short> expected16(count * channels + 1), actual16(count * channels + 1);
+				K::setInstructionSet(K::IS_SCALAR);
+				K::interleaveToInt16(&planes[0], channels, count, &expected16[0], 0.8f);
+				K::setInstructionSet(set);
+				K::interleaveToInt16(&planes[0], channels, count, &actual16[0], 0.8f);
+				check(expected16==actual16, "interleaveToInt16", set, count, channels);
+			}
+		}
+	}
+
+	inline double secondsSince(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	/** Repeats a kernel for at least a quarter of a second, returns millions of samples/sec.
+	 */
+	template<typename Fn>
+	double measure(size_t samples, Fn fn)
+	{
+		size_t iterations = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		double elapsed = 0.0;
+		do
+		{
+			fn();
+			++iterations;
+		}
+		while ( (elapsed = secondsSince(start))<0.25 );
+
+		return samples * iterations / elapsed / 1e6;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t count = argc>1 ? static_cast<size_t>(std::strtoull(argv[1], 0, 10)) : 1 << 20;
+	const K::InstructionSet detected = K::getInstructionSet();
+
+	// Bit exactness first
+	for ( size_t s=1; s<NUM_SETS; ++s )
+		if ( K::isSupported(SETS[s]) ) checkSet(SETS[s]);
+	if ( sFailures ) 
+	{
+		std::fprintf(stderr, "%lu mismatches!\n", (unsigned long)sFailures);
+		return 1;
+	}
+
+	std::vector<unsigned char> bytes(count);
+	std::vector<float> floats(count), left(count / 2), right(count / 2), interleaved(count);
+	std::vector<short> shorts(count);
+	for ( size_t i=0; i<count; ++i )
+	{
+		bytes[i] = static_cast<unsigned char>(nextRandom());
+		floats[i] = (static_cast<float>(nextRandom() % 2000001) - 1000000.f) / 1000000.f;
+	}
+	for ( size_t i=0; i<count/2; ++i )
+	{
+		left[i] = floats[i*2];
+		right[i] = floats[i*2+1];
+	}
+	const float* planes[2] = { &left[0], &right[0] };
+
+	std::printf("Sample kernels: %lu samples, detected %s\n", (unsigned long)count, K::getName(detected));
+	for ( size_t s=0; s<NUM_SETS; ++s )
+	{
+		if ( !K::setInstructionSet(SETS[s]) ) continue;
+
+		std::printf("  %s\n", K::getName(SETS[s]));
+		std::printf("    convert8To16       : %10.1f Msamples/sec\n", measure(count, [&]() { K::convert8To16(&bytes[0], count, &shorts[0]); }));
+		std::printf("    floatToInt16       : %10.1f Msamples/sec\n", measure(count, [&]() { K::floatToInt16(&floats[0], count, &shorts[0], 0.8f); }));
+		std::printf("    interleaveFloat    : %10.1f Msamples/sec\n", measure(count, [&]() { K::interleaveFloat(planes, 2, count / 2, &interleaved[0]); }));
+		std::printf("    interleaveToInt16  : %10.1f Msamples/sec\n", measure(count, [&]() { K::interleaveToInt16(planes, 2, count / 2, &shorts[0]); }));
+	}
+	K::setInstructionSet(detected);
+
+	return 0;
+}
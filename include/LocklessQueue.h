@@ -30,6 +30,12 @@
 * All credit goes to: Lf3THn4D
 */
 
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
 namespace OgreOggSound
 {
 	//! LocklessQueue template: as provid3ed by Lf3THn4D
@@ -39,29 +45,59 @@ namespace OgreOggSound
 	* items from one thread to another.
 	* \note
 	* Only 1 thread can push and 1 thread can pop it.
+	* \note
+	* Capacity is rounded up to a power of two so indices can be masked
+	* instead of using modulo. Head and tail are kept on separate cache
+	* lines, each side keeps a cached copy of the other's index so the
+	* shared line is only touched when the queue appears full/empty.
 	*/
 	template <class Type>
 	class LocklessQueue
 	{
 	private:
+		//! assumed size of a cache line.
+		static const size_t CACHE_LINE_SIZE = 64;
+
 		//! buffer to keep the queue.
 		Type* m_buffer;
 
-		//! head of queue list.
-		size_t m_head;
+		//! capacity of buffer (power of two).
+		size_t m_capacity;
+
+		//! mask to wrap indices.
+		size_t m_mask;
+
+		char m_pad0[CACHE_LINE_SIZE];
+
+		//! head of queue list (written by producer).
+		std::atomic<size_t> m_head;
+
+		//! producers cached copy of tail.
+		size_t m_tailCache;
+
+		char m_pad1[CACHE_LINE_SIZE];
+
+		//! tail of queue list (written by consumer).
+		std::atomic<size_t> m_tail;
 
-		//! tail of queue list.
-		size_t m_tail;
+		//! consumers cached copy of head.
+		size_t m_headCache;
 
-		//! size of buffer.
-		size_t m_size;
+		char m_pad2[CACHE_LINE_SIZE];
+
+		//! non-copyable.
+		LocklessQueue(const LocklessQueue&);
+		LocklessQueue& operator=(const LocklessQueue&);
 
 	public:
 		//! constructor.
 		inline LocklessQueue(size_t size) :
-		m_head(0), m_tail(0), m_size(size + 1)
+		m_head(0), m_tailCache(0), m_tail(0), m_headCache(0)
 		{
-			m_buffer = new Type[m_size];
+			m_capacity = 1;
+			while ( m_capacity<size ) m_capacity <<= 1;
+			m_mask = m_capacity - 1;
+			m_buffer = new Type[m_capacity];
 		}
 
 		//! destructor.
@@ -73,13 +109,42 @@ namespace OgreOggSound
 		//! push object into the queue.
 		inline bool push(const Type& obj)
 		{
-			size_t next_head = (m_head + 1) % m_size;
-			if (next_head == m_tail) return false;
-			m_buffer[m_head] = obj;
-			m_head = next_head;
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			if ( head - m_tailCache == m_capacity )
+			{
+				m_tailCache = m_tail.load(std::memory_order_acquire);
+				if ( head - m_tailCache == m_capacity ) return false;
+			}
+			m_buffer[head & m_mask] = obj;
+			m_head.store(head + 1, std::memory_order_release);
 			return true;
 		}
 
+		//! push a number of objects into the queue.
+		/**
+		@remarks
+			Publishes all objects with a single release, returns the number
+			actually pushed which may be less than requested if the queue fills.
+		*/
+		inline size_t push_n(const Type* objs, size_t count)
+		{
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			size_t space = m_capacity - (head - m_tailCache);
+			if ( space<count )
+			{
+				m_tailCache = m_tail.load(std::memory_order_acquire);
+				space = m_capacity - (head - m_tailCache);
+			}
+			if ( count>space ) count = space;
+			// At most two contiguous spans, up to the wrap point then the rest
+			const size_t start = head & m_mask;
+			const size_t first = std::min(count, m_capacity - start);
+			std::copy(objs, objs + first, m_buffer + start);
+			std::copy(objs + first, objs + count, m_buffer);
+			m_head.store(head + count, std::memory_order_release);
+			return count;
+		}
+
 		//! query status.
 		/**
 		@remarks
@@ -87,16 +152,74 @@ namespace OgreOggSound
 		*/
 		inline bool empty() const
 		{
-			return (m_head==m_tail);
+			return m_head.load(std::memory_order_acquire)==m_tail.load(std::memory_order_acquire);
+		}
+
+		//! number of queued objects.
+		/**
+		@remarks
+			Only a snapshot when called whilst the other thread is active.
+		*/
+		inline size_t size() const
+		{
+			const size_t tail = m_tail.load(std::memory_order_acquire);
+			return m_head.load(std::memory_order_acquire) - tail;
+		}
+
+		//! maximum number of queued objects.
+		inline size_t capacity() const
+		{
+			return m_capacity;
 		}
 
 		//! pop object out from the queue.
 		inline bool pop(Type& obj)
 		{
-			if (m_tail == m_head) return false;
-			obj = m_buffer[m_tail];
-			m_tail = (m_tail + 1) % m_size;
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+			if ( tail==m_headCache )
+			{
+				m_headCache = m_head.load(std::memory_order_acquire);
+				if ( tail==m_headCache ) return false;
+			}
+			obj = m_buffer[tail & m_mask];
+			m_tail.store(tail + 1, std::memory_order_release);
 			return true;
 		}
+
+		//! pop a number of objects out from the queue.
+		/**
+		@remarks
+			Returns the number of objects actually popped, frees all the
+			slots with a single release.
+		*/
+		inline size_t pop_n(Type* objs, size_t count)
+		{
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+			size_t avail = m_headCache - tail;
+			if ( avail<count )
+			{
+				m_headCache = m_head.load(std::memory_order_acquire);
+				avail = m_headCache - tail;
+			}
+			if ( count>avail ) count = avail;
+			// At most two contiguous spans, up to the wrap point then the rest
+			const size_t start = tail & m_mask;
+			const size_t first = std::min(count, m_capacity - start);
+			std::copy(m_buffer + start, m_buffer + start + first, objs);
+			std::copy(m_buffer, m_buffer + (count - first), objs + first);
+			m_tail.store(tail + count, std::memory_order_release);
+			return count;
+		}
+
+		//! discard all queued objects.
+		/**
+		@remarks
+			Consumer side only, anything pushed concurrently may remain.
+		*/
+		inline void clear()
+		{
+			m_headCache = m_head.load(std::memory_order_acquire);
+			m_tail.store(m_headCache, std::memory_order_release);
+		}
 	};
-};
\ No newline at end of file
+};
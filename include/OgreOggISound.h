@@ -36,14 +36,34 @@
 
 #include "OgreOggSoundPrereqs.h"
 #include <string>
+#include <atomic>
 #include <vorbis/vorbisfile.h>
 #include "OgreOggSoundCallback.h"
+
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+#		include "Poco/Mutex.h"
+#	else 
+#		include <boost/thread/recursive_mutex.hpp>
+#	endif
+#endif
 	
 /**
- * Number of buffers to use for streaming
+ * Default number of buffers to use for streaming
  */
 #define NUM_BUFFERS 4
 
+/**
+ * Limits on the number of buffers a stream can queue
+ */
+#define MIN_STREAM_BUFFERS 2
+#define MAX_STREAM_BUFFERS 32
+
+/**
+ * Default duration of a stream buffer in seconds
+ */
+#define STREAM_BUFFER_TIME 0.25f
+
 namespace OgreOggSound
 {
 
@@ -120,6 +140,14 @@ namespace OgreOggSound
 		int   dataRead;   // How much data we have read so far
 	};
 
+	/*
+	** Ogg Vorbis accessor functions reading from an Ogre::DataStreamPtr
+	*/
+	size_t	OOSStreamRead(void *ptr, size_t size, size_t nmemb, void *datasource);
+	int		OOSStreamSeek(void *datasource, ogg_int64_t offset, int whence);
+	int		OOSStreamClose(void *datasource);
+	long	OOSStreamTell(void *datasource);
+
 
 	//! A single sound object
 	/** provides functions for setting audio properties
@@ -196,6 +224,52 @@ namespace OgreOggSound
 		/** Gets the start point of a loopable section of audio in seconds.
 		 */
 		inline float getLoopOffset() { return mLoopOffset; }
+		/** Sets the number of buffers a stream queues on its source.
+		@remarks
+			(NOTE:- Streamed sounds ONLY)
+			More buffers protect against underruns on a busy machine at the cost of 
+			memory and latency. Clamped to MIN_STREAM_BUFFERS..MAX_STREAM_BUFFERS, 
+			picked up by the next refill. Default: NUM_BUFFERS
+			@param count
+				Number of buffers.
+		 */
+		void setStreamBufferCount(unsigned int count);
+		/** Gets the number of buffers a stream queues on its source.
+		@remarks
+			With adaptive buffering enabled this is the minimum, see getStreamBufferTarget().
+		 */
+		inline unsigned int getStreamBufferCount() const { return mStreamBufferCount; }
+		/** Gets the number of buffers a stream is currently aiming to queue.
+		 */
+		inline unsigned int getStreamBufferTarget() const { return mStreamBufferTarget; }
+		/** Sets the duration of audio held by each stream buffer.
+		@remarks
+			(NOTE:- Streamed sounds ONLY)
+			Short buffers give low latency for interactive music, long buffers reduce
+			the number of refills. Picked up by the next refill. Default: STREAM_BUFFER_TIME
+			@param seconds
+				Duration in seconds (>0).
+		 */
+		void setStreamBufferTime(float seconds);
+		/** Gets the duration of audio held by each stream buffer.
+		 */
+		inline float getStreamBufferTime() const { return mStreamBufferTime; }
+		/** Sets whether a stream adapts its buffer count.
+		@remarks
+			(NOTE:- Streamed sounds ONLY)
+			When enabled the queue is doubled whenever the stream runs dry, up to 
+			MAX_STREAM_BUFFERS, and shrunk back towards getStreamBufferCount() one buffer 
+			at a time whilst refills consistently happen with half the queue still unplayed.
+			@param adaptive
+				Flag to enable adaptive buffering.
+		 */
+		void setAdaptiveStreamBuffers(bool adaptive);
+		/** Gets whether a stream adapts its buffer count.
+		 */
+		inline bool getAdaptiveStreamBuffers() const { return mAdaptiveStreamBuffers; }
+		/** Gets the number of times this stream ran dry before reaching its end.
+		 */
+		inline unsigned int getUnderrunCount() const { return mUnderruns; }
 		/** Sets the source object for playback.
 		@remarks
 			Abstract function
@@ -262,6 +336,14 @@ namespace OgreOggSound
 			Checks for a valid source before checking the state value
 		 */
 		inline bool isStopped() const { return mSource != AL_NONE && mState == SS_STOPPED; }
+		/** Returns virtual status.
+		@remarks
+			A virtual sound is logically playing without a source, its play
+			position advances and it resumes from there once it becomes audible 
+			again. isPlaying() returns false whilst virtual.
+			See OgreOggSoundManager::setVirtualVoices().
+		 */
+		inline bool isVirtual() const { return mVirtual; }
 		/** Returns position status.
 		@remarks
 			Returns whether position is local to listener or in world-space
@@ -327,7 +409,8 @@ namespace OgreOggSound
 		void setVolume(float gain);
 		/** Gets sounds volume
 		@remarks
-			Gets the current gain value.
+			Gets the requested gain value, which reaches the source on the 
+			next update.
 		 */
 		float getVolume() const;
 		/** Sets sounds maximum attenuation volume
@@ -372,9 +455,7 @@ namespace OgreOggSound
 		*/
 		void setMaxDistance(float maxDistance);
 		/** Gets sounds maximum distance
-		@remarks
-			Returns -1 on error
-		*/
+		 */
 		const float getMaxDistance() const;
 		/** Sets sounds rolloff factor
 		@remarks
@@ -386,9 +467,7 @@ namespace OgreOggSound
 		*/
 		void setRolloffFactor(float rolloffFactor);
 		/** Gets sounds rolloff factor
-		@remarks
-			Returns -1 on error
-		*/
+		 */
 		const float getRolloffFactor() const;
 		/** Sets sounds reference distance
 		@remarks
@@ -399,9 +478,7 @@ namespace OgreOggSound
 		*/
 		void setReferenceDistance(float referenceDistance);
 		/** Gets sounds reference distance
-		@remarks
-			Returns -1 on error
-		*/
+		 */
 		const float getReferenceDistance() const;
 		/** Sets sounds pitch
 		@remarks
@@ -411,9 +488,7 @@ namespace OgreOggSound
 		*/
 		void setPitch(float pitch);	
 		/** Gets sounds pitch
-		@remarks
-			Returns -1 on error
-		*/
+		 */
 		const float getPitch() const;	
 		/** Sets whether the positional information is relative to the listener
 		@remarks
@@ -445,6 +520,11 @@ namespace OgreOggSound
 		/** Gets the sounds name
 		 */
 		inline const Ogre::String& getName( void ) const { return mName; }
+		/** Returns the sounds handle
+		@remarks
+			Handles allow the manager to look up sounds without a name search.
+		 */
+		inline SoundHandle getHandle( void ) const { return (static_cast<SoundHandle>(mSlotGeneration) << 32) | mSlot; }
 		/** Gets the sounds file name
 		 */
 		virtual const Ogre::String& getFileName( void ) const { return mAudioStream.isNull() ? Ogre::BLANKSTRING : mAudioStream->getName(); }
@@ -459,7 +539,7 @@ namespace OgreOggSound
 			@param priority 
 				(0..255)
 		 */
-		inline void setPriority(Ogre::uint8 priority) { mPriority=priority; }
+		inline void setPriority(Ogre::uint8 priority) { mPriority=priority; mSourceKeyDirty=true; }
 		/** Adds a time position in a sound as a cue point
 		@remarks
 			Allows the setting of a 'jump-to' point within an audio file. Returns the true on success. 
@@ -542,9 +622,49 @@ namespace OgreOggSound
 				Reference to an object to store buffer format
 		*/
 		void _getSharedProperties(BufferListPtr& buffers, float& length, ALenum& format); 
+
+		/** Decodes interleaved 16-bit samples from an ogg stream.
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			Replacement for ov_read() converting with OgreOggSoundKernels, returning 
+			bytes read, 0 at the end of the stream or a negative error code. Only 
+			whole frames are read.
+			@param file
+				Vorbis file to read from.
+			@param data
+				Buffer to decode into, aligned for shorts.
+			@param bytes
+				Size of data, at least one frame.
+			@param channels
+				Number of channels.
+			@param section
+				Receives the current logical bitstream.
+		 */
+		static long _readShort(OggVorbis_File& file, char* data, int bytes, int channels, int* section);
+		/** Decodes interleaved float samples from an ogg stream.
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			As _readShort() but for float buffers, data must be aligned for floats.
+		 */
+		static long _readFloat(OggVorbis_File& file, char* data, int bytes, int channels, int* section);
 	
 	protected:
 
+		/** Source properties awaiting submission to OpenAL
+		 */
+		enum DirtyState
+		{
+			DS_POSITION		= 1<<0,
+			DS_DIRECTION	= 1<<1,
+			DS_VELOCITY		= 1<<2,
+			DS_GAIN			= 1<<3,
+			DS_GAIN_LIMITS	= 1<<4,
+			DS_DISTANCE		= 1<<5,
+			DS_CONE			= 1<<6,
+			DS_PITCH		= 1<<7,
+			DS_RELATIVE		= 1<<8
+		};
+
 		/** Superclass describing a single sound object.
 		@param name
 			Name of sound within manager
@@ -630,6 +750,14 @@ namespace OgreOggSound
 			Initialises all the source objects states ready for playback.
 		 */
 		void _initSource();
+		/** Submits changed source properties to OpenAL
+		@remarks
+			Setters only record values and mark them dirty, this applies
+			everything changed since the last flush in one go. Called once
+			per update by the manager, and before playback starts. Setters
+			and the flush share mStateMutex so vectors are never read half written.
+		 */
+		void _flushState();
 		/** Stores the current play position of the sound
 		@remarks
 			Only for static sounds at present so that when re-activated it begins 
@@ -642,6 +770,24 @@ namespace OgreOggSound
 			starts where it left off
 		 */
 		void _recoverPlayPosition();
+		/** Continues playing virtually after failing to get a source.
+		 */
+		void _playVirtual();
+		/** Pauses a virtual sound.
+		@remarks
+			Returns true if the sound was virtual and has been paused.
+		 */
+		bool _pauseVirtual();
+		/** Stops a virtual sound.
+		@remarks
+			Returns true if the sound was virtual and has been stopped.
+		 */
+		bool _stopVirtual();
+		/** Marks source properties as needing submission
+		@param state
+			DirtyState flags.
+		 */
+		inline void _markDirty(unsigned int state) { mDirtyState.fetch_or(state); if ( state & DS_POSITION ) mSourceKeyDirty = true; }
 		/** Updates a fade
 		@remarks
 			Updates a fade action.
@@ -664,6 +810,79 @@ namespace OgreOggSound
 			sound properties.
 		 */
 		virtual bool _queryBufferInfo() = 0;		
+		/** Calculates the size of a stream buffer.
+		@remarks
+			Sets mBufferSize to getStreamBufferTime() seconds of audio, 
+			an exact multiple of the block alignment.
+			@param bytesPerSecond
+				Decoded data rate.
+			@param blockAlign
+				Size of a single sample frame in bytes.
+		 */
+		void _calculateBufferSize(unsigned int bytesPerSecond, unsigned int blockAlign);
+		/** Gets the size of a single decoded sample in bytes.
+		 */
+		inline unsigned int _getSampleSize() const { return mFloat ? sizeof(float) : 2; }
+		/** Matches the stream buffer list to the target count.
+		@remarks
+			Generates or deletes buffers, none may be queued on the source.
+			Returns false if buffers could not be generated.
+		 */
+		bool _resizeStreamBuffers();
+		/** Generates an extra stream buffer.
+		@remarks
+			Used to deepen the queue whilst playing, returns AL_NONE on failure.
+		 */
+		ALuint _addStreamBuffer();
+		/** Deletes a processed stream buffer if the queue is too deep.
+		@remarks
+			Returns true if the buffer was deleted and shouldn't be requeued.
+			@param buffer
+				Buffer just unqueued from the source.
+			@param force
+				Delete regardless of queue depth, used for added buffers which couldn't be filled.
+		 */
+		bool _removeStreamBuffer(ALuint buffer, bool force=false);
+		/** Adjusts the target buffer count of an adaptive stream.
+		@param underrun
+			Flag indicating the source ran out of queued audio.
+		@param queued
+			Number of buffers queued when serviced.
+		@param processed
+			Number of those buffers already played.
+		 */
+		void _adaptStreamBuffers(bool underrun, int queued=0, int processed=0);
+		/** Gets the time until this sound next needs servicing.
+		@remarks
+			Used by the streaming thread to work out how long it can sleep for.
+			By default this is the time until playback reaches the end of the
+			audio data so finished/looping callbacks are still delivered promptly.
+			Returns seconds.
+		 */
+		virtual float _getRefillDeadline() const;
+		/** Gets the time until a streamed sound needs its queue topping up.
+		@remarks
+			Calculated from the amount of audio still queued on the source, the
+			refill is due once half of the queue has been played, leaving the
+			remainder as headroom. Once the end of the stream has been reached
+			the deadline is simply the end of the queued audio.
+			@param bufferTime
+				Duration of a single stream buffer in seconds.
+			@param eof
+				Flag indicating no more data can be streamed.
+		 */
+		float _getStreamingDeadline(float bufferTime, bool eof) const;
+		/** Gets a buffer to decode audio data into.
+		@remarks
+			The buffer is kept between calls and only reallocated if a larger
+			size is requested, so refilling stream buffers doesn't allocate.
+			@param size
+				Required size in bytes.
+		 */
+		char* _getDecodeBuffer(size_t size);
+		/** Frees the decode buffer.
+		 */
+		void _releaseDecodeBuffer();
 
 		/**
 		 * Variables used to fade sound
@@ -677,10 +896,20 @@ namespace OgreOggSound
 
 		// Ogre resource stream pointer
 		Ogre::DataStreamPtr mAudioStream;
+		Ogre::MemoryDataStreamPtr mCompressedData;	// Resident file data mAudioStream reads from
 		ov_callbacks mOggCallbacks;
 
 		SoundListener* mSoundListener;	// Callback object
-		size_t mBufferSize;				// Size of audio buffer (250ms)
+		size_t mBufferSize;				// Size of audio buffer
+		float mBufferTime;				// Duration mBufferSize was calculated for
+		float mStreamBufferTime;		// Requested duration of a stream buffer
+		unsigned int mStreamBufferCount;	// Requested number of stream buffers
+		unsigned int mStreamBufferTarget;	// Current number of stream buffers aimed for
+		bool mAdaptiveStreamBuffers;	// Flag to adapt stream buffer count to underruns
+		unsigned int mEarlyRefills;		// Consecutive refills with half the queue unplayed
+		unsigned int mUnderruns;		// Number of times the stream ran dry
+		char* mDecodeBuffer;			// Reusable decode buffer for streaming
+		size_t mDecodeBufferSize;		// Size of decode buffer
 
 		/** Sound properties 
 		 */
@@ -702,12 +931,31 @@ namespace OgreOggSound
 		float mOuterConeAngle;			// outer cone angle
 		float mPlayTime;				// Time in seconds of sound file
 		Ogre::String mName;				// Sound name
+		Ogre::String mLoadFile;			// Audio file awaiting a threaded load
+		unsigned int mSlot;				// Index into the managers sound table
+		unsigned int mSlotGeneration;	// Generation of the sound table slot
+		std::list<OgreOggISound*>::iterator mActivePosition;	// Position in the managers active list
+		size_t mSourceHeapIndex;		// Position in the managers source heap
+		Ogre::Real mSourceKeyDistance;	// Cached distance to listener for the source heap
+		Ogre::uint8 mSourceKeyPriority;	// Cached priority for the source heap
+		bool mSourceKeyStopped;			// Cached stopped state for the source heap
+		std::atomic<bool> mSourceKeyDirty;	// Position or priority changed since the key was cached
+		bool mVirtual;					// Playing without a source
+		float mVirtualPlayPos;			// Play position advanced whilst virtual
 		SoundState mState;				// Sound state
 		bool mLoop;						// Loop status
 		bool mDisable3D;				// 3D status
 		bool mGiveUpSource;				// Flag to indicate whether sound should release its source when stopped
 		bool mStream;					// Stream flag
 		bool mSourceRelative;			// Relative position flag
+		std::atomic<unsigned int> mDirtyState;	// DirtyState flags awaiting a flush
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex mStateMutex;				// Guards source properties read by _flushState()
+#	else
+		boost::recursive_mutex mStateMutex;		// Guards source properties read by _flushState()
+#	endif
+#endif
 		#if OGRE_VERSION_MAJOR == 1
 		bool mLocalTransformDirty;		// Transformation update flag
 		#endif
@@ -719,6 +967,7 @@ namespace OgreOggSound
 	
 		BufferListPtr mBuffers;			// Audio buffer(s)
 		ALenum mFormat;					// OpenAL format
+		bool mFloat;					// Flag indicating audio is decoded to float
 
 		unsigned long mAudioOffset;		// offset to audio data
 		unsigned long mAudioEnd;		// offset to end of audio data
@@ -79,6 +79,7 @@ namespace OgreOggSound
 			, mLocalTransformDirty(false)
 			#endif
 			, mSceneMgr(scnMgr)
+			, mDirtyState(0)
 		{
 			for (int i=0; i<6; ++i ) mOrientation[i]=0.f;
 			mName = "OgreOggListener";
@@ -145,7 +146,7 @@ namespace OgreOggSound
 		@remarks
 			Handles positional updates to the listener either automatically
 			through the SceneGraph attachment or manually using the 
-			provided functions.
+			provided functions. Changed values are submitted to OpenAL here.
 		 */
 		void update();
 		/** Gets the movable type string for this object.
@@ -217,6 +218,19 @@ namespace OgreOggSound
 #	endif
 #endif
 
+		/** Listener properties awaiting submission to OpenAL
+		 */
+		enum DirtyState
+		{
+			DS_POSITION		= 1<<0,
+			DS_VELOCITY		= 1<<1,
+			DS_ORIENTATION	= 1<<2
+		};
+
+		/** Submits changed listener properties to OpenAL
+		 */
+		void _flushState();
+
 		/**
 		 * Positional variables
 		 */
@@ -229,6 +243,7 @@ namespace OgreOggSound
 		bool mLocalTransformDirty;		// Dirty transforms flag
 		#endif
 		Ogre::SceneManager* mSceneMgr;	// Creator 
+		unsigned int mDirtyState;		// DirtyState flags awaiting a flush
 
 	};
 }
\ No newline at end of file
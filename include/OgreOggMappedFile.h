@@ -0,0 +1,86 @@
+/**
+* @file OgreOggMappedFile.h
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE. 
+*
+* @section DESCRIPTION
+* 
+* Read only memory mapping of audio files on disk
+*/
+
+#pragma once
+
+#include "OgreOggSoundPrereqs.h"
+
+namespace OgreOggSound
+{
+	//! A read only memory mapped file
+	/** Maps a whole file so audio data can be handed to OpenAL without being
+		read into an intermediate buffer, pages are loaded by the OS on access.
+	*/
+	class _OGGSOUND_EXPORT OgreOggMappedFile
+	{
+	public:
+
+		OgreOggMappedFile();
+		~OgreOggMappedFile();
+
+		/** Maps a file.
+		@remarks
+			Closes any previously mapped file. Returns false if the file 
+			couldn't be opened or mapped, empty files can't be mapped.
+			@param path
+				Path of the file on disk.
+		 */
+		bool open(const Ogre::String& path);
+		/** Unmaps the file.
+		 */
+		void close();
+		/** Returns whether a file is mapped.
+		 */
+		inline bool isOpen() const { return mData!=0; }
+		/** Gets the mapped file contents.
+		 */
+		inline const char* getData() const { return mData; }
+		/** Gets the size of the mapped file.
+		 */
+		inline size_t getSize() const { return mSize; }
+
+	private:
+
+		OgreOggMappedFile(const OgreOggMappedFile&);
+		OgreOggMappedFile& operator=(const OgreOggMappedFile&);
+
+		const char* mData;				// Start of mapping
+		size_t mSize;					// Size of mapping
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		void* mFile;					// File handle
+		void* mMapping;					// File mapping handle
+#endif
+	};
+}
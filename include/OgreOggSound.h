@@ -45,3 +45,4 @@
 #include "OgreOggSoundRecord.h"
 #include "OgreOggSoundFactory.h"
 #include "OgreOggSoundManager.h"
+#include "OgreOggSoundProfiler.h"
@@ -0,0 +1,106 @@
+/**
+* @file OgreOggSoundAdpcm.h
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE. 
+*
+* @section DESCRIPTION
+* 
+* IMA ADPCM encoding for compressed static buffers
+*/
+
+#pragma once
+
+#include "OgreOggSoundPrereqs.h"
+
+#include <vector>
+
+/**
+ * AL_EXT_IMA4 / AL_SOFT_MSADPCM / AL_SOFT_block_alignment tokens, for headers predating them
+ */
+#ifndef AL_FORMAT_MONO_IMA4
+#	define AL_FORMAT_MONO_IMA4				0x1300
+#	define AL_FORMAT_STEREO_IMA4			0x1301
+#endif
+#ifndef AL_FORMAT_MONO_MSADPCM_SOFT
+#	define AL_FORMAT_MONO_MSADPCM_SOFT		0x1302
+#	define AL_FORMAT_STEREO_MSADPCM_SOFT	0x1303
+#endif
+#ifndef AL_UNPACK_BLOCK_ALIGNMENT_SOFT
+#	define AL_UNPACK_BLOCK_ALIGNMENT_SOFT	0x200C
+#endif
+
+/**
+ * Samples per block OpenAL assumes without AL_SOFT_block_alignment
+ */
+#define IMA4_DEFAULT_BLOCK_SAMPLES 65
+#define MSADPCM_DEFAULT_BLOCK_SAMPLES 64
+
+namespace OgreOggSound
+{
+	//! IMA ADPCM encoder
+	/** Encodes 16-bit PCM into the Microsoft IMA ADPCM block layout, as used by 
+		WAV format 0x0011 and AL_EXT_IMA4. Each block starts with a 4 byte header 
+		per channel holding the first sample and step index, followed by 4-bit 
+		samples, channels interleaved every 8 samples.
+	*/
+	class _OGGSOUND_EXPORT OgreOggSoundAdpcm
+	{
+
+	public:
+
+		/** Gets the size in bytes of an IMA ADPCM block.
+		@param channels
+			Number of channels.
+		@param samplesPerBlock
+			Samples per channel in a block, one more than a multiple of 8.
+		 */
+		static size_t getIma4BlockSize(int channels, int samplesPerBlock);
+		/** Encodes 16-bit PCM to IMA ADPCM.
+		@remarks
+			The last block is padded with silence. Returns the number of blocks written.
+			@param pcm
+				Interleaved 16-bit samples.
+			@param frames
+				Samples per channel.
+			@param channels
+				Number of channels.
+			@param samplesPerBlock
+				Samples per channel in a block, one more than a multiple of 8.
+			@param out
+				Receives the encoded blocks.
+		 */
+		static size_t encodeIma4(const short* pcm, size_t frames, int channels, int samplesPerBlock, std::vector<char>& out);
+
+	private:
+
+		/** Encodes a single sample, updating the channel state.
+		 */
+		static unsigned char _encodeSample(int sample, int& predictor, int& index);
+
+	};
+}
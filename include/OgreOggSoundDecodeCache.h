@@ -0,0 +1,173 @@
+/**
+* @file OgreOggSoundDecodeCache.h
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE. 
+*
+* @section DESCRIPTION
+* 
+* Persistent cache of decoded static audio
+*/
+
+#pragma once
+
+#include "OgreOggSoundPrereqs.h"
+#include "OgreOggMappedFile.h"
+
+#include <map>
+#include <string>
+
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+#		include "Poco/Mutex.h"
+#	else 
+#		include <boost/thread/recursive_mutex.hpp>
+#	endif
+#endif
+
+namespace OgreOggSound
+{
+	//! Stores decoded PCM on disk so files are only decoded once
+	/** Each entry is a file in the cache directory named by a hash of its key, 
+		holding the key, format and PCM data. Entries are mapped when loaded so 
+		hits don't allocate. Once the total size exceeds the limit the least 
+		recently used entries are deleted, across runs this is the oldest written.
+	*/
+	class _OGGSOUND_EXPORT OgreOggSoundDecodeCache
+	{
+	public:
+
+		/** Creates a cache.
+		@remarks
+			Indexes any entries already in the directory, which must exist.
+			@param directory
+				Directory to store entries in.
+			@param maxBytes
+				Maximum total size of entries.
+		 */
+		OgreOggSoundDecodeCache(const Ogre::String& directory, size_t maxBytes);
+		~OgreOggSoundDecodeCache();
+
+		/** Looks up decoded audio.
+		@remarks
+			Returns a pointer to the cached PCM or NULL on a miss, the data is
+			valid whilst file stays open.
+			@param key
+				Identifies the source file contents, see OgreOggSoundManager::_getDecodeCacheKey().
+			@param channels
+				Expected channel count.
+			@param rate
+				Expected sample rate.
+			@param file
+				Receives the mapped entry.
+			@param size
+				Receives the size of the PCM data in bytes.
+		 */
+		const char* find(const Ogre::String& key, int channels, long rate, OgreOggMappedFile& file, size_t& size);
+		/** Stores decoded audio.
+		@remarks
+			Evicts old entries to stay within the size limit, data larger than 
+			the limit isn't stored.
+			@param key
+				Identifies the source file contents.
+			@param channels
+				Channel count.
+			@param rate
+				Sample rate.
+			@param data
+				16 bit PCM data.
+			@param size
+				Size of data in bytes.
+		 */
+		void store(const Ogre::String& key, int channels, long rate, const char* data, size_t size);
+		/** Sets the maximum total size of entries.
+		 */
+		void setMaxSize(size_t bytes);
+		/** Gets the maximum total size of entries.
+		 */
+		inline size_t getMaxSize() const { return mMaxSize; }
+		/** Gets the total size of entries.
+		 */
+		inline size_t getSize() const { return mSize; }
+		/** Gets the cache directory.
+		 */
+		inline const Ogre::String& getDirectory() const { return mDirectory; }
+		/** Gets the number of lookups which found decoded audio.
+		 */
+		inline unsigned long getHits() const { return mHits; }
+		/** Gets the number of lookups which had to decode.
+		 */
+		inline unsigned long getMisses() const { return mMisses; }
+		/** Hashes data (64 bit FNV-1a).
+		@param data
+			Data to hash.
+		@param size
+			Size of data in bytes.
+		@param hash
+			Hash of any preceding data.
+		 */
+		static unsigned long long hash(const void* data, size_t size, unsigned long long hash=14695981039346656037ULL);
+
+	private:
+
+		//! An entry on disk
+		struct Entry
+		{
+			size_t mSize;						// File size
+			unsigned long long mLastUsed;		// Time last written or found
+		};
+		typedef std::map<Ogre::String, Entry> EntryMap;
+
+		/** Gets the file name of an entry.
+		 */
+		Ogre::String _getFileName(const Ogre::String& key) const;
+		/** Deletes least recently used entries until within budget.
+		 */
+		void _trim(size_t budget);
+		/** Sets an entry's modification time to now.
+		@remarks
+			Entries are indexed by modification time on startup, so hits
+			keep their place in the eviction order across runs.
+		 */
+		void _touch(const Ogre::String& name);
+
+		Ogre::String mDirectory;				// Cache directory
+		size_t mMaxSize;						// Size limit
+		size_t mSize;							// Total size of entries
+		EntryMap mEntries;						// Entries by file name
+		unsigned long mHits;					// Lookups found
+		unsigned long mMisses;					// Lookups not found
+
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex mMutex;
+#	else
+		boost::recursive_mutex mMutex;
+#	endif
+#endif
+	};
+}
@@ -0,0 +1,151 @@
+/**
+* @file OgreOggSoundKernels.h
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE. 
+*
+* @section DESCRIPTION
+* 
+* Sample conversion kernels used when decoding audio data
+*/
+
+#pragma once
+
+#include "OgreOggSoundPrereqs.h"
+
+/**
+ * AL_EXT_FLOAT32 tokens, for headers predating them
+ */
+#ifndef AL_FORMAT_MONO_FLOAT32
+#	define AL_FORMAT_MONO_FLOAT32			0x10010
+#	define AL_FORMAT_STEREO_FLOAT32			0x10011
+#endif
+
+namespace OgreOggSound
+{
+	//! Sample conversion kernels
+	/** Converts decoded audio between the layouts codecs produce and the 
+		layouts OpenAL expects. Each kernel has a scalar version and SSE2, AVX2
+		and NEON versions where the target has them, picked at runtime from what 
+		the CPU supports. All versions produce bit identical output, float to 
+		integer conversion clamps then rounds to nearest even.
+	*/
+	class _OGGSOUND_EXPORT OgreOggSoundKernels
+	{
+
+	public:
+
+		//! Instruction sets kernels are implemented with
+		enum InstructionSet
+		{
+			IS_SCALAR,
+			IS_SSE2,
+			IS_AVX2,
+			IS_NEON
+		};
+
+		/** Gets the instruction set kernels currently run with.
+		@remarks
+			Defaults to the best one supported by the CPU.
+		 */
+		static InstructionSet getInstructionSet();
+		/** Sets the instruction set kernels run with.
+		@remarks
+			Intended for benchmarking and checking the vector versions against the 
+			scalar ones. Returns false, leaving the current set, if unsupported.
+			Shouldn't be changed whilst sounds are loading.
+			@param set
+				Instruction set to use.
+		 */
+		static bool setInstructionSet(InstructionSet set);
+		/** Gets whether an instruction set is available.
+		@remarks
+			Both compiled in and supported by the CPU.
+			@param set
+				Instruction set to check.
+		 */
+		static bool isSupported(InstructionSet set);
+		/** Gets the name of an instruction set.
+		@param set
+			Instruction set.
+		 */
+		static const char* getName(InstructionSet set);
+
+		/** Converts unsigned 8-bit samples to signed 16-bit.
+		@param in
+			Samples to convert.
+		@param count
+			Number of samples.
+		@param out
+			Receives count samples.
+		 */
+		static void convert8To16(const unsigned char* in, size_t count, short* out);
+		/** Converts float samples to signed 16-bit.
+		@remarks
+			Samples are scaled by 32768 * gain and clamped to the 16-bit range, 
+			so a gain can be applied in the same pass.
+			@param in
+				Samples to convert.
+			@param count
+				Number of samples.
+			@param out
+				Receives count samples.
+			@param gain
+				Linear gain applied before conversion.
+		 */
+		static void floatToInt16(const float* in, size_t count, short* out, float gain=1.f);
+		/** Interleaves planar float samples.
+		@remarks
+			Used with ov_read_float(), which returns one array per channel.
+			@param planes
+				Array of channel pointers, each holding frames samples.
+			@param channels
+				Number of channels.
+			@param frames
+				Samples per channel.
+			@param out
+				Receives frames * channels interleaved samples.
+		 */
+		static void interleaveFloat(const float* const* planes, int channels, size_t frames, float* out);
+		/** Interleaves planar float samples, converting to signed 16-bit.
+		@remarks
+			Equivalent to interleaveFloat() followed by floatToInt16() in one pass.
+			@param planes
+				Array of channel pointers, each holding frames samples.
+			@param channels
+				Number of channels.
+			@param frames
+				Samples per channel.
+			@param out
+				Receives frames * channels interleaved samples.
+			@param gain
+				Linear gain applied before conversion.
+		 */
+		static void interleaveToInt16(const float* const* planes, int channels, size_t frames, short* out, float gain=1.f);
+
+	};
+}
@@ -38,27 +38,38 @@
 #include "OgreOggSoundPrereqs.h"
 #include "OgreOggSound.h"
 #include "OgreOggISound.h"
+#include "OgreOggSoundPreloader.h"
+#include "OgreOggSoundDecodeCache.h"
+#include "OgreOggStreamDecoder.h"
+#include "OgreOggSoundProfiler.h"
 #include "LocklessQueue.h"
 
+#include <atomic>
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
+#include <OgreTimer.h>
 
 #if OGGSOUND_THREADED
 #	ifdef POCO_THREAD
 #		include "Poco/ScopedLock.h"
 #		include "Poco/Thread.h"
 #		include "Poco/Mutex.h"
+#		include "Poco/Event.h"
 #	else 
 #		include <boost/thread/thread.hpp>
 #		include <boost/function/function0.hpp>
 #		include <boost/thread/recursive_mutex.hpp>
+#		include <boost/thread/mutex.hpp>
+#		include <boost/thread/condition_variable.hpp>
 #		include <boost/thread/xtime.hpp>
 #	endif
 #endif
 
 namespace OgreOggSound
 {
-	typedef std::map<std::string, OgreOggISound*> SoundMap;
+	typedef std::map<std::string, SoundHandle> SoundMap;
 	typedef std::map<std::string, ALuint> EffectList;
 	typedef std::map<ALenum, bool> FeatureList;
 	typedef std::list<OgreOggISound*> ActiveList;
@@ -66,6 +77,14 @@ namespace OgreOggSound
 	
 	class OgreOggISound;
 
+	//! Entry in the managers sound table
+	struct SoundSlot
+	{
+		OgreOggISound* mSound;
+		unsigned int mGeneration;
+	};
+	typedef std::vector<SoundSlot> SoundSlotList;
+
 
 	//! Various sound commands
 	enum SOUND_ACTION
@@ -82,37 +101,91 @@ namespace OgreOggSound
 		LQ_DESTROY_TEMPORARY,
 		LQ_ATTACH_EFX,
 		LQ_DETACH_EFX,
-		LQ_SET_EFX_PROPERTY
-	};
-
-	//! Holds information about a sound action
-	struct SoundAction
-	{
-		Ogre::String	mSound;
-		SOUND_ACTION	mAction;
-		bool			mImmediately;
-		void*			mParams;
+		LQ_SET_EFX_PROPERTY,
+		LQ_PLAY_VOICE
 	};
 
 	//! Holds information about a create sound request.
 	struct cSound
 	{
 		bool mPrebuffer;
-		Ogre::String mFileName;
-		ALuint mBuffer;
 	};
 
 	//! Holds information about a EFX effect.
+	/** Effect and filter names are resolved to OpenAL id's when the request is made.
+	*/
 	struct efxProperty
 	{
-		Ogre::String mEffectName;
-		Ogre::String mFilterName;
+		ALuint mEffect;
+		ALuint mFilter;
 		float mAirAbsorption;
 		float mRolloff;
 		float mConeHF;
 		ALuint mSlotID;
 	};
 
+	//! Holds information about a voice request.
+	struct voiceProperty
+	{
+		float mPosition[3];
+		float mGain;
+		float mPitch;
+	};
+
+	//! A voice instance playing a shared static buffer
+	struct SoundVoice
+	{
+		ALuint mSource;							// Source borrowed from the pool
+		SharedBufferList::iterator mBuffer;		// Shared buffer referenced whilst playing
+		float mPitch;							// Voice pitch before the global pitch is applied
+	};
+	typedef std::vector<SoundVoice> VoiceList;
+
+	//! Holds information about a sound action
+	/** Plain data so it can be copied through the action queue without allocating,
+		the target sound is looked up by its slot in the managers sound table.
+	*/
+	struct SoundAction
+	{
+		unsigned int	mSlot;				// Sound table index
+		unsigned int	mGeneration;		// Sound table generation, stale requests are ignored
+		SOUND_ACTION	mAction;
+		bool			mImmediately;
+		union
+		{
+			cSound		mLoad;
+			efxProperty	mEfx;
+			voiceProperty	mVoice;
+		}				mParams;
+	};
+
+	//! Snapshot of the managers runtime statistics
+	/** Rates, latencies and queue depths cover roughly the last second of updates,
+		everything else is a running total or current count.
+	*/
+	struct SoundStatistics
+	{
+		unsigned int	mActiveSounds;			// Sounds holding a source
+		unsigned int	mWaitingSounds;			// Sounds waiting for a source to start playing
+		unsigned int	mReactivatingSounds;	// Sounds waiting to get a stolen source back
+		unsigned int	mVirtualSounds;			// Sounds playing without a source
+		unsigned int	mVoices;				// Playing voice instances
+		unsigned int	mSourcesFree;			// Sources left in the pool
+		unsigned int	mSourcesTotal;			// Sources allocated
+		unsigned long	mSourcesStolen;			// Sources taken from lower priority/further sounds
+		unsigned long	mStreamUnderruns;		// Times a stream ran dry before its end
+		unsigned long	mStreamRefills;			// Stream buffers refilled
+		float			mDecodeBytesPerSecond;	// Audio data decoded by streams
+		float			mRefillLatency;			// Average time taken to refill a stream buffer (ms)
+		float			mMaxRefillLatency;		// Longest stream buffer refill (ms)
+		unsigned int	mQueuedBuffers;			// Buffers queued across all playing streams
+		unsigned int	mMinQueueDepth;			// Buffers queued on the most starved playing stream
+		unsigned int	mActionQueueHighWater;	// Most actions waiting in the action queue at once
+		unsigned long	mActionsDropped;		// Actions lost to a full action queue
+		unsigned long	mDecodeCacheHits;		// Static sounds loaded from the decode cache
+		unsigned long	mDecodeCacheMisses;		// Static sounds decoded with the decode cache enabled
+	};
+
 	//! Sound Manager: Manages all sounds for an application
 	class _OGGSOUND_EXPORT OgreOggSoundManager : public Ogre::Singleton<OgreOggSoundManager>
 	{
@@ -153,6 +226,56 @@ namespace OgreOggSound
 				Desired size of queue list (optional | Multi-threaded ONLY)
 		 */
 		bool init(const std::string &deviceName = "", unsigned int maxSources=100, unsigned int queueListSize=100, Ogre::SceneManager* sMan=0);
+		/** Initialises an offline loopback device.
+		@remarks
+			Alternative to init() which requires ALC_SOFT_loopback. Nothing is played,
+			instead audio is mixed on demand by renderSamples()/renderToWav() as fast as
+			the CPU allows, so the output depends only on the sounds played and the time
+			rendered. When multi-threaded no streaming thread is started, queued actions
+			and streams are serviced whilst rendering instead.
+			@param frequency
+				Output sample rate.
+			@param channels
+				Output channels, 1 or 2 (16 bit samples).
+			@param maxSources
+				maximum number of sources to allocate (optional)
+			@param queueListSize
+				Desired size of queue list (optional | Multi-threaded ONLY)
+		 */
+		bool initLoopback(unsigned int frequency=44100, unsigned int channels=2, unsigned int maxSources=100, unsigned int queueListSize=100, Ogre::SceneManager* sMan=0);
+		/** Returns whether the manager was initialised with initLoopback()
+		 */
+		inline bool isLoopback() const { return mALCRenderSamples!=0; }
+		/** Gets the sample rate of the loopback device
+		 */
+		inline unsigned int getLoopbackFrequency() const { return mLoopbackFrequency; }
+		/** Gets the number of channels rendered by the loopback device
+		 */
+		inline unsigned int getLoopbackChannels() const { return mLoopbackChannels; }
+		/** Renders audio from the loopback device.
+		@remarks
+			Mixes the requested number of sample frames into a user buffer, servicing
+			streams every LOOPBACK_BLOCK_FRAMES. Sound positions and fades only advance 
+			with update() so call it between renders, see renderToWav(). Returns false 
+			if not initialised with initLoopback().
+			@param buffer
+				Destination for frames * getLoopbackChannels() 16 bit samples.
+			@param frames
+				Number of sample frames to render.
+		 */
+		bool renderSamples(void* buffer, size_t frames);
+		/** Renders audio from the loopback device to a WAV file.
+		@remarks
+			Calls update() for every step of rendered time, so anything driven by
+			the manager (fades, stealing etc.) behaves as it would in real time.
+			@param file
+				Path of the WAV file to write.
+			@param seconds
+				Length of audio to render.
+			@param updateStep
+				Rendered time between update() calls.
+		 */
+		bool renderToWav(const Ogre::String& file, float seconds, float updateStep=1.f/60.f);
 		/** Gets the openal device ptr
 		*/
 		const ALCdevice* getOpenalDevice() { return mDevice; }
@@ -173,6 +296,191 @@ namespace OgreOggSound
 		/** Gets number of currently created sounds
 		 */
 		unsigned int getNumSounds() const { return static_cast<unsigned int>(mSoundMap.size()); }
+		/** Gets the number of stream buffers refilled since initialisation
+		 */
+		inline unsigned long getStreamRefills() const { return mStreamRefills; }
+		/** Gets the number of times a stream ran dry before reaching its end
+		@remarks
+			Each underrun is an audible gap, see OgreOggISound::getUnderrunCount()
+			for the count of a single sound.
+		 */
+		inline unsigned long getStreamUnderruns() const { return mStreamUnderruns; }
+		/** Gets a snapshot of the runtime audio statistics
+		@remarks
+			Intended for telemetry, gathers voice and source counts, stream health 
+			and action queue usage in one call. Queue depths are queried from OpenAL.
+		 */
+		SoundStatistics getStatistics();
+		/** Gets the number of decode buffer allocations made by streamed sounds
+		@remarks
+			Streamed sounds keep their decode buffer between refills, so once all 
+			streams have started this should stay constant whilst getStreamRefills() rises.
+		 */
+		inline unsigned long getDecodeAllocations() const { return mDecodeAllocations; }
+		/** Sets whether static sounds keep their decoded audio data.
+		@remarks
+			By default the decoded data is freed as soon as it has been uploaded
+			to OpenAL. Enable this to access it via OgreOggStaticSound::getAudioData(),
+			only affects sounds loaded afterwards.
+			@param keep
+				Flag to keep data in memory.
+		 */
+		inline void setKeepStaticAudioData(bool keep) { mKeepStaticAudioData=keep; }
+		/** Gets whether static sounds keep their decoded audio data.
+		 */
+		inline bool getKeepStaticAudioData() const { return mKeepStaticAudioData; }
+		/** Sets whether static sounds are stored compressed.
+		@remarks
+			If the device supports AL_EXT_IMA4, mono and stereo static ogg and 
+			PCM wav sounds loaded afterwards are encoded to IMA ADPCM before
+			upload. This needs about a quarter of the memory of 16-bit PCM, with
+			a small loss in quality and negligible cost when mixing. Disabled by default.
+			@param compress
+				Flag to compress static buffers.
+		 */
+		inline void setStaticAudioCompression(bool compress) { mCompressStaticAudio=compress; }
+		/** Gets whether static sounds are stored compressed.
+		 */
+		inline bool getStaticAudioCompression() const { return mCompressStaticAudio; }
+		/** Gets whether IMA ADPCM buffers are supported (AL_EXT_IMA4).
+		 */
+		inline bool hasIma4Support() const { return mIma4Support; }
+		/** Gets whether MS ADPCM buffers are supported (AL_SOFT_MSADPCM).
+		 */
+		inline bool hasMsAdpcmSupport() const { return mMsAdpcmSupport; }
+		/** Gets whether ADPCM buffers may use any block size (AL_SOFT_block_alignment).
+		 */
+		inline bool hasBlockAlignmentSupport() const { return mBlockAlignmentSupport; }
+		/** Sets whether ogg sounds are decoded to 32-bit float.
+		@remarks
+			If the device supports AL_EXT_FLOAT32, ogg sounds opened afterwards are
+			decoded with ov_read_float() and uploaded as float buffers. This skips
+			the decoder's conversion and clipping to 16-bit, at twice the buffer 
+			memory. Static sounds stored compressed are still decoded to 16-bit. 
+			Disabled by default.
+			@param decode
+				Flag to decode to float.
+		 */
+		inline void setFloatDecoding(bool decode) { mFloatDecoding=decode; }
+		/** Gets whether ogg sounds are decoded to 32-bit float.
+		 */
+		inline bool getFloatDecoding() const { return mFloatDecoding; }
+		/** Gets whether float buffers are supported (AL_EXT_FLOAT32).
+		 */
+		inline bool hasFloat32Support() const { return mFloat32Support; }
+		/** Uploads 16-bit PCM to a buffer as IMA ADPCM
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			Returns false without touching the buffer if static audio compression
+			is disabled or unsupported for the format, the caller then uploads PCM.
+			@param buffer
+				Buffer to fill.
+			@param pcm
+				Interleaved 16-bit samples.
+			@param bytes
+				Size of pcm in bytes.
+			@param channels
+				Number of channels.
+			@param rate
+				Sample rate.
+			@param format
+				Receives the buffer format on success.
+		 */
+		bool _bufferCompressed(ALuint buffer, const char* pcm, size_t bytes, int channels, ALsizei rate, ALenum& format);
+		/** Gets the OpenAL format for float data
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			Returns false if float decoding is disabled or the format is unsupported.
+			@param channels
+				Number of channels.
+			@param format
+				Receives the buffer format on success.
+		 */
+		bool _getFloatFormat(int channels, ALenum& format) const;
+		/** Notifies the manager a stream buffer was refilled
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+		 */
+		void _notifyStreamRefill(size_t bytes, unsigned long startTime);
+		/** Notifies the manager a stream ran dry before its end
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+		 */
+		inline void _notifyStreamUnderrun() { ++mStreamUnderruns; }
+		/** Gets a timestamp for measuring refill latency
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+		 */
+		inline unsigned long _getStatisticsTime() { return mStatisticsTimer.getMicroseconds(); }
+		/** Notifies the manager a decode buffer was allocated
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+		 */
+		inline void _notifyDecodeAllocation() { ++mDecodeAllocations; }
+		/** Gets the number of OpenAL state calls submitted by the last update
+		@remarks
+			Counts the source and listener property calls flushed during one
+			update tick, only values changed since the previous tick are sent.
+		 */
+		inline unsigned int getALCallsPerFrame() const { return mALCallsPerFrame; }
+		/** Gets whether state changes are submitted atomically
+		@remarks
+			Returns true if AL_SOFT_deferred_updates is available, in which case
+			each update ticks property changes are applied together.
+		 */
+		inline bool hasDeferredUpdates() const { return mALDeferUpdates!=0; }
+		/** Notifies the manager of OpenAL state calls made
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+		 */
+		inline void _notifyALCalls(unsigned int calls) { mALCalls+=calls; }
+		/** Gets whether buffers can be filled in blocks
+		@remarks
+			Returns true if AL_SOFT_buffer_sub_data is available, static WAV
+			sounds then upload their data without reading it all into memory.
+		 */
+		inline bool hasBufferSubData() const { return mALBufferSubData!=0; }
+		/** Fills part of a buffer using AL_SOFT_buffer_sub_data
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+		 */
+		inline void _bufferSubData(ALuint buffer, ALenum format, const ALvoid* data, ALsizei offset, ALsizei length) { mALBufferSubData(buffer, format, data, offset, length); }
+		/** Gets the location on disk of an audio file
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			Returns false unless the file is found in a FileSystem archive.
+			@param file
+				Resource name of the audio file.
+			@param path
+				Receives the path on disk.
+		 */
+		bool _getResourcePath(const Ogre::String& file, Ogre::String& path) const;
+		/** Gets the key identifying an audio file in the decode cache
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			Combines the file name, size and modification time. Where the archive
+			can't supply a time the contents are hashed instead, the stream is
+			returned to its start afterwards.
+			@param file
+				Resource name of the audio file.
+			@param stream
+				Opened audio file.
+		 */
+		Ogre::String _getDecodeCacheKey(const Ogre::String& file, Ogre::DataStreamPtr& stream) const;
+		/** Looks up decoded audio in the decode cache
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			Thread safe version of OgreOggSoundDecodeCache::find() for the
+			preload threads, returns NULL if there is no cache.
+		 */
+		const char* _findDecodeCache(const Ogre::String& key, int channels, long rate, OgreOggMappedFile& file, size_t& size);
+		/** Stores decoded audio in the decode cache
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			Thread safe version of OgreOggSoundDecodeCache::store() for the
+			preload threads, does nothing if there is no cache.
+		 */
+		void _storeDecodeCache(const Ogre::String& key, int channels, long rate, const char* data, size_t size);
 		/** Gets the current global volume for all sounds
 		 */
 		ALfloat getMasterVolume();
@@ -206,6 +514,13 @@ namespace OgreOggSound
 				Sound name.
 		 */
 		OgreOggISound *getSound(const std::string& name);
+		/** Gets a sound by handle.
+		@remarks
+			Returns the sound object if the handle is still valid, NULL otherwise.
+			@param handle 
+				Sound handle, see OgreOggISound::getHandle().
+		 */
+		OgreOggISound *getSoundByHandle(SoundHandle handle);
 		/** Gets list of created sounds.
 		@remarks
 			Returns a vector of sound name strings.
@@ -218,6 +533,37 @@ namespace OgreOggSound
 				Sound name.
 		 */
 		bool hasSound(const std::string& name);
+		/** Returns whether a sound handle is still valid.
+		@remarks
+			Handles become invalid once their sound is destroyed.
+			@param handle 
+				Sound handle.
+		 */
+		bool hasSoundByHandle(SoundHandle handle);
+		/** Plays a sound by handle.
+		@remarks
+			Queues the request without looking the sound up, stale handles
+			are ignored.
+			@param handle 
+				Sound handle.
+			@param immediate 
+				Optional flag to indicate action should be implemented immediately. (MULTI-THREADED ONLY)
+		 */
+		void playSoundByHandle(SoundHandle handle, bool immediate=false);
+		/** Pauses a sound by handle.
+			@param handle 
+				Sound handle.
+			@param immediate 
+				Optional flag to indicate action should be implemented immediately. (MULTI-THREADED ONLY)
+		 */
+		void pauseSoundByHandle(SoundHandle handle, bool immediate=false);
+		/** Stops a sound by handle.
+			@param handle 
+				Sound handle.
+			@param immediate 
+				Optional flag to indicate action should be implemented immediately. (MULTI-THREADED ONLY)
+		 */
+		void stopSoundByHandle(SoundHandle handle, bool immediate=false);
 		/** Sets the pitch of all sounds.
 		@remarks
 			Sets the pitch modifier applied to all sounds.
@@ -267,6 +613,200 @@ namespace OgreOggSound
 				Sound name to destroy.
 		 */
 		void destroySound(OgreOggISound* sound);
+		/** Destroys a single sound.
+		@remarks
+			Destroys a single sound object, stale handles are ignored.
+			@param handle 
+				Handle of sound to destroy.
+		 */
+		void destroySoundByHandle(SoundHandle handle);
+		/** Preloads a batch of static sounds.
+		@remarks
+			Decodes the files on a pool of worker threads, the audio data is then 
+			uploaded to shared buffers so subsequent static sounds created from these
+			files load instantly. The manager holds a reference to each buffer until
+			unloadPreloadedSound() is called. When multi-threaded this returns immediately
+			and the listener is called from the streaming thread as files complete,
+			otherwise files are decoded and uploaded before returning. Buffers match a
+			static sound loaded directly, including float decoding, static compression
+			and the decode cache.
+			@param files
+				Audio files to preload.
+			@param listener
+				Callback object notified of progress (optional).
+		 */
+		void preloadSounds(const Ogre::StringVector& files, PreloadListener* listener=0);
+		/** Releases the managers reference to a preloaded sound.
+		@remarks
+			The shared buffer is destroyed once no sounds are using it.
+			@param file
+				Audio file passed to preloadSounds().
+		 */
+		bool unloadPreloadedSound(const std::string& file);
+		/** Sets the number of threads used to decode preloaded sounds.
+		@remarks
+			Must be set before the first call to preloadSounds(), 0 uses one 
+			thread per hardware thread (Multi-threaded ONLY).
+			@param num
+				Number of decode threads.
+		 */
+		inline void setPreloadThreadCount(unsigned int num) { mPreloadThreads=num; }
+		/** Keeps the compressed data of an audio file in memory.
+		@remarks
+			Sounds created from the file afterwards, streamed or static, read from
+			a single copy in memory shared by all of them instead of the archive.
+			A streamed ogg then costs its compressed size once plus each sounds 
+			stream buffers, around a tenth of holding it decoded, without any disk
+			access during playback. Suits long sounds played often such as 
+			ambience and dialogue.
+			@param file
+				Audio file to keep in memory.
+		 */
+		bool loadCompressedSound(const Ogre::String& file);
+		/** Releases the in memory copy of an audio file.
+		@remarks
+			Sounds already using the copy keep it until they are destroyed.
+			@param file
+				Audio file passed to loadCompressedSound().
+		 */
+		bool unloadCompressedSound(const Ogre::String& file);
+		/** Gets whether an audio file is held in memory.
+		@param file
+			Audio file name.
+		 */
+		bool isCompressedSoundLoaded(const Ogre::String& file);
+		/** Gets the total size of audio files held in memory in bytes.
+		 */
+		inline size_t getCompressedSoundMemory() const { return mCompressedSoundMemory; }
+		/** Sets the number of threads used to decode streams ahead.
+		@remarks
+			Must be set before setStreamDecodeAhead() is first called, 0 uses one 
+			thread per hardware thread (Multi-threaded ONLY).
+			@param num
+				Number of decode threads.
+		 */
+		inline void setStreamDecodeThreadCount(unsigned int num) { mStreamDecodeThreads=num; }
+		/** Plays a voice instance of a loaded static sound.
+		@remarks
+			Voices are fire-and-forget copies of a static sound which share its 
+			audio buffer, they have no MovableObject, name or sound table entry.
+			A voice only uses a free source from the pool, it never steals from 
+			a sound and is silently dropped when none are available. The source
+			is returned once the voice finishes, the sound itself may be destroyed 
+			whilst its voices are still playing. Attenuation settings are copied 
+			from the sound.
+			@param handle
+				Handle of a loaded static sound.
+			@param pos
+				World position to play at.
+			@param gain
+				Voice gain.
+			@param pitch
+				Voice pitch, scaled by the global pitch.
+		 */
+		void playVoice(SoundHandle handle, const Ogre::Vector3& pos, float gain=1.f, float pitch=1.f);
+		/** Gets the number of voices currently playing.
+		 */
+		unsigned int getNumVoices() const { return static_cast<unsigned int>(mVoices.size()); }
+		/** Sets whether sounds can play virtually.
+		@remarks
+			When enabled a sound which loses its source, or can't get one when 
+			played, carries on playing virtually instead of being paused or queued.
+			Its play position advances without using a source and each update
+			the most audible virtual sound is given a source, at the correct 
+			position, when one is free or it is more audible than a playing sound.
+			Only seekable sounds of known length can be virtual. Disabled by default.
+			@param enable
+				Flag to enable virtual sounds.
+		 */
+		inline void setVirtualVoices(bool enable) { mVirtualVoices=enable; }
+		/** Gets whether sounds can play virtually.
+		 */
+		inline bool getVirtualVoices() const { return mVirtualVoices; }
+		/** Gets the number of sounds currently playing virtually.
+		 */
+		unsigned int getNumVirtualSounds() const { return static_cast<unsigned int>(mVirtualSounds.size()); }
+		/** Makes a sound play without a source.
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			@param sound
+				Sound without a source.
+			@param playPos
+				Position to continue playing from.
+		 */
+		bool _virtualiseSound(OgreOggISound* sound, float playPos);
+		/** Removes a sound from the virtual list.
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			@param sound
+				Virtual sound.
+		 */
+		void _removeVirtualSound(OgreOggISound* sound);
+		/** Sets the memory budget for unused shared buffers.
+		@remarks
+			Static buffers no longer used by any sound are kept resident, least 
+			recently used first out, until their total size exceeds this budget. 
+			Recreating a sound from a cached buffer doesn't touch the file at all.
+			Defaults to 0, which frees buffers as soon as they are unused.
+			@param bytes
+				Maximum size of cached audio data in bytes.
+		 */
+		void setSharedBufferBudget(size_t bytes);
+		/** Gets the memory budget for unused shared buffers.
+		 */
+		inline size_t getSharedBufferBudget() const { return mSharedBufferBudget; }
+		/** Gets the size of unused shared buffers currently cached in bytes.
+		 */
+		inline size_t getSharedBufferCacheSize() const { return mSharedBufferCacheSize; }
+		/** Gets the number of static sounds loaded from an existing shared buffer.
+		 */
+		inline unsigned long getSharedBufferHits() const { return mSharedBufferHits; }
+		/** Gets the number of static sounds which had to load their file.
+		 */
+		inline unsigned long getSharedBufferMisses() const { return mSharedBufferMisses; }
+		/** Gets the number of unused shared buffers freed to stay within budget.
+		 */
+		inline unsigned long getSharedBufferEvictions() const { return mSharedBufferEvictions; }
+		/** Enables a persistent cache of decoded static audio.
+		@remarks
+			Static ogg sounds store their decoded PCM data in this directory and
+			later loads, including in future runs, map it instead of decoding
+			the file again. Entries are keyed on the file name, size and 
+			modification time so edited files are decoded afresh. The least 
+			recently used entries are deleted to keep within the size limit.
+			Disabled by default, should be set before any sounds are loaded.
+			@param directory
+				Existing writable directory to hold the cache, empty disables it.
+			@param maxBytes
+				Maximum size of the cache on disk in bytes.
+		 */
+		void setDecodeCache(const Ogre::String& directory, size_t maxBytes=256*1024*1024);
+		/** Gets the decode cache
+		@remarks
+			Returns 0 if no cache directory has been set.
+		 */
+		inline OgreOggSoundDecodeCache* getDecodeCache() const { return mDecodeCache; }
+		/** Sets how far ahead ogg streams decode.
+		@remarks
+			Each ogg stream opened afterwards keeps up to this much decoded audio
+			in a ring, filled by a pool of decode threads, so refilling a buffer
+			is only a copy and upload. Hides decoding spikes from the buffer queue
+			at the cost of rate * channels * 2 bytes per second of lead per stream.
+			The ring is a power of two in size so the lead is rounded down to one,
+			with a minimum of 32KB. Defaults to 0, which decodes on the streaming thread as buffers empty.
+			@param seconds
+				Audio to decode ahead in seconds.
+		 */
+		void setStreamDecodeAhead(float seconds);
+		/** Gets how far ahead ogg streams decode in seconds.
+		 */
+		inline float getStreamDecodeAhead() const { return mStreamDecodeAhead; }
+		/** Gets the stream decoder
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+			Returns 0 until decode-ahead is first enabled.
+		 */
+		inline OgreOggStreamDecoder* _getStreamDecoder() const { return mStreamDecoder; }
 		/** Destroys a temporary sound implementation
 		@remarks
 			Internal use only.
@@ -584,6 +1124,19 @@ namespace OgreOggSound
 				name of filter as defined when created
 		 */
 		bool _attachEffectToSoundImpl(OgreOggISound* sound=0, ALuint slot=255, const Ogre::String& effect="", const Ogre::String& filter="");
+		/** Attaches an effect to a sound
+		@remarks
+			As above but takes previously resolved OpenAL id's.
+			@param sound 
+				sound pointer
+			@param slot 
+				slot ID
+			@param effect 
+				OpenAL effect id
+			@param filter 
+				OpenAL filter id
+		 */
+		bool _attachEffectToSoundImpl(OgreOggISound* sound, ALuint slot, ALuint effect, ALuint filter);
 		/** Attaches a filter to a sound
 		@remarks
 			Currently sound must have a source attached prior to this call.
@@ -593,6 +1146,15 @@ namespace OgreOggSound
 				name of filter as defined when created
 		 */
 		bool _attachFilterToSoundImpl(OgreOggISound* sound=0, const Ogre::String& filter="");
+		/** Attaches a filter to a sound
+		@remarks
+			As above but takes a previously resolved OpenAL id.
+			@param sound 
+				sound pointer
+			@param filter 
+				OpenAL filter id
+		 */
+		bool _attachFilterToSoundImpl(OgreOggISound* sound, ALuint filter);
 		/** Detaches all effects from a sound
 		@remarks
 			Currently sound must have a source attached prior to this call.
@@ -656,6 +1218,27 @@ namespace OgreOggSound
 				Flag indicating status of mForceMutex var.
 		*/
 		inline void setForceMutex(bool on) { mForceMutex=on; }
+		/** Sets the longest time the streaming thread may sleep between updates.
+		@remarks
+			The streaming thread sleeps until the earliest active stream needs refilling,
+			or until a new action is queued, but never longer than this limit. As sound
+			positions and fades are also applied by the streaming thread this effectively
+			bounds their update latency. Default: 50ms.
+			@param ms
+				Maximum sleep time in milliseconds.
+		*/
+		inline void setStreamingMaxSleep(unsigned int ms) { mStreamingMaxSleep = ms>0 ? ms : 1; }
+		/** Gets the longest time the streaming thread may sleep between updates.
+		 */
+		inline unsigned int getStreamingMaxSleep() const { return mStreamingMaxSleep; }
+		/** Gets the number of times the streaming thread has woken up.
+		 */
+		inline unsigned long getStreamingWakeups() const { return mStreamingWakeups; }
+		/** Gets the number of wakeups saved compared to polling every 10ms.
+		@remarks
+			Calculated from the time the streaming thread has been running.
+		 */
+		unsigned long getStreamingWakeupsSaved() const;
 #endif
  
 	private:
@@ -673,6 +1256,11 @@ namespace OgreOggSound
 			Iterates all sounds and updates their buffers.
 		 */
 		void _updateBuffers();
+		/** Updates all sound buffers.
+		@param fTime
+			Time since last update.
+		 */
+		void _updateBuffers(float fTime);
 
 		LocklessQueue<SoundAction>* mActionsList;
 
@@ -690,6 +1278,38 @@ namespace OgreOggSound
 #endif
 		static bool mShuttingDown;
 
+		/** Wakes the streaming thread.
+		@remarks
+			Called whenever new work is queued so the streaming thread doesn't
+			sit out the remainder of its sleep before processing it. Queued 
+			actions only call this whilst the thread is waiting.
+		 */
+		void _notifyStreamingThread();
+		/** Blocks the streaming thread until woken or timed out.
+		@param ms
+			Maximum time to wait in milliseconds.
+		 */
+		void _waitForStreamingWork(unsigned int ms);
+		/** Calculates how long the streaming thread can sleep for.
+		@remarks
+			Queries all active sounds for the time until they next need
+			servicing and returns the earliest, in milliseconds, clamped
+			to mStreamingMaxSleep.
+		 */
+		unsigned int _getStreamingSleepTime();
+
+		unsigned int mStreamingMaxSleep;		// Upper limit on streaming thread sleep (ms)
+		std::atomic<unsigned long> mStreamingWakeups;	// Number of times streaming thread has woken, read from other threads
+		std::atomic<bool> mStreamingSleeping;	// Streaming thread is waiting and needs notifying of new actions
+		mutable Ogre::Timer mStreamingTimer;	// Time since streaming thread started
+#ifdef POCO_THREAD
+		static Poco::Event mStreamingEvent;
+#else
+		static boost::mutex mStreamingWakeMutex;
+		static boost::condition_variable mStreamingWakeCondition;
+		static bool mStreamingWakePending;
+#endif
+
 		/** Flag indicating that a mutex should be used whenever an action is requested.
 		@remarks
 			In certain instances user may require that an action is performed inline,
@@ -716,25 +1336,31 @@ namespace OgreOggSound
 			buffers aren't constantly re-filled the sound will be automatically
 			stopped by OpenAL. Static sounds do not suffer this problem because all the
 			audio data is preloaded into memory.
+			Rather than polling at a fixed rate the thread sleeps until the
+			earliest stream needs refilling or a new action is queued.
 		 */
 		static void threadUpdate()
 		{
+			OGGSOUND_PROFILE_THREAD("OgreOggSound streaming");
+
+			OgreOggSoundManager* mgr = OgreOggSoundManager::getSingletonPtr();
+			mgr->mStreamingTimer.reset();
+
 			while(!mShuttingDown)
-			{	
+			{
+				unsigned int sleepTime;
 				{
 #ifdef POCO_THREAD
-					Poco::Mutex::ScopedLock l(OgreOggSoundManager::getSingletonPtr()->mMutex);
+					Poco::Mutex::ScopedLock l(mgr->mMutex);
 #else
-					boost::recursive_mutex::scoped_lock lock(OgreOggSoundManager::getSingletonPtr()->mMutex);
+					boost::recursive_mutex::scoped_lock lock(mgr->mMutex);
 #endif
-					OgreOggSoundManager::getSingletonPtr()->_updateBuffers();
-					OgreOggSoundManager::getSingletonPtr()->_processQueuedSounds();
+					mgr->_updateBuffers();
+					mgr->_processQueuedSounds();
+					mgr->_processPreloadedSounds();
+					sleepTime = mgr->_getStreamingSleepTime();
 				}
-#ifdef POCO_THREAD
-				Poco::Thread::sleep(10);
-#else
-				boost::this_thread::sleep(boost::posix_time::milliseconds(10));
-#endif
+				mgr->_waitForStreamingWork(sleepTime);
 			}
 		}
 #endif
@@ -779,6 +1405,47 @@ namespace OgreOggSound
 			Prebuffer flag.
 		*/
 		void _loadSoundImpl(OgreOggISound* sound, const Ogre::String& file, bool prebuffer);
+		/** Gets the in memory copy of an audio file.
+		@remarks
+			Returns a null pointer if the file isn't held in memory.
+			@param file
+				Audio file name.
+		 */
+		Ogre::MemoryDataStreamPtr _getCompressedSound(const Ogre::String& file);
+		/** Adds a sound to the sound table.
+		@remarks
+			Assigns the sound a slot which action requests use to find it 
+			without a name lookup. Must be called with the sound mutex held.
+			@param sound
+				Sound to add.
+		 */
+		void _addSoundSlot(OgreOggISound* sound);
+		/** Removes a sound from the sound table.
+		@remarks
+			Bumps the slots generation so any queued requests for the sound
+			are ignored. Must be called with the sound mutex held.
+			@param sound
+				Sound to remove.
+		 */
+		void _releaseSoundSlot(OgreOggISound* sound);
+		/** Gets a sound from the sound table.
+		@remarks
+			Returns 0 if the slot has since been released or reused.
+			@param slot
+				Sound table index.
+			@param generation
+				Generation of the slot when the sound was added.
+		 */
+		OgreOggISound* _getSoundFromSlot(unsigned int slot, unsigned int generation);
+		/** Performs a sound action by handle.
+			@param handle
+				Sound handle.
+			@param action
+				Action to perform (LQ_PLAY | LQ_PAUSE | LQ_STOP).
+			@param immediate
+				Immediate flag.
+		 */
+		void _soundActionByHandle(SoundHandle handle, SOUND_ACTION action, bool immediate);
 		/** Destroys a single sound.
 		@remarks
 			Destroys a single sound object.
@@ -805,6 +1472,72 @@ namespace OgreOggSound
 		/** Stops all currently playing sounds.
 		 */
 		void _stopAllSoundsImpl();
+		/** Starts a voice instance of a sound.
+		@param sound
+			Loaded static sound.
+		@param pos
+			World position.
+		@param gain
+			Voice gain.
+		@param pitch
+			Voice pitch.
+		 */
+		void _playVoiceImpl(OgreOggISound* sound, const Ogre::Vector3& pos, float gain, float pitch);
+		/** Returns the sources of finished voices to the pool.
+		 */
+		void _updateVoices();
+		/** Stops a voice and releases its source and buffer.
+		@param voice
+			Voice to release.
+		 */
+		void _releaseVoice(SoundVoice& voice);
+		/** Returns whether a sound is able to play virtually.
+		 */
+		static bool _canVirtualise(const OgreOggISound* sound);
+		/** Updates virtual sounds.
+		@remarks
+			Advances virtual play positions and gives the most audible 
+			virtual sound a source if it can get one.
+			@param fTime
+				Elapsed time in seconds.
+		 */
+		void _updateVirtualSounds(float fTime);
+		/** Creates the context and everything else needed once a device is open.
+		@param attribs
+			Zero terminated context attributes.
+			@param queueListSize
+				Desired size of queue list (Multi-threaded ONLY)
+			@param scnMgr
+				Default SceneManager, first found if NULL.
+		 */
+		bool _initContext(const ALCint* attribs, unsigned int queueListSize, Ogre::SceneManager* scnMgr);
+		/** Services streams between loopback render blocks.
+		@param fTime
+			Rendered time since last call.
+		 */
+		void _serviceLoopback(float fTime);
+		/** Writes a little endian value.
+		 */
+		static void _writeLE(unsigned char* dest, unsigned int value, int bytes);
+		/** Starts batching OpenAL state changes for an update tick
+		@remarks
+			Suspends processing of property changes if AL_SOFT_deferred_updates
+			is available.
+		 */
+		void _deferStateUpdates();
+		/** Applies all OpenAL state changes batched this tick
+		@remarks
+			Also records the number of state calls made for getALCallsPerFrame().
+		 */
+		void _processStateUpdates();
+		/** Rolls the statistics window over
+		@remarks
+			Publishes decode rate and refill latency once a second of 
+			updates has been gathered.
+			@param fTime
+				Elapsed time in seconds.
+		 */
+		void _updateStatistics(float fTime);
 		/** Applys global pitch.
 		 */
 		void _setGlobalPitchImpl();
@@ -834,11 +1567,47 @@ namespace OgreOggSound
 				Name of audio file
 		 */
 		sharedAudioBuffer* _getSharedBuffer(const Ogre::String& sName);
+		/** Adds a reference to a shared buffer.
+		@remarks
+			Takes the buffer out of the unused cache if necessary.
+			@param buffer
+				Shared buffer
+		 */
+		void _addSharedBufferRef(sharedAudioBuffer* buffer);
+		/** Frees unused shared buffers until the cache fits the budget.
+		@param budget
+			Size in bytes to shrink the cache to.
+		 */
+		void _trimSharedBufferCache(size_t budget);
+		/** Looks up the archive entry of an audio file.
+		@param file
+			Resource name of the audio file.
+		@param info
+			Receives the archive entry.
+		 */
+		bool _findResourceFileInfo(const Ogre::String& file, Ogre::FileInfo& info) const;
 		/** Opens the specified file as a new data stream.
 			@param file
 				The path to the resource file to open.
 		 */
 		Ogre::DataStreamPtr _openStream(const Ogre::String& file) const;
+		/** Uploads any sounds decoded by the preloader.
+		@remarks
+			Must be called on the thread owning the OpenAL context.
+		 */
+		void _processPreloadedSounds();
+		/** Uploads a decoded sound into a shared buffer.
+		@param sound
+			Decoded sound, mError is set on failure.
+		 */
+		bool _uploadPreloadedSound(PreloadedSound& sound);
+		/** Gets the OpenAL format for PCM data.
+		@param channels
+			Number of channels.
+		@param bitsPerSample
+			8/16 bit samples.
+		 */
+		ALenum _getPCMFormat(unsigned short channels, unsigned short bitsPerSample) const;
 		/** Releases all sounds and buffers
 		@remarks
 			Release all sounds and their associated OpenAL objects
@@ -920,6 +1689,48 @@ namespace OgreOggSound
 		/** Calculates the distance a sound is from the specified listener position.
 		 */
 		static Ogre::Real _calculateDistanceToListener(OgreOggISound * sound, const Ogre::Vector3 & listenerPos);
+		/** Adds a sound to the active list and source heap.
+		@param sound
+			Sound which has been given a source.
+		 */
+		void _addActiveSound(OgreOggISound* sound);
+		/** Removes a sound from the active list and source heap.
+		@param sound
+			Sound which has lost its source.
+		 */
+		void _removeActiveSound(OgreOggISound* sound);
+		/** Returns whether a sound is in the active list.
+		 */
+		bool _isActiveSound(OgreOggISound* sound) const;
+		/** Caches the values a sound is ordered by in the source heap.
+		@param sound
+			Active sound.
+		@param listenerPos
+			Position of the listener.
+		 */
+		static void _updateSourceHeapKey(OgreOggISound* sound, const Ogre::Vector3& listenerPos);
+		/** Returns whether a sound should lose its source before another.
+		@remarks
+			Stopped sounds go first, then the lowest priority, then the furthest away.
+		 */
+		static bool _isBetterSourceVictim(const OgreOggISound* a, const OgreOggISound* b);
+		/** Moves a heap entry towards the top.
+		 */
+		void _sourceHeapSiftUp(size_t index);
+		/** Moves a heap entry towards the bottom.
+		 */
+		void _sourceHeapSiftDown(size_t index);
+		/** Refreshes changed keys and reorders the source heap.
+		@remarks
+			Called once per update so stealing a source doesn't need to
+			scan or sort the active list. Only sounds whose position, priority
+			or stopped state changed are re-keyed and sifted, the whole heap
+			is only rebuilt when the listener moves as every distance changes.
+		 */
+		void _updateSourceHeap();
+		/** Gets the active sound which should give up its source first.
+		 */
+		OgreOggISound* _getSourceHeapTop();
 
 		/**
 		 * OpenAL device objects
@@ -932,13 +1743,24 @@ namespace OgreOggSound
 		/** Sound lists
 		 */
 		SoundMap mSoundMap;						// Map of all sounds
+		SoundSlotList mSoundSlots;				// Table of all sounds indexed by slot
+		std::vector<unsigned int> mFreeSoundSlots;	// List of unused slots
 		ActiveList mActiveSounds;				// list of sounds currently active
+		std::vector<OgreOggISound*> mSourceHeap;	// Active sounds ordered by which should lose its source first
+		std::vector<OgreOggISound*> mSourceHeapDirty;	// Heap entries awaiting a re-key
+		Ogre::Vector3 mSourceHeapListenerPos;	// Listener position the heap distances were keyed against
 		ActiveList mPausedSounds;				// list of sounds currently paused
 		ActiveList mSoundsToReactivate;			// list of sounds that need re-activating when sources become available
 		ActiveList mWaitingSounds;				// list of sounds that need playing when sources become available
 		SourceList mSourcePool;					// List of available sources
 		FeatureList mEFXSupportList;			// List of supported EFX effects by OpenAL ID
 		SharedBufferList mSharedBuffers;		// List of shared static buffers
+		SharedBufferCache mSharedBufferCache;	// Unused shared buffers, most recently used first
+		size_t mSharedBufferBudget;				// Maximum bytes of unused shared buffers to keep
+		size_t mSharedBufferCacheSize;			// Bytes of unused shared buffers kept
+		unsigned long mSharedBufferHits;		// Static sounds loaded from a shared buffer
+		unsigned long mSharedBufferMisses;		// Static sounds loaded from file
+		unsigned long mSharedBufferEvictions;	// Unused shared buffers freed to stay within budget
 
 		/** Fading vars
 		*/																  
@@ -953,12 +1775,74 @@ namespace OgreOggSound
 
 		float mGlobalPitch;						// Global pitch modifier
 
+		std::atomic<unsigned long> mStreamRefills;		// Number of stream buffers refilled
+		std::atomic<unsigned long> mDecodeAllocations;	// Number of decode buffers allocated by streams
+		std::atomic<unsigned long> mStreamUnderruns;	// Number of times a stream ran dry
+		std::atomic<unsigned long> mSourcesStolen;		// Number of sources taken from other sounds
+		std::atomic<size_t> mActionQueueHighWater;		// Most actions queued at once, written from any thread
+		std::atomic<unsigned long> mActionsDropped;		// Actions lost to a full queue, written from any thread
+		Ogre::Timer mStatisticsTimer;			// Times stream refills
+		float mStatisticsWindow;				// Time gathered in the current window
+		unsigned long mWindowDecodeBytes;		// Bytes decoded in the current window
+		unsigned long mWindowRefills;			// Refills made in the current window
+		unsigned long mWindowRefillTime;		// Total refill time in the current window (us)
+		unsigned long mWindowMaxRefillTime;		// Longest refill in the current window (us)
+		float mDecodeBytesPerSecond;			// Decode rate over the last window
+		float mRefillLatency;					// Average refill time over the last window (ms)
+		float mMaxRefillLatency;				// Longest refill over the last window (ms)
+		bool mKeepStaticAudioData;				// Flag to keep decoded static audio data after upload
+		bool mCompressStaticAudio;				// Flag to encode static audio to IMA ADPCM
+		bool mIma4Support;						// AL_EXT_IMA4 available
+		bool mMsAdpcmSupport;					// AL_SOFT_MSADPCM available
+		bool mBlockAlignmentSupport;			// AL_SOFT_block_alignment available
+		bool mFloatDecoding;					// Flag to decode ogg sounds to float
+		bool mFloat32Support;					// AL_EXT_FLOAT32 available
+
+		/**	AL_SOFT_deferred_updates Support
+		*/
+		typedef void (AL_APIENTRY *LPALDEFERUPDATESSOFT)(void);
+		typedef void (AL_APIENTRY *LPALPROCESSUPDATESSOFT)(void);
+
+		LPALDEFERUPDATESSOFT mALDeferUpdates;
+		LPALPROCESSUPDATESSOFT mALProcessUpdates;
+
+		/**	AL_SOFT_buffer_sub_data Support
+		*/
+		typedef void (AL_APIENTRY *LPALBUFFERSUBDATASOFT)(ALuint, ALenum, const ALvoid*, ALsizei, ALsizei);
+
+		LPALBUFFERSUBDATASOFT mALBufferSubData;
+		unsigned int mALCalls;					// State calls made during the current tick
+		unsigned int mALCallsPerFrame;			// State calls made during the last tick
+
+		/**	ALC_SOFT_loopback Support
+		*/
+		typedef ALCdevice* (ALC_APIENTRY *LPALCLOOPBACKOPENDEVICESOFT)(const ALCchar*);
+		typedef ALCboolean (ALC_APIENTRY *LPALCISRENDERFORMATSUPPORTEDSOFT)(ALCdevice*, ALCsizei, ALCenum, ALCenum);
+		typedef void (ALC_APIENTRY *LPALCRENDERSAMPLESSOFT)(ALCdevice*, ALCvoid*, ALCsizei);
+
+		LPALCRENDERSAMPLESSOFT mALCRenderSamples;	// Set when rendering through a loopback device
+		unsigned int mLoopbackFrequency;		// Loopback sample rate
+		unsigned int mLoopbackChannels;			// Loopback channel count
+
+		OgreOggSoundPreloader* mPreloader;		// Decodes batches of static sounds
+		OgreOggSoundDecodeCache* mDecodeCache;	// Decoded static audio kept on disk
+		OgreOggStreamDecoder* mStreamDecoder;	// Decodes streams ahead of their buffer queue
+		float mStreamDecodeAhead;				// Seconds of audio streams decode ahead
+		unsigned int mStreamDecodeThreads;		// Number of stream decode threads
+		unsigned int mPreloadThreads;			// Number of preloader decode threads
+		std::set<std::string> mPreloadedSounds;	// Shared buffers referenced by preloadSounds()
+
+		typedef std::map<Ogre::String, Ogre::MemoryDataStreamPtr> CompressedSoundMap;
+		CompressedSoundMap mCompressedSounds;	// Audio files held in memory
+		size_t mCompressedSoundMemory;			// Total size of audio files held in memory
+
+		VoiceList mVoices;						// Playing voice instances
+
+		ActiveList mVirtualSounds;				// Sounds playing without a source
+		bool mVirtualVoices;					// Flag allowing sounds to play without a source
+
 		OgreOggSoundRecord* mRecorder;			// recorder object
 
-		//! sorts sound list by distance
-		struct _sortNearToFar;
-		//! sorts sound list by distance
-		struct _sortFarToNear;
 
 #if HAVE_EFX
 		/**	EFX Support
@@ -1046,5 +1930,6 @@ namespace OgreOggSound
 		OgreOggListener *mListener;				// Listener object
 
 		friend class OgreOggSoundFactory;
+		friend class OgreOggSoundPreloader;
 	};
 }
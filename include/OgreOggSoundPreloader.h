@@ -0,0 +1,217 @@
+/**
+* @file OgreOggSoundPreloader.h
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE. 
+*
+* @section DESCRIPTION
+* 
+* Decodes batches of static sounds on a pool of worker threads
+*/
+
+#pragma once
+
+#include "OgreOggSoundPrereqs.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+#		include "Poco/Thread.h"
+#		include "Poco/Runnable.h"
+#		include "Poco/Mutex.h"
+#		include "Poco/Event.h"
+#	else 
+#		include <boost/thread/thread.hpp>
+#		include <boost/thread/mutex.hpp>
+#		include <boost/thread/condition_variable.hpp>
+#	endif
+#endif
+
+namespace OgreOggSound
+{
+	//! Preload callback
+	/** Provides hooks into a preloadSounds() request.
+	@remarks
+		When multi-threaded these are called from the streaming thread.
+	*/
+	class _OGGSOUND_EXPORT PreloadListener
+	{
+	public:
+
+		/** constructor 
+		*/
+		PreloadListener(){}
+		/** destructor 
+		*/
+		virtual ~PreloadListener(){}
+		/** Called when a file has been uploaded to a shared buffer or failed to load
+		*/
+		virtual void soundPreloaded(const Ogre::String& file, bool success) {}
+		/** Called once every file in the request has been handled
+		*/
+		virtual void preloadFinished() {}
+
+	};
+
+	//! Holds a preloadSounds() request
+	struct PreloadBatch
+	{
+		PreloadListener* mListener;		// Callback object, may be 0
+		unsigned int mRemaining;		// Files not yet uploaded
+	};
+
+	//! Holds a decoded static sound waiting to be uploaded
+	struct PreloadedSound
+	{
+		PreloadedSound() :
+			 mBatch(0)
+			,mChannels(0)
+			,mBitsPerSample(0)
+			,mSampleRate(0)
+			,mFloatChannels(0)
+			,mFloat(false)
+			,mSuccess(false)
+		{ }
+
+		Ogre::String mFile;				// Audio file name
+		Ogre::DataStreamPtr mStream;	// Opened file, released once decoded
+		Ogre::String mCacheKey;			// Decode cache key, empty if not caching
+		PreloadBatch* mBatch;			// Owning request
+		std::vector<char> mData;		// Decoded PCM data
+		unsigned short mChannels;		// Number of channels
+		unsigned short mBitsPerSample;	// 8/16 bit samples
+		unsigned int mSampleRate;		// Samples per second
+		unsigned int mFloatChannels;	// Bit per channel count with a float format, 0 to decode to 16 bit
+		bool mFloat;					// Flag indicating data is 32 bit float
+		bool mSuccess;					// Flag indicating data was decoded
+		Ogre::String mError;			// Reason decoding failed
+	};
+
+	//! Static sound preloader
+	/** Decodes Ogg/Wav files into PCM on a pool of worker threads.
+	@remarks
+		Decoded sounds are collected by the manager which uploads them to 
+		OpenAL on the thread owning the context. Without threading support 
+		files are decoded inline when requested. Ogg files use the decode 
+		cache and float output the same as a static sound loaded directly,
+		compression is applied when uploading.
+	*/
+	class _OGGSOUND_EXPORT OgreOggSoundPreloader
+	{
+
+	public:
+
+		/** Creates the preloader.
+		@param numThreads
+			Number of decode threads, 0 uses one per hardware thread (Multi-threaded ONLY).
+		 */
+		OgreOggSoundPreloader(unsigned int numThreads=0);
+		/** Stops all decode threads.
+		@remarks
+			Any requests not yet collected are discarded.
+		 */
+		~OgreOggSoundPreloader();
+		/** Queues a list of files for decoding.
+		@remarks
+			Files are opened by the caller, resource groups aren't safe to use
+			from the decode threads.
+			@param files
+				Audio file names.
+			@param streams
+				Opened file for each name, null if it couldn't be opened.
+			@param cacheKeys
+				Decode cache key for each name, empty if not caching.
+			@param floatChannels
+				Bit per channel count which Ogg files may be decoded to float for.
+			@param listener
+				Callback object notified as files are uploaded (optional).
+		 */
+		void queue(const Ogre::StringVector& files, const std::vector<Ogre::DataStreamPtr>& streams, const Ogre::StringVector& cacheKeys, unsigned int floatChannels, PreloadListener* listener=0);
+		/** Collects the next decoded sound.
+		@remarks
+			Ownership of the returned object passes to the caller.
+			@param sound
+				Receives the decoded sound.
+		 */
+		bool popDecoded(PreloadedSound*& sound);
+		/** Gets the number of decode threads.
+		 */
+		unsigned int getNumThreads() const { return mNumThreads; }
+		/** Decodes an audio file into PCM data.
+		@remarks
+			Thread safe, errors are returned in the sound object rather than thrown.
+			@param sound
+				Sound to decode, mFile and mStream must be set.
+		 */
+		static void decode(PreloadedSound& sound);
+
+	private:
+
+		/** Decodes an Ogg file.
+		 */
+		static void _decodeOgg(Ogre::DataStreamPtr& stream, PreloadedSound& sound);
+		/** Decodes a PCM Wav file.
+		 */
+		static void _decodeWav(Ogre::DataStreamPtr& stream, PreloadedSound& sound);
+
+		std::deque<PreloadedSound*> mDecoded;	// Sounds ready for upload
+		unsigned int mNumThreads;				// Number of decode threads
+
+#if OGGSOUND_THREADED
+		/** Decode thread function
+		@remarks
+			Takes files from the pending list until shut down.
+		 */
+		void _workerLoop();
+
+		std::deque<PreloadedSound*> mPending;	// Sounds waiting to be decoded
+		bool mShuttingDown;						// Flag to stop decode threads
+#	ifdef POCO_THREAD
+		class Worker : public Poco::Runnable
+		{
+		public:
+			Worker(OgreOggSoundPreloader* preloader) : mPreloader(preloader) {}
+			virtual void run() { mPreloader->_workerLoop(); }
+		private:
+			OgreOggSoundPreloader* mPreloader;
+		};
+		friend class Worker;
+		std::vector<Poco::Thread*> mThreads;
+		Worker* mWorker;
+		Poco::Mutex mMutex;
+		Poco::Event mWorkEvent;
+#	else
+		std::vector<boost::thread*> mThreads;
+		boost::mutex mMutex;
+		boost::condition_variable mWorkCondition;
+#	endif
+#endif
+	};
+}
@@ -38,6 +38,7 @@
 #include <OgreDataStream.h>
 #include <OgreMovableObject.h>
 #include <OgreLogManager.h>
+#include <list>
 
 #   if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
 
@@ -103,6 +104,8 @@ namespace OgreOggSound
 			,mBuffers()
 			,mPlayTime(0.0)
 			,mFormat(AL_NONE)
+			,mSize(0)
+			,mCachePosition()
 		{ }
 
 		ALuint mAudioBuffer;	/// OpenAL buffer
@@ -110,9 +113,18 @@ namespace OgreOggSound
 		BufferListPtr mBuffers;	/// The cached common buffers to use between all sounds using this shared audio buffer.
 		float mPlayTime;		/// The cached play time of the audio buffer.
 		ALenum mFormat;			/// The cached format of the audio buffer.
+		unsigned int mSize;		/// Size of the audio data in bytes.
+		std::list<std::string>::iterator mCachePosition;	/// Position in the unused buffer cache, valid whilst mRefCount is 0.
 	};
 
 	typedef std::map<std::string, sharedAudioBuffer*> SharedBufferList;
+	typedef std::list<std::string> SharedBufferCache;
+
+	/** Handle to a sound, made up of a sound table slot (low 32 bits) and the
+		generation of that slot (high 32 bits). Handles of destroyed sounds are
+		detected as stale, even once their slot is reused. 0 is never a valid handle.
+	*/
+	typedef Ogre::uint64 SoundHandle;
 };
 
 /**
@@ -0,0 +1,125 @@
+/**
+* @file OgreOggSoundProfiler.h
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE. 
+*
+* @section DESCRIPTION
+* 
+* Profiling scopes for the audio hot paths and a Chrome trace recorder
+*/
+
+#pragma once
+
+#include "OgreOggSoundPrereqs.h"
+
+/**
+ * Profiling scopes, compiled in when OGGSOUND_PROFILE is set
+ */
+#ifndef OGGSOUND_PROFILE
+#	define OGGSOUND_PROFILE 0
+#endif
+
+#if OGGSOUND_PROFILE
+#	define OGGSOUND_PROFILE_SCOPE(name) OgreOggSound::OgreOggSoundProfileScope _oosProfileScope(name)
+#	define OGGSOUND_PROFILE_THREAD(name) OgreOggSound::OgreOggSoundProfiler::setThreadName(name)
+#else
+#	define OGGSOUND_PROFILE_SCOPE(name)
+#	define OGGSOUND_PROFILE_THREAD(name)
+#endif
+
+namespace OgreOggSound
+{
+	//! Records timed scopes for Chrome trace export
+	/** Each thread records spans into its own ring buffer, so once full only the
+		most recent spans are kept. Spans are only recorded by OGGSOUND_PROFILE_SCOPE()
+		when the library is built with OGGSOUND_PROFILE and a trace has been started.
+		Load the written file in chrome://tracing or Perfetto.
+	*/
+	class _OGGSOUND_EXPORT OgreOggSoundProfiler
+	{
+	public:
+
+		/** Starts recording spans.
+		@remarks
+			Discards anything previously recorded.
+			@param spansPerThread
+				Size of each threads ring buffer.
+		 */
+		static void startTrace(size_t spansPerThread=65536);
+		/** Stops recording spans.
+		@remarks
+			Recorded spans are kept until the next startTrace().
+		 */
+		static void stopTrace();
+		/** Returns whether spans are being recorded.
+		 */
+		static bool isTracing();
+		/** Writes recorded spans as Chrome trace JSON.
+		@remarks
+			Can be called whilst tracing, returns false if the file couldn't be written.
+			@param file
+				Path of the file to write.
+		 */
+		static bool writeChromeTrace(const Ogre::String& file);
+		/** Names the calling thread in written traces.
+		@param name
+			Thread name, must stay valid whilst tracing (a string literal).
+		 */
+		static void setThreadName(const char* name);
+		/** Records a span for the calling thread.
+		@remarks
+			Internal function - SHOULD NOT BE CALLED BY USER CODE
+		 */
+		static void _recordSpan(const char* name, unsigned long long start, unsigned long long end);
+		/** Gets the current trace time in nanoseconds.
+		 */
+		static unsigned long long _getTime();
+		/** Returns whether the calling thread is the one which loaded the library.
+		 */
+		static bool _isMainThread();
+	};
+
+#if OGGSOUND_PROFILE
+	//! A single profiling scope
+	/** Feeds Ogre's profiler when OGRE_PROFILING is enabled, only from the main 
+		thread as Ogre's profiler isn't thread safe, and records a span whilst tracing.
+	*/
+	class _OGGSOUND_EXPORT OgreOggSoundProfileScope
+	{
+	public:
+		OgreOggSoundProfileScope(const char* name);
+		~OgreOggSoundProfileScope();
+
+	private:
+		const char* mName;				// Scope name (string literal)
+		unsigned long long mStart;		// Trace time at entry
+		bool mTracing;					// Flag indicating a span is being recorded
+		bool mOgreProfile;				// Flag indicating an Ogre profile was begun
+	};
+#endif
+}
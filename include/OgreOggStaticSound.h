@@ -75,6 +75,13 @@ namespace OgreOggSound
 		/** Gets the sounds file name
 		 */
 		virtual const Ogre::String& getFileName( void ) const { return mAudioName; }
+		/** Gets the decoded PCM data
+		@remarks
+			Only available if OgreOggSoundManager::setKeepStaticAudioData() was
+			enabled when the sound was loaded, otherwise the data is freed once 
+			uploaded to OpenAL and this returns an empty buffer.
+		 */
+		const std::vector<char>& getAudioData( void ) const { return mBufferData; }
 
 	protected:	
 
@@ -160,7 +167,7 @@ namespace OgreOggSound
 		vorbis_info*	mVorbisInfo;		// Vorbis info 
 		vorbis_comment* mVorbisComment;		// Vorbis comments
 		Ogre::String	mAudioName;			// Name of audio file stream (Used with shared buffers)
-		std::vector<char> mBufferData;		// Sound data buffer
+		std::vector<char> mBufferData;		// Decoded audio data, empty unless kept on request
 		ALint mPreviousOffset;				// Current play position
 
 		friend class OgreOggSoundManager;	
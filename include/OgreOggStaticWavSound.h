@@ -44,6 +44,11 @@
 
 #include "OgreOggISound.h"
 
+/**
+ * Size of blocks used to fill static WAV buffers with AL_SOFT_buffer_sub_data
+ */
+#define WAV_UPLOAD_BLOCK 65536
+
 namespace OgreOggSound
 {
 	//! A single static buffer sound (WAV)
@@ -104,6 +109,24 @@ namespace OgreOggSound
 				file path string
 		 */
 		void _openImpl(Ogre::DataStreamPtr& fileStream);
+		/** Uploads the audio data to the OpenAL buffer.
+		@remarks
+			Maps files stored on disk and passes the data chunk straight to
+			alBufferData(). Otherwise uses AL_SOFT_buffer_sub_data to fill the
+			buffer a block at a time when available, falling back to reading
+			the entire data chunk into memory.
+		 */
+		void _uploadAudioData();
+		/** Uploads PCM data as IMA ADPCM.
+		@remarks
+			8-bit data is widened first as the encoder takes 16-bit samples.
+			Returns false if the data couldn't be encoded.
+			@param data
+				PCM data chunk.
+			@param size
+				Size of data in bytes.
+		 */
+		bool _uploadCompressed(const char* data, size_t size);
 		/** Opens audio file.
 		@remarks
 			Uses a shared buffer.
@@ -146,6 +169,9 @@ namespace OgreOggSound
 			sound properties.
 		 */
 		bool _queryBufferInfo();		
+		/** Gets whether the file holds IMA or MS ADPCM data.
+		 */
+		inline bool _isAdpcm() const { return mFormatData.mFormat && (mFormatData.mFormat->mFormatTag==0x0011 || mFormatData.mFormat->mFormatTag==0x0002); }
 		/** Releases buffers and OpenAL objects.
 		@remarks
 			Cleans up this sounds OpenAL objects, including buffers
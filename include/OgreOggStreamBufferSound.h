@@ -137,6 +137,12 @@ namespace OgreOggSound
 			sounds properties
 		 */
 		bool _queryBufferInfo() {}
+		/** Gets the time until this sound next needs servicing.
+		@remarks
+			Buffer durations are set by the user so this sound is serviced at
+			a fixed 10ms rate whilst playing.
+		 */
+		float _getRefillDeadline() const;
 		/** Releases buffers and OpenAL objects.
 		@remarks
 			Cleans up this sounds OpenAL objects, including buffers
@@ -0,0 +1,190 @@
+/**
+* @file OgreOggStreamDecoder.h
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE. 
+*
+* @section DESCRIPTION
+* 
+* Decodes streamed audio ahead of playback on a pool of threads
+*/
+
+#pragma once
+
+#include "OgreOggSoundPrereqs.h"
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+#		include "Poco/Thread.h"
+#		include "Poco/Runnable.h"
+#		include "Poco/Mutex.h"
+#		include "Poco/Event.h"
+#	else 
+#		include <boost/thread/thread.hpp>
+#		include <boost/thread/mutex.hpp>
+#		include <boost/thread/condition_variable.hpp>
+#	endif
+#endif
+
+namespace OgreOggSound
+{
+	class OgreOggStreamSound;
+
+	//! Scheduling state of a stream in the decoder
+	enum DecodeState
+	{
+		DS_IDLE,			// Ring full or stream finished
+		DS_SCHEDULED,		// Queued or being decoded
+		DS_RESCHEDULE		// Woken whilst scheduled, run again afterwards
+	};
+
+	//! Stream decode-ahead pool
+	/** Keeps the decode rings of registered streams topped up so refilling
+		an OpenAL buffer only has to copy already decoded audio.
+	@remarks
+		Each decode thread owns a queue of streams needing a block decoded, 
+		a stream stays on the queue of whichever thread ran it last until its 
+		ring is full. Idle threads steal from the back of other queues so 
+		decoding is spread across cores as streams are added. Threads never
+		touch OpenAL. Without threading support rings are topped up from update().
+	*/
+	class _OGGSOUND_EXPORT OgreOggStreamDecoder
+	{
+
+	public:
+
+		/** Creates the decoder and starts its threads.
+		@param numThreads
+			Number of decode threads, 0 uses one per hardware thread (Multi-threaded ONLY).
+		 */
+		OgreOggStreamDecoder(unsigned int numThreads=0);
+		/** Stops the decode threads.
+		 */
+		~OgreOggStreamDecoder();
+		/** Registers a stream for decoding ahead.
+		@param sound
+			Stream with a decode ring.
+		 */
+		void add(OgreOggStreamSound* sound);
+		/** Unregisters a stream.
+		@remarks
+			Waits for any decode in progress, afterwards the stream 
+			is never touched by the decoder.
+			@param sound
+				Registered stream.
+		 */
+		void remove(OgreOggStreamSound* sound);
+		/** Signals that a stream has consumed decoded data.
+		@param sound
+			Registered stream.
+		 */
+		void wake(OgreOggStreamSound* sound);
+		/** Tops up all decode rings.
+		@remarks
+			Called each update() when not multi-threaded.
+		 */
+		void update();
+		/** Gets the number of decode threads.
+		 */
+		inline unsigned int getNumThreads() const { return mNumThreads; }
+		/** Gets the number of blocks decoded.
+		 */
+		inline unsigned long getJobsRun() const { return mJobsRun; }
+		/** Gets the number of jobs taken from another threads queue.
+		 */
+		inline unsigned long getJobsStolen() const { return mJobsStolen; }
+
+	private:
+
+		//! Streams waiting for a decode thread
+		struct WorkQueue
+		{
+			std::deque<OgreOggStreamSound*> mJobs;	// Owner pops front, thieves pop back
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+			Poco::Mutex mMutex;
+#	else
+			boost::mutex mMutex;
+#	endif
+#endif
+		};
+
+		/** Adds a stream to a queue.
+		@remarks
+			Stream must already be marked as scheduled.
+		 */
+		void _push(OgreOggStreamSound* sound, size_t queue);
+		/** Takes the next job for a thread.
+		@remarks
+			Tries the threads own queue then steals from the others.
+		 */
+		bool _pop(size_t queue, OgreOggStreamSound*& sound);
+		/** Decodes a block and requeues the stream if it wants more.
+		 */
+		void _run(OgreOggStreamSound* sound, size_t queue);
+
+		std::vector<WorkQueue*> mQueues;		// One per decode thread
+		unsigned int mNumThreads;				// Number of decode threads
+		std::atomic<size_t> mNextQueue;			// Queue for the next woken stream
+		std::atomic<size_t> mPendingJobs;		// Jobs across all queues
+		std::atomic<unsigned long> mJobsRun;	// Blocks decoded
+		std::atomic<unsigned long> mJobsStolen;	// Jobs taken from another queue
+
+#if OGGSOUND_THREADED
+		/** Decode thread function
+		@remarks
+			Runs jobs until there are none left anywhere then waits to be woken.
+		 */
+		void _workerLoop(size_t queue);
+
+		std::atomic<bool> mShuttingDown;		// Flag to stop decode threads
+#	ifdef POCO_THREAD
+		class Worker : public Poco::Runnable
+		{
+		public:
+			Worker(OgreOggStreamDecoder* decoder, size_t queue) : mDecoder(decoder), mQueue(queue) {}
+			virtual void run() { mDecoder->_workerLoop(mQueue); }
+		private:
+			OgreOggStreamDecoder* mDecoder;
+			size_t mQueue;
+		};
+		friend class Worker;
+		std::vector<Poco::Thread*> mThreads;
+		std::vector<Worker*> mWorkers;
+		Poco::Event mWakeEvent;
+#	else
+		std::vector<boost::thread*> mThreads;
+		boost::mutex mWakeMutex;
+		boost::condition_variable mWakeCondition;
+#	endif
+#endif
+	};
+}
@@ -42,6 +42,15 @@
 #include "vorbis/vorbisfile.h"
 
 #include "OgreOggISound.h"
+#include "LocklessQueue.h"
+
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+#		include "Poco/Mutex.h"
+#	else 
+#		include <boost/thread/mutex.hpp>
+#	endif
+#endif
 
 namespace OgreOggSound
 {
@@ -141,6 +150,30 @@ namespace OgreOggSound
 				buffer id to load data into.
 		 */
 		bool _stream(ALuint buffer);
+		/** Decodes audio from the ogg stream.
+		@remarks
+			Reads up to size bytes, wrapping to the loop offset if looping.
+			Caller must hold the decode lock if decoding ahead.
+			@param data
+				Destination for 16-bit PCM.
+			@param size
+				Bytes wanted.
+			@param eof
+				Set true if the end of a non-looping stream was reached.
+		 */
+		int _decode(char* data, int size, bool& eof);
+		/** Decodes a block of audio into the decode ring.
+		@remarks
+			Called by the stream decoder, returns true if any audio was decoded.
+		 */
+		bool _decodeAhead();
+		/** Seeks the ogg stream.
+		@remarks
+			Discards anything already decoded ahead.
+			@param seconds
+				Position in seconds.
+		 */
+		void _seek(float seconds);
 		/** Updates the data buffers with sound information.
 		@remarks
 			This function refills processed buffers with audio data from
@@ -161,7 +194,7 @@ namespace OgreOggSound
 		void _prebuffer();		
 		/** Calculates buffer size and format.
 		@remarks
-			Calculates a block aligned buffer size of 250ms using
+			Calculates a block aligned buffer size of getStreamBufferTime() using
 			sounds properties
 		 */
 		bool _queryBufferInfo();		
@@ -171,6 +204,11 @@ namespace OgreOggSound
 			the thread locked update function instead of 'immediate mode' for static sounds.
 		 */
 		void _updatePlayPosition();		
+		/** Gets the time until this sound next needs servicing.
+		@remarks
+			Derived from the duration of audio still queued on the source.
+		 */
+		float _getRefillDeadline() const;
 		/** Releases buffers and OpenAL objects.
 		@remarks
 			Cleans up this sounds OpenAL objects, including buffers
@@ -187,6 +225,22 @@ namespace OgreOggSound
 		bool mStreamEOF;					// EOF flag
 		float mLastOffset;					// Offset time in seconds
 
+		/**
+		 * Decode-ahead variables
+		 */
+		LocklessQueue<char>* mDecodeRing;	// PCM decoded ahead of the buffer queue, 0 if disabled
+		std::atomic<bool> mDecodeEOF;		// Decoder has reached the end of the stream
+		std::atomic<int> mDecodeState;		// DecodeState within the stream decoder
+		std::atomic<bool> mDecodeRemoved;	// Flag to stop the stream decoder queuing this stream
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex mDecodeMutex;			// Guards ogg stream whilst decoding ahead
+#	else
+		boost::mutex mDecodeMutex;			// Guards ogg stream whilst decoding ahead
+#	endif
+#endif
+
 		friend class OgreOggSoundManager;
+		friend class OgreOggStreamDecoder;
 	};
 }
\ No newline at end of file
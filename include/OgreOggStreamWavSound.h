@@ -159,7 +159,7 @@ namespace OgreOggSound
 		void _prebuffer();		
 		/** Calculates buffer size and format.
 		@remarks
-			Calculates a block aligned buffer size of 250ms using
+			Calculates a block aligned buffer size of getStreamBufferTime() using
 			sound properties.
 		 */
 		bool _queryBufferInfo();		
@@ -169,6 +169,11 @@ namespace OgreOggSound
 			the thread locked update function instead of 'immediate mode' for static sounds.
 		 */
 		void _updatePlayPosition();		
+		/** Gets the time until this sound next needs servicing.
+		@remarks
+			Derived from the duration of audio still queued on the source.
+		 */
+		float _getRefillDeadline() const;
 		/** Releases buffers and OpenAL objects.
 		@remarks
 			Cleans up this sounds OpenAL objects, including buffers
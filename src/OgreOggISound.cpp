@@ -32,7 +32,10 @@
 
 #include "OgreOggISound.h"
 #include "OgreOggSound.h"
+#include "OgreOggSoundKernels.h"
 #include <OgreMovableObject.h>
+#include <limits>
+#include <algorithm>
 
 namespace OgreOggSound
 {
@@ -86,6 +89,16 @@ namespace OgreOggSound
 	MovableObject(id, objMemMgr, scnMgr, renderQueueId),
 	#endif
 	 mName(name)
+	,mSlot(0)
+	,mSlotGeneration(0)
+	,mActivePosition()
+	,mSourceHeapIndex(static_cast<size_t>(-1))
+	,mSourceKeyDistance(0.f)
+	,mSourceKeyPriority(0)
+	,mSourceKeyStopped(false)
+	,mSourceKeyDirty(false)
+	,mVirtual(false)
+	,mVirtualPlayPos(0.f)
 	,mSource(0) 
 	,mLoop(false) 
 	,mState(SS_NONE) 
@@ -110,6 +123,7 @@ namespace OgreOggSound
 	,mFade(false) 
 	,mFadeEndAction(OgreOggSound::FC_NONE)  
 	,mStream(false) 
+	,mFloat(false)
 	,mGiveUpSource(false)  
 	,mPlayPosChanged(false)  
 	,mPlayPos(0.f) 
@@ -124,10 +138,21 @@ namespace OgreOggSound
 	,mDisable3D(false)
 	,mSeekable(true)
 	,mSourceRelative(false)
+	,mDirtyState(0)
 	,mTemporary(false)
 	,mInitialised(false)
 	,mAwaitingDestruction(0)
 	,mSoundListener(0)
+	,mDecodeBuffer(0)
+	,mDecodeBufferSize(0)
+	,mBufferSize(0)
+	,mBufferTime(0.f)
+	,mStreamBufferTime(STREAM_BUFFER_TIME)
+	,mStreamBufferCount(NUM_BUFFERS)
+	,mStreamBufferTarget(NUM_BUFFERS)
+	,mAdaptiveStreamBuffers(false)
+	,mEarlyRefills(0)
+	,mUnderruns(0)
 	{
 		// Init some oggVorbis callbacks
 		mOggCallbacks.read_func	= OOSStreamRead;
@@ -143,7 +168,9 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	OgreOggISound::~OgreOggISound() 
 	{
+		_releaseDecodeBuffer();
 		mAudioStream.setNull();
+		mCompressedData.setNull();
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::_getSharedProperties(BufferListPtr& buffers, float& length, ALenum& format) 
@@ -166,10 +193,10 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 		SoundAction action;
-		action.mSound = mName;
+		action.mSlot = mSlot;
+		action.mGeneration = mSlotGeneration;
 		action.mAction = LQ_PLAY;
 		action.mImmediately = immediate;
-		action.mParams = 0;
 		OgreOggSoundManager::getSingletonPtr()->_requestSoundAction(action);
 #else
 		_playImpl();
@@ -182,10 +209,10 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 		SoundAction action;
-		action.mSound = mName;
+		action.mSlot = mSlot;
+		action.mGeneration = mSlotGeneration;
 		action.mAction = LQ_STOP;
 		action.mImmediately = immediate;
-		action.mParams = 0;
 		OgreOggSoundManager::getSingletonPtr()->_requestSoundAction(action);
 #else
 		_stopImpl();
@@ -198,10 +225,10 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 		SoundAction action;
-		action.mSound = mName;
+		action.mSlot = mSlot;
+		action.mGeneration = mSlotGeneration;
 		action.mAction = LQ_PAUSE;
 		action.mImmediately = immediate;
-		action.mParams = 0;
 		OgreOggSoundManager::getSingletonPtr()->_requestSoundAction(action);
 #else
 		_pauseImpl();
@@ -210,6 +237,13 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::disable3D(bool disable)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		// Set flag
 		mDisable3D = disable;
 
@@ -218,26 +252,22 @@ namespace OgreOggSound
 			Requires setting listener relative to AL_TRUE
 			Position to ZERO.
 			Reference distance is set to 1.
-			If Source available then settings are applied immediately
-			else they are applied next time the sound is initialised.
+			Settings are applied on the next update, or next time the
+			sound is initialised.
 		*/
 		if ( mDisable3D )
 		{
 			mSourceRelative = true;
 			mPosition = Ogre::Vector3::ZERO;
+			mVelocity = Ogre::Vector3::ZERO;
 
-			if ( mSource!=AL_NONE ) 
-			{
-				alSourcei(mSource, AL_SOURCE_RELATIVE, mSourceRelative);
-				alSource3f(mSource, AL_POSITION, mPosition.x, mPosition.y, mPosition.z);
-				alSource3f(mSource, AL_VELOCITY, mPosition.x, mPosition.y, mPosition.z);
-			}
+			_markDirty(DS_RELATIVE | DS_POSITION | DS_VELOCITY);
 		}
 		/** Enable 3D
 		@remarks
 			Set listener relative to AL_FALSE
-			If Source available then settings are applied immediately
-			else they are applied next time the sound is initialised.
+			Settings are applied on the next update, or next time the
+			sound is initialised.
 			NOTE:- If previously disabled, Reference distance will still be set to 1.
 			Should be reset as required by user AFTER calling this function.
 		*/
@@ -245,113 +275,161 @@ namespace OgreOggSound
 		{
 			mSourceRelative = false;
 
-			if ( mSource!=AL_NONE ) 
-			{
-				alSourcei(mSource, AL_SOURCE_RELATIVE, mSourceRelative);
-			}
+			_markDirty(DS_RELATIVE);
 		}
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setPosition(float posx,float posy, float posz)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		mPosition.x = posx;
 		mPosition.y = posy;
 		mPosition.z = posz;	
 		#if OGRE_VERSION_MAJOR == 1
 		mLocalTransformDirty = true;
 		#else
-		alSource3f(mSource, AL_POSITION, mPosition.x, mPosition.y, mPosition.z);
+		_markDirty(DS_POSITION);
 		#endif
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setPosition(const Ogre::Vector3 &pos)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		mPosition = pos;   
 		#if OGRE_VERSION_MAJOR == 1
 		mLocalTransformDirty = true;
 		#else
-		alSource3f(mSource, AL_POSITION, mPosition.x, mPosition.y, mPosition.z);
+		_markDirty(DS_POSITION);
 		#endif
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setDirection(float dirx, float diry, float dirz)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		mDirection.x = dirx;
 		mDirection.y = diry;
 		mDirection.z = dirz;
 		#if OGRE_VERSION_MAJOR == 1
 		mLocalTransformDirty = true;
 		#else
-		alSource3f(mSource, AL_DIRECTION, mDirection.x, mDirection.y, mDirection.z);
+		_markDirty(DS_DIRECTION);
 		#endif
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setDirection(const Ogre::Vector3 &dir)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		mDirection = dir;  
 		#if OGRE_VERSION_MAJOR == 1
 		mLocalTransformDirty = true;
 		#else
-		alSource3f(mSource, AL_DIRECTION, mDirection.x, mDirection.y, mDirection.z);
+		_markDirty(DS_DIRECTION);
 		#endif
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setVelocity(float velx, float vely, float velz)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		mVelocity.x = velx;
 		mVelocity.y = vely;
 		mVelocity.z = velz;
 
-		if(mSource != AL_NONE)
-		{
-			alSource3f(mSource, AL_VELOCITY, velx, vely, velz);
-		}
+		_markDirty(DS_VELOCITY);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setVelocity(const Ogre::Vector3 &vel)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		mVelocity = vel;	
 
-		if(mSource != AL_NONE)
-		{
-			alSource3f(mSource, AL_VELOCITY, vel.x, vel.y, vel.z);
-		}
+		_markDirty(DS_VELOCITY);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setVolume(float gain)
 	{
 		if(gain < 0) return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mGain = gain;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef(mSource, AL_GAIN, mGain);		
-		}
+		_markDirty(DS_GAIN);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setMaxVolume(float maxGain)
 	{
 		if(maxGain < 0 || maxGain > 1) return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mMaxGain = maxGain;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef(mSource, AL_MAX_GAIN, mMaxGain);	
-		}
+		_markDirty(DS_GAIN_LIMITS);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setMinVolume(float minGain)
 	{
 		if(minGain < 0 || minGain > 1) return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mMinGain = minGain;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef(mSource, AL_MIN_GAIN, mMinGain);		
-		}
+		_markDirty(DS_GAIN_LIMITS);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setConeAngles(float insideAngle, float outsideAngle)
@@ -359,115 +437,123 @@ namespace OgreOggSound
 		if(insideAngle < 0 || insideAngle > 360)	return;
 		if(outsideAngle < 0 || outsideAngle > 360)	return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mInnerConeAngle = insideAngle;
 		mOuterConeAngle = outsideAngle;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef (mSource, AL_CONE_INNER_ANGLE,	mInnerConeAngle);
-			alSourcef (mSource, AL_CONE_OUTER_ANGLE,	mOuterConeAngle);
-		}
+		_markDirty(DS_CONE);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setOuterConeVolume(float gain)
 	{
 		if(gain < 0 || gain > 1)	return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mOuterConeGain = gain;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef (mSource, AL_CONE_OUTER_GAIN, mOuterConeGain);
-		}
+		_markDirty(DS_CONE);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setMaxDistance(float maxDistance)
 	{
 		if(maxDistance < 0) return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mMaxDistance = maxDistance;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef(mSource, AL_MAX_DISTANCE, mMaxDistance);		
-		}
+		_markDirty(DS_DISTANCE);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	const float OgreOggISound::getMaxDistance() const
 	{
-		float val=-1.f;
-		if(mSource != AL_NONE)
-		{
-			alGetSourcef(mSource, AL_MAX_DISTANCE, &val);		
-		}
-		return val;
+		return mMaxDistance;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setRolloffFactor(float rolloffFactor)
 	{
 		if(rolloffFactor < 0) return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mRolloffFactor = rolloffFactor;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef(mSource, AL_ROLLOFF_FACTOR, mRolloffFactor);		
-		}
+		_markDirty(DS_DISTANCE);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	const float OgreOggISound::getRolloffFactor() const
 	{
-		float val=-1.f;
-		if(mSource != AL_NONE)
-		{
-			alGetSourcef(mSource, AL_ROLLOFF_FACTOR, &val);		
-		}
-		return val;
+		return mRolloffFactor;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setReferenceDistance(float referenceDistance)
 	{
 		if(referenceDistance < 0) return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mReferenceDistance = referenceDistance;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef(mSource, AL_REFERENCE_DISTANCE, mReferenceDistance);		
-		}
+		_markDirty(DS_DISTANCE);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	const float OgreOggISound::getReferenceDistance() const
 	{
-		float val=-1.f;
-
-		if(mSource != AL_NONE)
-		{
-			alGetSourcef(mSource, AL_REFERENCE_DISTANCE, &val);		
-		}
-		return val;
+		return mReferenceDistance;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setPitch(float pitch)
 	{
 		if ( pitch<=0.f ) return;
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		mPitch = pitch;
 
-		if(mSource != AL_NONE)
-		{
-			alSourcef(mSource, AL_PITCH, mPitch);		
-		}
+		_markDirty(DS_PITCH);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	const float OgreOggISound::getPitch() const
 	{
-		float val=-1.f;
-		if(mSource != AL_NONE)
-		{
-			alGetSourcef(mSource, AL_PITCH, &val);		
-		}
-		return val;
+		return mPitch;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::_initSource()
@@ -475,6 +561,17 @@ namespace OgreOggSound
 		//'reset' the source properties 		
 		if(mSource != AL_NONE)
 		{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+			Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+			boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
+			// Everything is submitted here
+			mDirtyState = 0;
+
 			alSourcef (mSource, AL_GAIN, mGain);
 			alSourcef (mSource, AL_MAX_GAIN, mMaxGain);
 			alSourcef (mSource, AL_MIN_GAIN, mMinGain);
@@ -495,19 +592,81 @@ namespace OgreOggSound
 		}
 	}
 	/*/////////////////////////////////////////////////////////////////*/
-	float OgreOggISound::getVolume() const
+	void OgreOggISound::_flushState()
 	{
-		float vol=0.f;
+		if ( mSource==AL_NONE ) return;
 
-		// Check if a source is available
-		if(mSource != AL_NONE)
+		unsigned int dirty = mDirtyState.exchange(0);
+		if ( !dirty ) return;
+
+		// Setters write whole vectors under the same lock
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
+		unsigned int calls=0;
+
+		if ( dirty & DS_POSITION )
 		{
-			alGetSourcef(mSource, AL_GAIN, &vol);		
-			return vol;
+			alSource3f(mSource, AL_POSITION, mPosition.x, mPosition.y, mPosition.z);
+			++calls;
 		}
-		// If not - return requested setting.
-		else
-			return mGain;
+		if ( dirty & DS_DIRECTION )
+		{
+			alSource3f(mSource, AL_DIRECTION, mDirection.x, mDirection.y, mDirection.z);
+			++calls;
+		}
+		if ( dirty & DS_VELOCITY )
+		{
+			alSource3f(mSource, AL_VELOCITY, mVelocity.x, mVelocity.y, mVelocity.z);
+			++calls;
+		}
+		if ( dirty & DS_GAIN )
+		{
+			alSourcef(mSource, AL_GAIN, mGain);
+			++calls;
+		}
+		if ( dirty & DS_GAIN_LIMITS )
+		{
+			alSourcef(mSource, AL_MAX_GAIN, mMaxGain);
+			alSourcef(mSource, AL_MIN_GAIN, mMinGain);
+			calls+=2;
+		}
+		if ( dirty & DS_DISTANCE )
+		{
+			alSourcef(mSource, AL_MAX_DISTANCE, mMaxDistance);
+			alSourcef(mSource, AL_ROLLOFF_FACTOR, mRolloffFactor);
+			alSourcef(mSource, AL_REFERENCE_DISTANCE, mReferenceDistance);
+			calls+=3;
+		}
+		if ( dirty & DS_CONE )
+		{
+			alSourcef(mSource, AL_CONE_OUTER_GAIN, mOuterConeGain);
+			alSourcef(mSource, AL_CONE_INNER_ANGLE, mInnerConeAngle);
+			alSourcef(mSource, AL_CONE_OUTER_ANGLE, mOuterConeAngle);
+			calls+=3;
+		}
+		if ( dirty & DS_PITCH )
+		{
+			alSourcef(mSource, AL_PITCH, mPitch);
+			++calls;
+		}
+		if ( dirty & DS_RELATIVE )
+		{
+			alSourcei(mSource, AL_SOURCE_RELATIVE, mSourceRelative);
+			++calls;
+		}
+
+		OgreOggSoundManager::getSingleton()._notifyALCalls(calls);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	float OgreOggISound::getVolume() const
+	{
+		return mGain;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::startFade(bool fDir, float fadeTime, FadeControl actionOnComplete)
@@ -556,6 +715,199 @@ namespace OgreOggSound
 		} 
 	}
 	/*/////////////////////////////////////////////////////////////////*/
+	float OgreOggISound::_getRefillDeadline() const
+	{
+		// Fades are stepped in update()
+		if ( mFade ) return 0.01f;
+
+		if ( !isPlaying() ) return std::numeric_limits<float>::max();
+
+		// Wake up when playback reaches the end
+		ALfloat offset=0.f;
+		alGetSourcef(mSource, AL_SEC_OFFSET, &offset);
+		float remaining = mPlayTime - offset;
+		return remaining>0.f ? remaining / mPitch : 0.f;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	char* OgreOggISound::_getDecodeBuffer(size_t size)
+	{
+		if ( mDecodeBuffer && mDecodeBufferSize>=size ) return mDecodeBuffer;
+
+		_releaseDecodeBuffer();
+
+		mDecodeBuffer = OGRE_ALLOC_T(char, size, Ogre::MEMCATEGORY_GENERAL);
+		mDecodeBufferSize = size;
+
+		OgreOggSoundManager::getSingleton()._notifyDecodeAllocation();
+		return mDecodeBuffer;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggISound::_releaseDecodeBuffer()
+	{
+		if ( !mDecodeBuffer ) return;
+
+		OGRE_FREE(mDecodeBuffer, Ogre::MEMCATEGORY_GENERAL);
+		mDecodeBuffer = 0;
+		mDecodeBufferSize = 0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	float OgreOggISound::_getStreamingDeadline(float bufferTime, bool eof) const
+	{
+		// Seeks are handled on the next update
+		if ( mPlayPosChanged ) return 0.f;
+
+		ALint state=AL_INITIAL;
+		alGetSourcei(mSource, AL_SOURCE_STATE, &state);
+
+		// Starved or finished
+		if ( state==AL_STOPPED ) return 0.f;
+		if ( state!=AL_PLAYING ) return std::numeric_limits<float>::max();
+
+		ALint queued=0;
+		ALfloat offset=0.f;
+		alGetSourcei(mSource, AL_BUFFERS_QUEUED, &queued);
+		alGetSourcef(mSource, AL_SEC_OFFSET, &offset);
+
+		// Audio left to play, offset is relative to the first queued buffer
+		float remaining = (queued * bufferTime) - offset;
+
+		// Refill once half the queue has been consumed
+		if ( !eof ) remaining -= (mBuffers->size() * bufferTime) * 0.5f;
+
+		return remaining>0.f ? remaining / mPitch : 0.f;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggISound::setStreamBufferCount(unsigned int count)
+	{
+		mStreamBufferCount = std::max<unsigned int>(MIN_STREAM_BUFFERS, std::min<unsigned int>(count, MAX_STREAM_BUFFERS));
+		mStreamBufferTarget = mStreamBufferCount;
+		mEarlyRefills = 0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggISound::setStreamBufferTime(float seconds)
+	{
+		if ( seconds<=0.f ) return;
+
+		mStreamBufferTime = seconds;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggISound::setAdaptiveStreamBuffers(bool adaptive)
+	{
+		mAdaptiveStreamBuffers = adaptive;
+
+		// Drop back to the requested depth
+		if ( !mAdaptiveStreamBuffers ) 
+			mStreamBufferTarget = mStreamBufferCount;
+
+		mEarlyRefills = 0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggISound::_calculateBufferSize(unsigned int bytesPerSecond, unsigned int blockAlign)
+	{
+		if ( !blockAlign ) blockAlign = 1;
+
+		mBufferTime = mStreamBufferTime;
+		mBufferSize = static_cast<size_t>(bytesPerSecond * mBufferTime);
+
+		// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
+		mBufferSize -= (mBufferSize % blockAlign);
+		if ( mBufferSize<blockAlign ) mBufferSize = blockAlign;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	long OgreOggISound::_readShort(OggVorbis_File& file, char* data, int bytes, int channels, int* section)
+	{
+		float** pcm = 0;
+		long frames = ov_read_float(&file, &pcm, bytes / (channels * static_cast<int>(sizeof(short))), section);
+		if ( frames<=0 ) return frames;
+
+		// Interleave and convert in one pass
+		OgreOggSoundKernels::interleaveToInt16(pcm, channels, static_cast<size_t>(frames), reinterpret_cast<short*>(data));
+
+		return frames * channels * static_cast<long>(sizeof(short));
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	long OgreOggISound::_readFloat(OggVorbis_File& file, char* data, int bytes, int channels, int* section)
+	{
+		float** pcm = 0;
+		long frames = ov_read_float(&file, &pcm, bytes / (channels * static_cast<int>(sizeof(float))), section);
+		if ( frames<=0 ) return frames;
+
+		// Vorbis decodes each channel separately
+		OgreOggSoundKernels::interleaveFloat(pcm, channels, static_cast<size_t>(frames), reinterpret_cast<float*>(data));
+
+		return frames * channels * static_cast<long>(sizeof(float));
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggISound::_resizeStreamBuffers()
+	{
+		while ( mBuffers->size()>mStreamBufferTarget )
+		{
+			if ( mBuffers->back()!=AL_NONE ) alDeleteBuffers(1, &mBuffers->back());
+			mBuffers->pop_back();
+		}
+		while ( mBuffers->size()<mStreamBufferTarget )
+		{
+			if ( _addStreamBuffer()==AL_NONE ) return false;
+		}
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	ALuint OgreOggISound::_addStreamBuffer()
+	{
+		ALuint buffer=AL_NONE;
+
+		alGetError();
+		alGenBuffers(1, &buffer);
+		if ( alGetError()!=AL_NO_ERROR ) return AL_NONE;
+
+#if HAVE_EFX
+		// Upload to XRAM buffers if available
+		if ( OgreOggSoundManager::getSingleton().hasXRamSupport() )
+			OgreOggSoundManager::getSingleton().setXRamBuffer(1, &buffer);
+#endif
+
+		mBuffers->push_back(buffer);
+		return buffer;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggISound::_removeStreamBuffer(ALuint buffer, bool force)
+	{
+		if ( !force && mBuffers->size()<=mStreamBufferTarget ) return false;
+
+		BufferList::iterator i = std::find(mBuffers->begin(), mBuffers->end(), buffer);
+		if ( i==mBuffers->end() ) return false;
+
+		alDeleteBuffers(1, &buffer);
+		mBuffers->erase(i);
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggISound::_adaptStreamBuffers(bool underrun, int queued, int processed)
+	{
+		if ( !mAdaptiveStreamBuffers ) return;
+
+		// Number of early refills in a row before giving a buffer back
+		static const unsigned int shrinkRefills = 64;
+
+		if ( underrun )
+		{
+			// Ran dry - deepen the queue
+			mStreamBufferTarget = std::min<unsigned int>(mStreamBufferTarget * 2, MAX_STREAM_BUFFERS);
+			mEarlyRefills = 0;
+		}
+		else if ( (queued - processed) * 2 >= queued )
+		{
+			// Serviced with plenty still to play
+			if ( ++mEarlyRefills>=shrinkRefills )
+			{
+				if ( mStreamBufferTarget>mStreamBufferCount ) --mStreamBufferTarget;
+				mEarlyRefills = 0;
+			}
+		}
+		else
+			mEarlyRefills = 0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::_markPlayPosition()
 	{
 		/** Ignore if no source available.
@@ -584,6 +936,58 @@ namespace OgreOggSound
 		}
 	}
 	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggISound::_playVirtual()
+	{
+		if ( mVirtual ) return;
+
+		// Start from any requested position
+		if ( OgreOggSoundManager::getSingleton()._virtualiseSound(this, mPlayPosChanged ? mPlayPos : 0.f) )
+		{
+			// Notify listener
+			if (mSoundListener) 
+				mSoundListener->soundPlayed(this);
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggISound::_pauseVirtual()
+	{
+		if ( !mVirtual ) return false;
+
+		OgreOggSoundManager::getSingleton()._removeVirtualSound(this);
+		mState = SS_PAUSED;
+
+		// Resume from where it got to
+		setPlayPosition(mVirtualPlayPos);
+
+		// Notify listener
+		if (mSoundListener) 
+			mSoundListener->soundPaused(this);
+
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggISound::_stopVirtual()
+	{
+		if ( !mVirtual ) return false;
+
+		OgreOggSoundManager::getSingleton()._removeVirtualSound(this);
+		mState = SS_STOPPED;
+		mPlayPosChanged = false;
+
+		// Notify listener
+		if (mSoundListener) 
+			mSoundListener->soundStopped(this);
+
+		// Mark for destruction
+		if (mTemporary)
+		{
+			mState = SS_DESTROYED;
+			OgreOggSoundManager::getSingletonPtr()->_destroyTemporarySound(this);
+		}
+
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setPlayPosition(float seconds)
 	{
 		// Invalid time - exit
@@ -677,16 +1081,27 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::setRelativeToListener(bool relative)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		mSourceRelative = relative;
-		
-		if(mSource != AL_NONE)
-		{
-			alSourcei(mSource, AL_SOURCE_RELATIVE, mSourceRelative);
-		}
+
+		_markDirty(DS_RELATIVE);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggISound::update(float fTime)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
 		#if OGRE_VERSION_MAJOR == 1
 		if (mLocalTransformDirty)
 		{
@@ -696,25 +1111,21 @@ namespace OgreOggSound
 				mDirection = -mParentNode->_getDerivedOrientation().zAxis();
 			}
 
-			if(mSource != AL_NONE)
-			{
-				alSource3f(mSource, AL_POSITION, mPosition.x, mPosition.y, mPosition.z);
-				alSource3f(mSource, AL_DIRECTION, mDirection.x, mDirection.y, mDirection.z);
-				mLocalTransformDirty = false;
-			}
+			_markDirty(DS_POSITION | DS_DIRECTION);
+			mLocalTransformDirty = false;
 		}
 		#else
-		if (!mDisable3D && mParentNode && mSource != AL_NONE) {
+		if (!mDisable3D && mParentNode) {
 			Ogre::Vector3    newPos    = mParentNode->_getDerivedPosition();
 			if (newPos != mPosition) {
 				mPosition = newPos;
-				alSource3f(mSource, AL_POSITION, mPosition.x, mPosition.y, mPosition.z);
+				_markDirty(DS_POSITION);
 			}
 			
 			Ogre::Vector3    newDir = -mParentNode->_getDerivedOrientation().zAxis();
 			if (newDir != mDirection) {
 				mDirection = newDir;
-				alSource3f(mSource, AL_DIRECTION, mDirection.x, mDirection.y, mDirection.z);
+				_markDirty(DS_DIRECTION);
 			}
 		}
 		#endif
@@ -758,6 +1169,14 @@ namespace OgreOggSound
 			#endif
 		);
 
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mStateMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mStateMutex);
+#	endif
+#endif
+
 		// Immediately set position/orientation when attached
 		if (mParentNode)
 		{
@@ -769,12 +1188,8 @@ namespace OgreOggSound
 			mDirection = -mParentNode->_getDerivedOrientation().zAxis();
 		}
 
-		// Set tarnsform immediately if possible
-		if(mSource != AL_NONE)
-		{
-			alSource3f(mSource, AL_POSITION, mPosition.x, mPosition.y, mPosition.z);
-			alSource3f(mSource, AL_DIRECTION, mDirection.x, mDirection.y, mDirection.z);
-		}
+		// Submit transform with the next update
+		_markDirty(DS_POSITION | DS_DIRECTION);
 
 		return;
 	}
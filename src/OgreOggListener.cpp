@@ -57,7 +57,7 @@ namespace OgreOggSound
 		mPosition.x = x;
 		mPosition.y = y;
 		mPosition.z = z;
-		alListener3f(AL_POSITION,x,y,z);
+		mDirtyState |= DS_POSITION;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggListener::setPosition(const Ogre::Vector3 &pos)
@@ -70,7 +70,7 @@ namespace OgreOggSound
 #	endif
 #endif
 		mPosition = pos;
-		alListener3f(AL_POSITION,pos.x,pos.y,pos.z);
+		mDirtyState |= DS_POSITION;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	Ogre::Vector3 OgreOggListener::getPosition() const
@@ -88,16 +88,30 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggListener::setVelocity(float velx, float vely, float velz)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mMutex);
+#	endif
+#endif
 		mVelocity.x = velx;
 		mVelocity.y = vely;
 		mVelocity.z = velz;
-		alListener3f(AL_VELOCITY, velx, vely, velz);
+		mDirtyState |= DS_VELOCITY;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggListener::setVelocity(const Ogre::Vector3 &vel)
 	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mMutex);
+#	endif
+#endif
 		mVelocity = vel;	
-		alListener3f(AL_VELOCITY, vel.x, vel.y, vel.z);
+		mDirtyState |= DS_VELOCITY;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggListener::setOrientation(ALfloat x,ALfloat y,ALfloat z,ALfloat upx,ALfloat upy,ALfloat upz)
@@ -115,7 +129,7 @@ namespace OgreOggSound
 		mOrientation[3] = upx;
 		mOrientation[4] = upy;
 		mOrientation[5] = upz;	
-		alListenerfv(AL_ORIENTATION,mOrientation);
+		mDirtyState |= DS_ORIENTATION;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggListener::setOrientation(const Ogre::Quaternion &q)
@@ -139,7 +153,7 @@ namespace OgreOggSound
 		mOrientation[3] = vUp.x;
 		mOrientation[4] = vUp.y;
 		mOrientation[5] = vUp.z;	
-		alListenerfv(AL_ORIENTATION,mOrientation);	
+		mDirtyState |= DS_ORIENTATION;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	Ogre::Vector3 OgreOggListener::getOrientation() const
@@ -181,6 +195,42 @@ namespace OgreOggSound
 			}
 		}
 		#endif
+
+		_flushState();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggListener::_flushState()
+	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mMutex);
+#	endif
+#endif
+
+		if ( !mDirtyState ) return;
+
+		unsigned int calls=0;
+
+		if ( mDirtyState & DS_POSITION )
+		{
+			alListener3f(AL_POSITION, mPosition.x, mPosition.y, mPosition.z);
+			++calls;
+		}
+		if ( mDirtyState & DS_VELOCITY )
+		{
+			alListener3f(AL_VELOCITY, mVelocity.x, mVelocity.y, mVelocity.z);
+			++calls;
+		}
+		if ( mDirtyState & DS_ORIENTATION )
+		{
+			alListenerfv(AL_ORIENTATION, mOrientation);
+			++calls;
+		}
+		mDirtyState = 0;
+
+		OgreOggSoundManager::getSingleton()._notifyALCalls(calls);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	const Ogre::AxisAlignedBox& OgreOggListener::getBoundingBox(void) const
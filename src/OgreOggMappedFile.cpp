@@ -0,0 +1,130 @@
+/**
+* @file OgreOggMappedFile.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+*/
+
+#include "OgreOggMappedFile.h"
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace OgreOggSound
+{
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggMappedFile::OgreOggMappedFile() :
+		mData(0)
+		,mSize(0)
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		,mFile(INVALID_HANDLE_VALUE)
+		,mMapping(0)
+#endif
+	{
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggMappedFile::~OgreOggMappedFile()
+	{
+		close();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggMappedFile::open(const Ogre::String& path)
+	{
+		close();
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+		if ( mFile==INVALID_HANDLE_VALUE ) return false;
+
+		LARGE_INTEGER size;
+		if ( !GetFileSizeEx(mFile, &size) || size.QuadPart==0 )
+		{
+			close();
+			return false;
+		}
+
+		if ( !(mMapping = CreateFileMappingA(mFile, 0, PAGE_READONLY, 0, 0, 0)) )
+		{
+			close();
+			return false;
+		}
+
+		mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		if ( !mData )
+		{
+			close();
+			return false;
+		}
+		mSize = static_cast<size_t>(size.QuadPart);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if ( fd<0 ) return false;
+
+		struct stat info;
+		if ( fstat(fd, &info)!=0 || info.st_size==0 )
+		{
+			::close(fd);
+			return false;
+		}
+
+		// The mapping holds its own reference to the file
+		void* data = mmap(0, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if ( data==MAP_FAILED ) return false;
+
+		// Audio is read front to back once
+		madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+		mData = static_cast<const char*>(data);
+		mSize = static_cast<size_t>(info.st_size);
+#endif
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggMappedFile::close()
+	{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		if ( mData ) UnmapViewOfFile(mData);
+		if ( mMapping ) CloseHandle(mMapping);
+		if ( mFile!=INVALID_HANDLE_VALUE ) CloseHandle(mFile);
+		mMapping = 0;
+		mFile = INVALID_HANDLE_VALUE;
+#else
+		if ( mData ) munmap(const_cast<char*>(mData), mSize);
+#endif
+		mData = 0;
+		mSize = 0;
+	}
+}
@@ -0,0 +1,134 @@
+/**
+* @file OgreOggSoundAdpcm.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+*/
+
+#include "OgreOggSoundAdpcm.h"
+
+namespace OgreOggSound
+{
+	//! Step sizes indexed by step index
+	static const int IMA_STEP_TABLE[89] =
+	{
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+		50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+		253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+		1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+		3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+		12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+
+	//! Step index adjustment indexed by encoded sample
+	static const int IMA_INDEX_TABLE[16] =
+	{
+		-1, -1, -1, -1, 2, 4, 6, 8,
+		-1, -1, -1, -1, 2, 4, 6, 8
+	};
+
+	/*/////////////////////////////////////////////////////////////////*/
+	size_t OgreOggSoundAdpcm::getIma4BlockSize(int channels, int samplesPerBlock)
+	{
+		return channels * (4 + (samplesPerBlock - 1) / 2);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	size_t OgreOggSoundAdpcm::encodeIma4(const short* pcm, size_t frames, int channels, int samplesPerBlock, std::vector<char>& out)
+	{
+		const size_t blockSize = getIma4BlockSize(channels, samplesPerBlock);
+		const size_t blocks = (frames + samplesPerBlock - 1) / samplesPerBlock;
+		out.assign(blocks * blockSize, 0);
+
+		// Step index carries over between blocks
+		int predictor[2] = { 0, 0 };
+		int index[2] = { 0, 0 };
+
+		for ( size_t b=0; b<blocks; ++b )
+		{
+			const size_t first = b * samplesPerBlock;
+			unsigned char* block = reinterpret_cast<unsigned char*>(&out[b * blockSize]);
+
+			for ( int c=0; c<channels; ++c )
+			{
+				// Header - first sample is stored verbatim
+				const short sample = first<frames ? pcm[first * channels + c] : 0;
+				predictor[c] = sample;
+				block[c * 4 + 0] = static_cast<unsigned char>(sample & 0xFF);
+				block[c * 4 + 1] = static_cast<unsigned char>((sample >> 8) & 0xFF);
+				block[c * 4 + 2] = static_cast<unsigned char>(index[c]);
+				block[c * 4 + 3] = 0;
+
+				// Groups of 8 samples per channel, 4 bytes each
+				unsigned char* data = block + channels * 4 + c * 4;
+				for ( int i=1; i<samplesPerBlock; ++i )
+				{
+					const size_t frame = first + i;
+					const int s = frame<frames ? pcm[frame * channels + c] : 0;
+					const unsigned char nibble = _encodeSample(s, predictor[c], index[c]);
+
+					const int n = i - 1;
+					unsigned char& byte = data[(n / 8) * channels * 4 + (n % 8) / 2];
+					byte |= (n & 1) ? (nibble << 4) : nibble;
+				}
+			}
+		}
+
+		return blocks;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	unsigned char OgreOggSoundAdpcm::_encodeSample(int sample, int& predictor, int& index)
+	{
+		int step = IMA_STEP_TABLE[index];
+		int diff = sample - predictor;
+		unsigned char nibble = 0;
+
+		if ( diff<0 )
+		{
+			nibble = 8;
+			diff = -diff;
+		}
+
+		// Quantise the same way the decoder reconstructs
+		int delta = step >> 3;
+		if ( diff>=step ) { nibble |= 4; diff -= step; delta += step; }
+		step >>= 1;
+		if ( diff>=step ) { nibble |= 2; diff -= step; delta += step; }
+		step >>= 1;
+		if ( diff>=step ) { nibble |= 1; delta += step; }
+
+		predictor += (nibble & 8) ? -delta : delta;
+		if ( predictor>32767 ) predictor = 32767;
+		else if ( predictor<-32768 ) predictor = -32768;
+
+		index += IMA_INDEX_TABLE[nibble];
+		if ( index<0 ) index = 0;
+		else if ( index>88 ) index = 88;
+
+		return nibble;
+	}
+}
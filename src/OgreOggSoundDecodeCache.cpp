@@ -0,0 +1,306 @@
+/**
+* @file OgreOggSoundDecodeCache.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+*/
+
+#include "OgreOggSoundDecodeCache.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <dirent.h>
+#	include <sys/stat.h>
+#	include <utime.h>
+#endif
+
+#define DECODE_CACHE_VERSION 1
+
+namespace OgreOggSound
+{
+	//! Header of a cache entry, followed by the key then PCM data
+	struct DecodeCacheHeader
+	{
+		char mMagic[4];						// 'OOSC'
+		unsigned int mVersion;				// DECODE_CACHE_VERSION
+		unsigned int mChannels;				// Channel count
+		unsigned int mRate;					// Sample rate
+		unsigned long long mDataSize;		// PCM size in bytes
+		unsigned int mKeySize;				// Key length, padded to 4 bytes in the file
+		unsigned int mReserved;
+	};
+
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggSoundDecodeCache::OgreOggSoundDecodeCache(const Ogre::String& directory, size_t maxBytes) :
+		mDirectory(directory)
+		,mMaxSize(maxBytes)
+		,mSize(0)
+		,mHits(0)
+		,mMisses(0)
+	{
+		// Index existing entries
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((mDirectory + "\\*.pcm").c_str(), &data);
+		if ( find!=INVALID_HANDLE_VALUE )
+		{
+			do
+			{
+				if ( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) continue;
+
+				// FILETIME counts 100ns intervals since 1601
+				const unsigned long long written = (static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+				Entry e;
+				e.mSize = static_cast<size_t>((static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+				e.mLastUsed = written / 10000000ULL - 11644473600ULL;
+				mEntries[data.cFileName] = e;
+				mSize += e.mSize;
+			}
+			while ( FindNextFileA(find, &data) );
+			FindClose(find);
+		}
+#else
+		if ( DIR* dir = opendir(mDirectory.c_str()) )
+		{
+			while ( dirent* d = readdir(dir) )
+			{
+				const Ogre::String name(d->d_name);
+				if ( name.size()<=4 || name.compare(name.size()-4, 4, ".pcm")!=0 ) continue;
+
+				struct stat info;
+				if ( stat((mDirectory + "/" + name).c_str(), &info)!=0 || !S_ISREG(info.st_mode) ) continue;
+
+				Entry e;
+				e.mSize = static_cast<size_t>(info.st_size);
+				e.mLastUsed = static_cast<unsigned long long>(info.st_mtime);
+				mEntries[name] = e;
+				mSize += e.mSize;
+			}
+			closedir(dir);
+		}
+		else
+			Ogre::LogManager::getSingleton().logMessage("*** OgreOggSoundDecodeCache - Unable to open directory: "+mDirectory);
+#endif
+		Ogre::LogManager::getSingleton().logMessage("*** --- Decode cache: " + mDirectory + ", " + 
+			Ogre::StringConverter::toString(static_cast<unsigned int>(mEntries.size())) + " entries, " + 
+			Ogre::StringConverter::toString(static_cast<unsigned long>(mSize)) + " bytes");
+
+		_trim(mMaxSize);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggSoundDecodeCache::~OgreOggSoundDecodeCache()
+	{
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	const char* OgreOggSoundDecodeCache::find(const Ogre::String& key, int channels, long rate, OgreOggMappedFile& file, size_t& size)
+	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mMutex);
+#	endif
+#endif
+
+		const Ogre::String name = _getFileName(key);
+		EntryMap::iterator i = mEntries.find(name);
+		if ( i==mEntries.end() || !file.open(mDirectory + "/" + name) )
+		{
+			++mMisses;
+			return 0;
+		}
+
+		// Check entry matches before trusting it
+		const DecodeCacheHeader* header = reinterpret_cast<const DecodeCacheHeader*>(file.getData());
+		const size_t dataOffset = sizeof(DecodeCacheHeader) + ((key.size() + 3) & ~static_cast<size_t>(3));
+		if ( file.getSize()<dataOffset || 
+			 memcmp(header->mMagic, "OOSC", 4)!=0 || 
+			 header->mVersion!=DECODE_CACHE_VERSION || 
+			 header->mChannels!=static_cast<unsigned int>(channels) || 
+			 header->mRate!=static_cast<unsigned int>(rate) || 
+			 header->mKeySize!=key.size() || 
+			 memcmp(file.getData() + sizeof(DecodeCacheHeader), key.data(), key.size())!=0 || 
+			 file.getSize()!=dataOffset + header->mDataSize )
+		{
+			file.close();
+			++mMisses;
+			return 0;
+		}
+
+		i->second.mLastUsed = static_cast<unsigned long long>(std::time(0));
+		_touch(name);
+		++mHits;
+
+		size = static_cast<size_t>(header->mDataSize);
+		return file.getData() + dataOffset;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundDecodeCache::store(const Ogre::String& key, int channels, long rate, const char* data, size_t size)
+	{
+		const size_t padding = ((key.size() + 3) & ~static_cast<size_t>(3)) - key.size();
+		const size_t fileSize = sizeof(DecodeCacheHeader) + key.size() + padding + size;
+		if ( !data || !size || fileSize>mMaxSize ) return;
+
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mMutex);
+#	endif
+#endif
+
+		const Ogre::String name = _getFileName(key);
+		const Ogre::String path = mDirectory + "/" + name;
+		const Ogre::String temp = path + ".tmp";
+
+		DecodeCacheHeader header;
+		memcpy(header.mMagic, "OOSC", 4);
+		header.mVersion = DECODE_CACHE_VERSION;
+		header.mChannels = static_cast<unsigned int>(channels);
+		header.mRate = static_cast<unsigned int>(rate);
+		header.mDataSize = size;
+		header.mKeySize = static_cast<unsigned int>(key.size());
+		header.mReserved = 0;
+
+		// Write aside so a partial entry is never found
+		{
+			std::ofstream out(temp.c_str(), std::ios::out|std::ios::binary);
+			if ( !out.is_open() )
+			{
+				Ogre::LogManager::getSingleton().logMessage("*** OgreOggSoundDecodeCache::store() - Unable to write: "+temp);
+				return;
+			}
+
+			const char zero[4] = {0, 0, 0, 0};
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(key.data(), key.size());
+			out.write(zero, padding);
+			out.write(data, size);
+			if ( !out.good() )
+			{
+				out.close();
+				std::remove(temp.c_str());
+				Ogre::LogManager::getSingleton().logMessage("*** OgreOggSoundDecodeCache::store() - Unable to write: "+temp);
+				return;
+			}
+		}
+
+		// Replace any stale entry
+		EntryMap::iterator i = mEntries.find(name);
+		if ( i!=mEntries.end() )
+		{
+			mSize -= i->second.mSize;
+			mEntries.erase(i);
+		}
+		std::remove(path.c_str());
+		if ( std::rename(temp.c_str(), path.c_str())!=0 )
+		{
+			std::remove(temp.c_str());
+			return;
+		}
+
+		_trim(mMaxSize - fileSize);
+
+		Entry e;
+		e.mSize = fileSize;
+		e.mLastUsed = static_cast<unsigned long long>(std::time(0));
+		mEntries[name] = e;
+		mSize += fileSize;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundDecodeCache::setMaxSize(size_t bytes)
+	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mMutex);
+#	endif
+#endif
+
+		mMaxSize = bytes;
+		_trim(mMaxSize);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	unsigned long long OgreOggSoundDecodeCache::hash(const void* data, size_t size, unsigned long long hash)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for ( size_t i=0; i<size; ++i )
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	Ogre::String OgreOggSoundDecodeCache::_getFileName(const Ogre::String& key) const
+	{
+		char name[32];
+		sprintf(name, "%016llx.pcm", hash(key.data(), key.size()));
+		return name;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundDecodeCache::_trim(size_t budget)
+	{
+		while ( mSize>budget && !mEntries.empty() )
+		{
+			EntryMap::iterator oldest = mEntries.begin();
+			for ( EntryMap::iterator i=mEntries.begin(); i!=mEntries.end(); ++i )
+				if ( i->second.mLastUsed<oldest->second.mLastUsed ) oldest = i;
+
+			std::remove((mDirectory + "/" + oldest->first).c_str());
+			mSize -= oldest->second.mSize;
+			mEntries.erase(oldest);
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundDecodeCache::_touch(const Ogre::String& name)
+	{
+		const Ogre::String path = mDirectory + "/" + name;
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		// Attribute access doesn't conflict with the open mapping
+		HANDLE file = CreateFileA(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if ( file==INVALID_HANDLE_VALUE ) return;
+
+		SYSTEMTIME now;
+		FILETIME written;
+		GetSystemTime(&now);
+		SystemTimeToFileTime(&now, &written);
+		SetFileTime(file, 0, 0, &written);
+		CloseHandle(file);
+#else
+		utime(path.c_str(), 0);
+#endif
+	}
+}
@@ -0,0 +1,563 @@
+/**
+* @file OgreOggSoundKernels.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE. 
+*
+*/
+
+#include "OgreOggSoundKernels.h"
+
+#include <atomic>
+#include <cmath>
+
+// Vector instruction sets compiled in, SSE2 and NEON are baseline where enabled
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#	define OGGSOUND_SSE2 1
+#	include <emmintrin.h>
+#	if defined(_MSC_VER) && _MSC_VER>=1900
+#		define OGGSOUND_AVX2 1
+#		define OGGSOUND_TARGET_AVX2
+#		include <immintrin.h>
+#		include <intrin.h>
+#	elif defined(__clang__) || ( defined(__GNUC__) && (__GNUC__ * 100 + __GNUC_MINOR__)>=409 )
+#		define OGGSOUND_AVX2 1
+#		define OGGSOUND_TARGET_AVX2 __attribute__((target("avx2")))
+#		include <immintrin.h>
+#	endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#	define OGGSOUND_NEON 1
+#	include <arm_neon.h>
+#endif
+
+namespace OgreOggSound
+{
+	//! Clamp range for float to 16-bit conversion
+	static const float INT16_MIN_FLOAT = -32768.f;
+	static const float INT16_MAX_FLOAT = 32767.f;
+
+	/** Clamps and rounds a scaled sample to nearest even.
+	@remarks
+		Compared in the same order as the vector versions so NaN clamps to the minimum.
+	 */
+	static inline short _toInt16(float v)
+	{
+		v = ( v>INT16_MIN_FLOAT ) ? v : INT16_MIN_FLOAT;
+		v = ( v<INT16_MAX_FLOAT ) ? v : INT16_MAX_FLOAT;
+		return static_cast<short>(std::lrint(v));
+	}
+
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _convert8To16Scalar(const unsigned char* in, size_t count, short* out)
+	{
+		for ( size_t i=0; i<count; ++i ) out[i] = static_cast<short>((in[i] - 128) * 256);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _floatToInt16Scalar(const float* in, size_t count, short* out, float gain)
+	{
+		const float scale = 32768.f * gain;
+		for ( size_t i=0; i<count; ++i ) out[i] = _toInt16(in[i] * scale);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _interleaveFloatScalar(const float* const* planes, int channels, size_t frames, float* out)
+	{
+		switch(channels)
+		{
+		case 1:
+			{
+				const float* l = planes[0];
+				for ( size_t i=0; i<frames; ++i ) out[i] = l[i];
+			}
+			break;
+		case 2:
+			{
+				const float* l = planes[0];
+				const float* r = planes[1];
+				for ( size_t i=0; i<frames; ++i )
+				{
+					out[i*2] = l[i];
+					out[i*2+1] = r[i];
+				}
+			}
+			break;
+		default:
+			{
+				// Strided writes, one channel at a time
+				for ( int c=0; c<channels; ++c )
+				{
+					const float* in = planes[c];
+					float* o = out + c;
+					for ( size_t i=0; i<frames; ++i, o+=channels ) *o = in[i];
+				}
+			}
+			break;
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _interleaveToInt16Scalar(const float* const* planes, int channels, size_t frames, short* out, float gain)
+	{
+		const float scale = 32768.f * gain;
+		for ( int c=0; c<channels; ++c )
+		{
+			const float* in = planes[c];
+			short* o = out + c;
+			for ( size_t i=0; i<frames; ++i, o+=channels ) *o = _toInt16(in[i] * scale);
+		}
+	}
+
+#if OGGSOUND_SSE2
+	/** Clamps and rounds 4 scaled samples to 32-bit integers.
+	@remarks
+		maxps returns its second operand for NaN, matching _toInt16().
+	 */
+	static inline __m128i _toInt32SSE2(__m128 v, __m128 lo, __m128 hi)
+	{
+		return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi));
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _convert8To16SSE2(const unsigned char* in, size_t count, short* out)
+	{
+		const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+		for ( ; i+16<=count; i+=16 )
+		{
+			// Flip to signed then move into the high byte
+			__m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), bias);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(zero, x));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpackhi_epi8(zero, x));
+		}
+		_convert8To16Scalar(in + i, count - i, out + i);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _floatToInt16SSE2(const float* in, size_t count, short* out, float gain)
+	{
+		const __m128 scale = _mm_set1_ps(32768.f * gain);
+		const __m128 lo = _mm_set1_ps(INT16_MIN_FLOAT);
+		const __m128 hi = _mm_set1_ps(INT16_MAX_FLOAT);
+		size_t i = 0;
+		for ( ; i+8<=count; i+=8 )
+		{
+			__m128i a = _toInt32SSE2(_mm_mul_ps(_mm_loadu_ps(in + i), scale), lo, hi);
+			__m128i b = _toInt32SSE2(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), lo, hi);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+		}
+		_floatToInt16Scalar(in + i, count - i, out + i, gain);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _interleaveFloatSSE2(const float* const* planes, int channels, size_t frames, float* out)
+	{
+		if ( channels!=2 ) 
+		{
+			_interleaveFloatScalar(planes, channels, frames, out);
+			return;
+		}
+
+		const float* l = planes[0];
+		const float* r = planes[1];
+		size_t i = 0;
+		for ( ; i+4<=frames; i+=4 )
+		{
+			__m128 a = _mm_loadu_ps(l + i);
+			__m128 b = _mm_loadu_ps(r + i);
+			_mm_storeu_ps(out + i*2, _mm_unpacklo_ps(a, b));
+			_mm_storeu_ps(out + i*2 + 4, _mm_unpackhi_ps(a, b));
+		}
+		const float* rest[2] = { l + i, r + i };
+		_interleaveFloatScalar(rest, 2, frames - i, out + i*2);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _interleaveToInt16SSE2(const float* const* planes, int channels, size_t frames, short* out, float gain)
+	{
+		if ( channels==1 ) 
+		{
+			_floatToInt16SSE2(planes[0], frames, out, gain);
+			return;
+		}
+		if ( channels!=2 ) 
+		{
+			_interleaveToInt16Scalar(planes, channels, frames, out, gain);
+			return;
+		}
+
+		const __m128 scale = _mm_set1_ps(32768.f * gain);
+		const __m128 lo = _mm_set1_ps(INT16_MIN_FLOAT);
+		const __m128 hi = _mm_set1_ps(INT16_MAX_FLOAT);
+		const float* l = planes[0];
+		const float* r = planes[1];
+		size_t i = 0;
+		for ( ; i+4<=frames; i+=4 )
+		{
+			__m128 a = _mm_mul_ps(_mm_loadu_ps(l + i), scale);
+			__m128 b = _mm_mul_ps(_mm_loadu_ps(r + i), scale);
+			__m128i x = _toInt32SSE2(_mm_unpacklo_ps(a, b), lo, hi);
+			__m128i y = _toInt32SSE2(_mm_unpackhi_ps(a, b), lo, hi);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i*2), _mm_packs_epi32(x, y));
+		}
+		const float* rest[2] = { l + i, r + i };
+		_interleaveToInt16Scalar(rest, 2, frames - i, out + i*2, gain);
+	}
+#endif
+
+#if OGGSOUND_AVX2
+	/** Clamps and rounds 8 scaled samples to 32-bit integers.
+	 */
+	OGGSOUND_TARGET_AVX2 static inline __m256i _toInt32AVX2(__m256 v, __m256 lo, __m256 hi)
+	{
+		return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(v, lo), hi));
+	}
+	/** Packs two sets of 8 integers to 16 ordered 16-bit samples.
+	@remarks
+		packs works within 128-bit lanes, so the middle quarters are swapped back.
+	 */
+	OGGSOUND_TARGET_AVX2 static inline __m256i _packInt16AVX2(__m256i a, __m256i b)
+	{
+		return _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OGGSOUND_TARGET_AVX2 static void _convert8To16AVX2(const unsigned char* in, size_t count, short* out)
+	{
+		const __m256i bias = _mm256_set1_epi16(128);
+		size_t i = 0;
+		for ( ; i+16<=count; i+=16 )
+		{
+			__m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_slli_epi16(_mm256_sub_epi16(x, bias), 8));
+		}
+		_convert8To16Scalar(in + i, count - i, out + i);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OGGSOUND_TARGET_AVX2 static void _floatToInt16AVX2(const float* in, size_t count, short* out, float gain)
+	{
+		const __m256 scale = _mm256_set1_ps(32768.f * gain);
+		const __m256 lo = _mm256_set1_ps(INT16_MIN_FLOAT);
+		const __m256 hi = _mm256_set1_ps(INT16_MAX_FLOAT);
+		size_t i = 0;
+		for ( ; i+16<=count; i+=16 )
+		{
+			__m256i a = _toInt32AVX2(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), lo, hi);
+			__m256i b = _toInt32AVX2(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale), lo, hi);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _packInt16AVX2(a, b));
+		}
+		_floatToInt16Scalar(in + i, count - i, out + i, gain);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OGGSOUND_TARGET_AVX2 static void _interleaveFloatAVX2(const float* const* planes, int channels, size_t frames, float* out)
+	{
+		if ( channels!=2 ) 
+		{
+			_interleaveFloatScalar(planes, channels, frames, out);
+			return;
+		}
+
+		const float* l = planes[0];
+		const float* r = planes[1];
+		size_t i = 0;
+		for ( ; i+8<=frames; i+=8 )
+		{
+			// Frames 0,1,4,5 and 2,3,6,7
+			__m256 a = _mm256_loadu_ps(l + i);
+			__m256 b = _mm256_loadu_ps(r + i);
+			__m256 x = _mm256_unpacklo_ps(a, b);
+			__m256 y = _mm256_unpackhi_ps(a, b);
+			_mm256_storeu_ps(out + i*2, _mm256_permute2f128_ps(x, y, 0x20));
+			_mm256_storeu_ps(out + i*2 + 8, _mm256_permute2f128_ps(x, y, 0x31));
+		}
+		const float* rest[2] = { l + i, r + i };
+		_interleaveFloatScalar(rest, 2, frames - i, out + i*2);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OGGSOUND_TARGET_AVX2 static void _interleaveToInt16AVX2(const float* const* planes, int channels, size_t frames, short* out, float gain)
+	{
+		if ( channels==1 ) 
+		{
+			_floatToInt16AVX2(planes[0], frames, out, gain);
+			return;
+		}
+		if ( channels!=2 ) 
+		{
+			_interleaveToInt16Scalar(planes, channels, frames, out, gain);
+			return;
+		}
+
+		const __m256 scale = _mm256_set1_ps(32768.f * gain);
+		const __m256 lo = _mm256_set1_ps(INT16_MIN_FLOAT);
+		const __m256 hi = _mm256_set1_ps(INT16_MAX_FLOAT);
+		const float* l = planes[0];
+		const float* r = planes[1];
+		size_t i = 0;
+		for ( ; i+8<=frames; i+=8 )
+		{
+			__m256 a = _mm256_mul_ps(_mm256_loadu_ps(l + i), scale);
+			__m256 b = _mm256_mul_ps(_mm256_loadu_ps(r + i), scale);
+			__m256 x = _mm256_unpacklo_ps(a, b);
+			__m256 y = _mm256_unpackhi_ps(a, b);
+			__m256i first = _toInt32AVX2(_mm256_permute2f128_ps(x, y, 0x20), lo, hi);
+			__m256i second = _toInt32AVX2(_mm256_permute2f128_ps(x, y, 0x31), lo, hi);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i*2), _packInt16AVX2(first, second));
+		}
+		const float* rest[2] = { l + i, r + i };
+		_interleaveToInt16Scalar(rest, 2, frames - i, out + i*2, gain);
+	}
+#endif
+
+#if OGGSOUND_NEON
+	/** Clamps and rounds 4 scaled samples to 32-bit integers.
+	@remarks
+		Selects rather than vmaxq/vminq so NaN clamps to the minimum like _toInt16().
+	 */
+	static inline int32x4_t _toInt32NEON(float32x4_t v, float32x4_t lo, float32x4_t hi)
+	{
+		v = vbslq_f32(vcgtq_f32(v, lo), v, lo);
+		v = vbslq_f32(vcltq_f32(v, hi), v, hi);
+		return vcvtnq_s32_f32(v);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _convert8To16NEON(const unsigned char* in, size_t count, short* out)
+	{
+		const uint8x16_t bias = vdupq_n_u8(0x80);
+		size_t i = 0;
+		for ( ; i+16<=count; i+=16 )
+		{
+			int8x16_t x = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(in + i), bias));
+			vst1q_s16(reinterpret_cast<int16_t*>(out + i), vshll_n_s8(vget_low_s8(x), 8));
+			vst1q_s16(reinterpret_cast<int16_t*>(out + i + 8), vshll_n_s8(vget_high_s8(x), 8));
+		}
+		_convert8To16Scalar(in + i, count - i, out + i);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _floatToInt16NEON(const float* in, size_t count, short* out, float gain)
+	{
+		const float32x4_t scale = vdupq_n_f32(32768.f * gain);
+		const float32x4_t lo = vdupq_n_f32(INT16_MIN_FLOAT);
+		const float32x4_t hi = vdupq_n_f32(INT16_MAX_FLOAT);
+		size_t i = 0;
+		for ( ; i+8<=count; i+=8 )
+		{
+			int32x4_t a = _toInt32NEON(vmulq_f32(vld1q_f32(in + i), scale), lo, hi);
+			int32x4_t b = _toInt32NEON(vmulq_f32(vld1q_f32(in + i + 4), scale), lo, hi);
+			vst1q_s16(reinterpret_cast<int16_t*>(out + i), vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+		}
+		_floatToInt16Scalar(in + i, count - i, out + i, gain);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _interleaveFloatNEON(const float* const* planes, int channels, size_t frames, float* out)
+	{
+		if ( channels!=2 ) 
+		{
+			_interleaveFloatScalar(planes, channels, frames, out);
+			return;
+		}
+
+		const float* l = planes[0];
+		const float* r = planes[1];
+		size_t i = 0;
+		for ( ; i+4<=frames; i+=4 )
+		{
+			float32x4x2_t v;
+			v.val[0] = vld1q_f32(l + i);
+			v.val[1] = vld1q_f32(r + i);
+			vst2q_f32(out + i*2, v);
+		}
+		const float* rest[2] = { l + i, r + i };
+		_interleaveFloatScalar(rest, 2, frames - i, out + i*2);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static void _interleaveToInt16NEON(const float* const* planes, int channels, size_t frames, short* out, float gain)
+	{
+		if ( channels==1 ) 
+		{
+			_floatToInt16NEON(planes[0], frames, out, gain);
+			return;
+		}
+		if ( channels!=2 ) 
+		{
+			_interleaveToInt16Scalar(planes, channels, frames, out, gain);
+			return;
+		}
+
+		const float32x4_t scale = vdupq_n_f32(32768.f * gain);
+		const float32x4_t lo = vdupq_n_f32(INT16_MIN_FLOAT);
+		const float32x4_t hi = vdupq_n_f32(INT16_MAX_FLOAT);
+		const float* l = planes[0];
+		const float* r = planes[1];
+		size_t i = 0;
+		for ( ; i+4<=frames; i+=4 )
+		{
+			int16x4x2_t v;
+			v.val[0] = vqmovn_s32(_toInt32NEON(vmulq_f32(vld1q_f32(l + i), scale), lo, hi));
+			v.val[1] = vqmovn_s32(_toInt32NEON(vmulq_f32(vld1q_f32(r + i), scale), lo, hi));
+			vst2_s16(reinterpret_cast<int16_t*>(out + i*2), v);
+		}
+		const float* rest[2] = { l + i, r + i };
+		_interleaveToInt16Scalar(rest, 2, frames - i, out + i*2, gain);
+	}
+#endif
+
+	//! Kernels for one instruction set
+	struct KernelTable
+	{
+		void (*mConvert8To16)(const unsigned char*, size_t, short*);
+		void (*mFloatToInt16)(const float*, size_t, short*, float);
+		void (*mInterleaveFloat)(const float* const*, int, size_t, float*);
+		void (*mInterleaveToInt16)(const float* const*, int, size_t, short*, float);
+	};
+
+	static const KernelTable SCALAR_KERNELS = { _convert8To16Scalar, _floatToInt16Scalar, _interleaveFloatScalar, _interleaveToInt16Scalar };
+#if OGGSOUND_SSE2
+	static const KernelTable SSE2_KERNELS = { _convert8To16SSE2, _floatToInt16SSE2, _interleaveFloatSSE2, _interleaveToInt16SSE2 };
+#endif
+#if OGGSOUND_AVX2
+	static const KernelTable AVX2_KERNELS = { _convert8To16AVX2, _floatToInt16AVX2, _interleaveFloatAVX2, _interleaveToInt16AVX2 };
+#endif
+#if OGGSOUND_NEON
+	static const KernelTable NEON_KERNELS = { _convert8To16NEON, _floatToInt16NEON, _interleaveFloatNEON, _interleaveToInt16NEON };
+#endif
+
+	//! Indexed by InstructionSet, null where not compiled in
+	static const KernelTable* const KERNELS[] =
+	{
+		&SCALAR_KERNELS,
+#if OGGSOUND_SSE2
+		&SSE2_KERNELS,
+#else
+		0,
+#endif
+#if OGGSOUND_AVX2
+		&AVX2_KERNELS,
+#else
+		0,
+#endif
+#if OGGSOUND_NEON
+		&NEON_KERNELS,
+#else
+		0,
+#endif
+	};
+
+	//! Instruction set in use, -1 until detected
+	static std::atomic<int> sInstructionSet(-1);
+
+	/** Checks the CPU, and OS for AVX state, support an instruction set.
+	 */
+	static bool _cpuSupports(OgreOggSoundKernels::InstructionSet set)
+	{
+		switch(set)
+		{
+#if OGGSOUND_AVX2
+		case OgreOggSoundKernels::IS_AVX2:
+#	ifdef _MSC_VER
+			{
+				int info[4];
+				__cpuid(info, 0);
+				if ( info[0]<7 ) return false;
+
+				// OSXSAVE and AVX, then YMM state enabled by the OS
+				__cpuid(info, 1);
+				if ( (info[2] & (1 << 27))==0 || (info[2] & (1 << 28))==0 ) return false;
+				if ( (_xgetbv(0) & 6)!=6 ) return false;
+
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5))!=0;
+			}
+#	else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2")!=0;
+#	endif
+#endif
+		default:
+			return true;
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	static inline const KernelTable& _getKernels()
+	{
+		return *KERNELS[OgreOggSoundKernels::getInstructionSet()];
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggSoundKernels::InstructionSet OgreOggSoundKernels::getInstructionSet()
+	{
+		int set = sInstructionSet.load(std::memory_order_relaxed);
+		if ( set<0 )
+		{
+			// Best available
+			if		( isSupported(IS_AVX2) ) set = IS_AVX2;
+			else if ( isSupported(IS_SSE2) ) set = IS_SSE2;
+			else if ( isSupported(IS_NEON) ) set = IS_NEON;
+			else							 set = IS_SCALAR;
+			sInstructionSet.store(set, std::memory_order_relaxed);
+		}
+		return static_cast<InstructionSet>(set);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundKernels::setInstructionSet(InstructionSet set)
+	{
+		if ( !isSupported(set) ) return false;
+
+		sInstructionSet.store(set, std::memory_order_relaxed);
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundKernels::isSupported(InstructionSet set)
+	{
+		if ( set<IS_SCALAR || set>IS_NEON || !KERNELS[set] ) return false;
+
+		return _cpuSupports(set);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	const char* OgreOggSoundKernels::getName(InstructionSet set)
+	{
+		switch(set)
+		{
+		case IS_SCALAR: return "scalar";
+		case IS_SSE2: return "sse2";
+		case IS_AVX2: return "avx2";
+		case IS_NEON: return "neon";
+		}
+		return "unknown";
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundKernels::convert8To16(const unsigned char* in, size_t count, short* out)
+	{
+		_getKernels().mConvert8To16(in, count, out);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundKernels::floatToInt16(const float* in, size_t count, short* out, float gain)
+	{
+		_getKernels().mFloatToInt16(in, count, out, gain);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundKernels::interleaveFloat(const float* const* planes, int channels, size_t frames, float* out)
+	{
+		_getKernels().mInterleaveFloat(planes, channels, frames, out);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundKernels::interleaveToInt16(const float* const* planes, int channels, size_t frames, short* out, float gain)
+	{
+		_getKernels().mInterleaveToInt16(planes, channels, frames, out, gain);
+	}
+}
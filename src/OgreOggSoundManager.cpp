@@ -32,9 +32,34 @@
 
 #include "OgreOggSoundManager.h"
 #include "OgreOggSound.h"
+#include "OgreOggSoundAdpcm.h"
+#include "OgreOggSoundKernels.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <string>
 
+// ALC_SOFT_loopback tokens, for headers which predate the extension
+#ifndef ALC_FORMAT_CHANNELS_SOFT
+#	define ALC_FORMAT_CHANNELS_SOFT		0x1990
+#	define ALC_FORMAT_TYPE_SOFT			0x1991
+#endif
+#ifndef ALC_MONO_SOFT
+#	define ALC_MONO_SOFT				0x1500
+#	define ALC_STEREO_SOFT				0x1501
+#endif
+#ifndef ALC_SHORT_SOFT
+#	define ALC_SHORT_SOFT				0x1402
+#endif
+
+// Frames mixed between stream refills when rendering loopback
+#define LOOPBACK_BLOCK_FRAMES 1024
+
+// Samples per compressed static block with AL_SOFT_block_alignment, 512 bytes per mono block
+#define IMA4_BLOCK_SAMPLES 1017
+
 #if OGGSOUND_THREADED
 #   ifdef POCO_THREAD
 		Poco::Thread* OgreOggSound::OgreOggSoundManager::mUpdateThread = 0;
@@ -43,11 +68,15 @@
 		Poco::Mutex OgreOggSound::OgreOggSoundManager::mMutex;
 		Poco::Mutex OgreOggSound::OgreOggSoundManager::mSoundMutex;
 		Poco::Mutex OgreOggSound::OgreOggSoundManager::mResourceGroupNameMutex;
+		Poco::Event OgreOggSound::OgreOggSoundManager::mStreamingEvent;
 #   else
 		boost::thread *OgreOggSound::OgreOggSoundManager::mUpdateThread = 0;
 		boost::recursive_mutex OgreOggSound::OgreOggSoundManager::mMutex;
 		boost::recursive_mutex OgreOggSound::OgreOggSoundManager::mSoundMutex;
 		boost::recursive_mutex OgreOggSound::OgreOggSoundManager::mResourceGroupNameMutex;
+		boost::mutex OgreOggSound::OgreOggSoundManager::mStreamingWakeMutex;
+		boost::condition_variable OgreOggSound::OgreOggSoundManager::mStreamingWakeCondition;
+		bool OgreOggSound::OgreOggSoundManager::mStreamingWakePending = false;
 #	endif
 	bool OgreOggSound::OgreOggSoundManager::mShuttingDown = false;
 #endif
@@ -88,6 +117,49 @@ namespace OgreOggSound
 		,mMaxSources(100)
 		,mResourceGroupName("")
 		,mGlobalPitch(1.f)
+		,mStreamRefills(0)
+		,mDecodeAllocations(0)
+		,mStreamUnderruns(0)
+		,mSourcesStolen(0)
+		,mSourceHeapListenerPos(Ogre::Vector3::ZERO)
+		,mActionQueueHighWater(0)
+		,mActionsDropped(0)
+		,mStatisticsWindow(0.f)
+		,mWindowDecodeBytes(0)
+		,mWindowRefills(0)
+		,mWindowRefillTime(0)
+		,mWindowMaxRefillTime(0)
+		,mDecodeBytesPerSecond(0.f)
+		,mRefillLatency(0.f)
+		,mMaxRefillLatency(0.f)
+		,mKeepStaticAudioData(false)
+		,mCompressStaticAudio(false)
+		,mIma4Support(false)
+		,mMsAdpcmSupport(false)
+		,mBlockAlignmentSupport(false)
+		,mFloatDecoding(false)
+		,mFloat32Support(false)
+		,mALDeferUpdates(0)
+		,mALProcessUpdates(0)
+		,mALBufferSubData(0)
+		,mALCalls(0)
+		,mALCallsPerFrame(0)
+		,mALCRenderSamples(0)
+		,mLoopbackFrequency(0)
+		,mLoopbackChannels(0)
+		,mPreloader(0)
+		,mDecodeCache(0)
+		,mStreamDecoder(0)
+		,mStreamDecodeAhead(0.f)
+		,mStreamDecodeThreads(0)
+		,mPreloadThreads(0)
+		,mCompressedSoundMemory(0)
+		,mSharedBufferBudget(0)
+		,mSharedBufferCacheSize(0)
+		,mSharedBufferHits(0)
+		,mSharedBufferMisses(0)
+		,mSharedBufferEvictions(0)
+		,mVirtualVoices(false)
 		,mSoundsToDestroy(0)
 		,mFadeVolume(false)
 		,mFadeIn(false)
@@ -96,6 +168,9 @@ namespace OgreOggSound
 #if OGGSOUND_THREADED
 		,mActionsList(0)
 		,mForceMutex(false)
+		,mStreamingMaxSleep(50)
+		,mStreamingWakeups(0)
+		,mStreamingSleeping(false)
 #endif
 		{
 #if HAVE_EFX
@@ -149,7 +224,12 @@ namespace OgreOggSound
 		mShuttingDown = true;
 		if ( mUpdateThread )
 		{
+			_notifyStreamingThread();
 			mUpdateThread->join();
+
+			Ogre::LogManager::getSingleton().logMessage("*** --- Streaming thread woke " + Ogre::StringConverter::toString(mStreamingWakeups.load()) +
+				" times, " + Ogre::StringConverter::toString(getStreamingWakeupsSaved()) + " fewer than 10ms polling", Ogre::LML_NORMAL);
+
 			OGRE_FREE(mUpdateThread, Ogre::MEMCATEGORY_GENERAL);
 			mUpdateThread = 0;
 			mShuttingDown=false;
@@ -160,38 +240,7 @@ namespace OgreOggSound
 		}
 		if ( mActionsList )
 		{
-			if ( !mActionsList->empty() )
-			{
-				SoundAction obj;
-				// Clear out action list
-				while (mActionsList->pop(obj))
-				{
-					// If parameters specified delete structure
-					if (obj.mParams)
-					{
-						switch ( obj.mAction )
-						{			
-						case LQ_LOAD:
-							{
-								OGRE_DELETE_T(static_cast<cSound*>(obj.mParams), cSound, Ogre::MEMCATEGORY_GENERAL);
-							}
-							break;	   
-						case LQ_ATTACH_EFX:
-						case LQ_DETACH_EFX:
-						case LQ_SET_EFX_PROPERTY:
-							{
-								OGRE_DELETE_T(static_cast<efxProperty*>(obj.mParams), efxProperty, Ogre::MEMCATEGORY_GENERAL);
-							}
-							break;	 
-						default:
-							{
-								OGRE_FREE(obj.mParams, Ogre::MEMCATEGORY_GENERAL);
-							}
-							break;
-						}
-					}
-				}
-			}
+			// Actions own no memory so can simply be discarded
 			delete mActionsList;
 			mActionsList=0;
 		}
@@ -202,8 +251,28 @@ namespace OgreOggSound
 			mSoundsToDestroy=0;
 		}
 
+		// Streaming thread has stopped collecting decoded sounds
+		if ( mPreloader )
+		{
+			OGRE_DELETE_T(mPreloader, OgreOggSoundPreloader, Ogre::MEMCATEGORY_GENERAL);
+			mPreloader=0;
+		}
+
 		_releaseAll();
 
+		// Nothing left loading
+		if ( mDecodeCache )
+		{
+			OGRE_DELETE_T(mDecodeCache, OgreOggSoundDecodeCache, Ogre::MEMCATEGORY_GENERAL);
+			mDecodeCache=0;
+		}
+
+		if ( mStreamDecoder )
+		{
+			OGRE_DELETE_T(mStreamDecoder, OgreOggStreamDecoder, Ogre::MEMCATEGORY_GENERAL);
+			mStreamDecoder=0;
+		}
+
 		if ( mRecorder ) { OGRE_DELETE_T(mRecorder, OgreOggSoundRecord, Ogre::MEMCATEGORY_GENERAL); mRecorder=0; }
 
 		alcMakeContextCurrent(0);
@@ -334,11 +403,87 @@ namespace OgreOggSound
 		Ogre::LogManager::getSingleton().logMessage("*** --- OpenAL Device successfully created");
 
 #if HAVE_EFX
-        ALint attribs[2] = {ALC_MAX_AUXILIARY_SENDS, 4};
+		ALCint attribs[3] = {ALC_MAX_AUXILIARY_SENDS, 4, 0};
 #else
-        ALint attribs[1] = {4};
+		ALCint attribs[1] = {0};
+#endif
+
+		return _initContext(attribs, queueListSize, scnMgr);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::initLoopback(	unsigned int frequency, 
+											unsigned int channels, 
+											unsigned int maxSources, 
+											unsigned int queueListSize, 
+											SceneManager* scnMgr)
+	{
+		if (mDevice) return true;
+
+		Ogre::LogManager::getSingleton().logMessage("*****************************************", Ogre::LML_NORMAL);
+		Ogre::LogManager::getSingleton().logMessage("*** --- Initialising OgreOggSound --- ***", Ogre::LML_NORMAL);
+		Ogre::LogManager::getSingleton().logMessage("*** ---     "+OGREOGGSOUND_VERSION_STRING+"    --- ***", Ogre::LML_NORMAL);
+		Ogre::LogManager::getSingleton().logMessage("*****************************************", Ogre::LML_NORMAL);
+
+		// Set source limit
+		mMaxSources = maxSources;
+
+		if ( alcIsExtensionPresent(NULL, "ALC_SOFT_loopback")==AL_FALSE )
+		{
+			Ogre::LogManager::getSingletonPtr()->logMessage("OgreOggSoundManager::initLoopback() ERROR - ALC_SOFT_loopback NOT supported", Ogre::LML_CRITICAL);
+			return false;
+		}
+
+		LPALCLOOPBACKOPENDEVICESOFT openDevice = (LPALCLOOPBACKOPENDEVICESOFT)alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT");
+		LPALCISRENDERFORMATSUPPORTEDSOFT isFormatSupported = (LPALCISRENDERFORMATSUPPORTEDSOFT)alcGetProcAddress(NULL, "alcIsRenderFormatSupportedSOFT");
+		mALCRenderSamples = (LPALCRENDERSAMPLESSOFT)alcGetProcAddress(NULL, "alcRenderSamplesSOFT");
+		if ( !openDevice || !isFormatSupported || !mALCRenderSamples )
+		{
+			mALCRenderSamples = 0;
+			Ogre::LogManager::getSingletonPtr()->logMessage("OgreOggSoundManager::initLoopback() ERROR - Unable to get ALC_SOFT_loopback functions", Ogre::LML_CRITICAL);
+			return false;
+		}
+
+		mDevice = openDevice(NULL);
+		if (!mDevice)
+		{
+			mALCRenderSamples = 0;
+			Ogre::LogManager::getSingletonPtr()->logMessage("OgreOggSoundManager::initLoopback() ERROR - Unable to open loopback device", Ogre::LML_CRITICAL);
+			return false;
+		}
+
+		// 16 bit mono/stereo only
+		const ALCint format = channels==1 ? ALC_MONO_SOFT : ALC_STEREO_SOFT;
+		if ( (channels!=1 && channels!=2) || !isFormatSupported(mDevice, static_cast<ALCsizei>(frequency), format, ALC_SHORT_SOFT) )
+		{
+			alcCloseDevice(mDevice);
+			mDevice = 0;
+			mALCRenderSamples = 0;
+			Ogre::LogManager::getSingletonPtr()->logMessage("OgreOggSoundManager::initLoopback() ERROR - Render format NOT supported", Ogre::LML_CRITICAL);
+			return false;
+		}
+
+		mLoopbackFrequency = frequency;
+		mLoopbackChannels = channels;
+
+		Ogre::LogManager::getSingleton().logMessage("*** --- OpenAL Loopback device successfully created: " + 
+			Ogre::StringConverter::toString(frequency) + "Hz, " + Ogre::StringConverter::toString(channels) + " channel(s)");
+
+		ALCint attribs[] = 
+		{
+			ALC_FREQUENCY, static_cast<ALCint>(frequency), 
+			ALC_FORMAT_CHANNELS_SOFT, format, 
+			ALC_FORMAT_TYPE_SOFT, ALC_SHORT_SOFT, 
+#if HAVE_EFX
+			ALC_MAX_AUXILIARY_SENDS, 4,
 #endif
+			0
+		};
 
+		return _initContext(attribs, queueListSize, scnMgr);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_initContext(const ALCint* attribs, unsigned int queueListSize, SceneManager* scnMgr)
+	{
 		mContext = alcCreateContext(mDevice, attribs);
 		if (!mContext)
 		{
@@ -380,7 +525,7 @@ namespace OgreOggSound
 
 		mNumSources = _createSourcePool();
 
-		msg="*** --- Created " + Ogre::StringConverter::toString(mNumSources) + " sources for simultaneous sounds";
+		Ogre::String msg="*** --- Created " + Ogre::StringConverter::toString(mNumSources) + " sources for simultaneous sounds";
 		Ogre::LogManager::getSingleton().logMessage(msg, Ogre::LML_NORMAL);
 
 		mSoundsToDestroy = new LocklessQueue<OgreOggISound*>(100);
@@ -389,15 +534,21 @@ namespace OgreOggSound
 		{
 			mActionsList = new LocklessQueue<SoundAction>(queueListSize);
 		}
+		// Loopback streams are serviced by renderSamples() instead
+		if ( isLoopback() )
+			Ogre::LogManager::getSingleton().logMessage("*** --- Streaming whilst rendering loopback", Ogre::LML_NORMAL);
+		else
+		{
 #	ifdef POCO_THREAD
-		mUpdateThread = OGRE_NEW_T(Poco::Thread, Ogre::MEMCATEGORY_GENERAL)();
-		mUpdater = OGRE_NEW_T(Updater, Ogre::MEMCATEGORY_GENERAL)();
-		mUpdateThread->start(*mUpdater);
-		Ogre::LogManager::getSingleton().logMessage("*** --- Using POCO threads for streaming", Ogre::LML_NORMAL);
+			mUpdateThread = OGRE_NEW_T(Poco::Thread, Ogre::MEMCATEGORY_GENERAL)();
+			mUpdater = OGRE_NEW_T(Updater, Ogre::MEMCATEGORY_GENERAL)();
+			mUpdateThread->start(*mUpdater);
+			Ogre::LogManager::getSingleton().logMessage("*** --- Using POCO threads for streaming", Ogre::LML_NORMAL);
 #	else
-		mUpdateThread = OGRE_NEW_T(boost::thread, Ogre::MEMCATEGORY_GENERAL)(boost::function0<void>(&OgreOggSoundManager::threadUpdate, this));
-		Ogre::LogManager::getSingleton().logMessage("*** --- Using BOOST threads for streaming", Ogre::LML_NORMAL);
+			mUpdateThread = OGRE_NEW_T(boost::thread, Ogre::MEMCATEGORY_GENERAL)(boost::function0<void>(&OgreOggSoundManager::threadUpdate, this));
+			Ogre::LogManager::getSingleton().logMessage("*** --- Using BOOST threads for streaming", Ogre::LML_NORMAL);
 #	endif	
+		}
 #endif
 
 #if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
@@ -424,6 +575,109 @@ namespace OgreOggSound
 		return true;
 	}
 
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::renderSamples(void* buffer, size_t frames)
+	{
+		if ( !isLoopback() || !buffer ) return false;
+
+		OGGSOUND_PROFILE_SCOPE("OgreOggSoundManager::renderSamples");
+
+		char* out = static_cast<char*>(buffer);
+		const size_t frameSize = mLoopbackChannels * sizeof(short);
+		while ( frames )
+		{
+			const size_t count = std::min<size_t>(frames, LOOPBACK_BLOCK_FRAMES);
+
+			// Keep streams fed in rendered time
+			_serviceLoopback(static_cast<float>(count) / mLoopbackFrequency);
+
+			mALCRenderSamples(mDevice, out, static_cast<ALCsizei>(count));
+
+			out += count * frameSize;
+			frames -= count;
+		}
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::renderToWav(const Ogre::String& file, float seconds, float updateStep)
+	{
+		if ( !isLoopback() || seconds<=0.f ) return false;
+
+		std::ofstream out(file.c_str(), std::ios::out|std::ios::binary);
+		if ( !out.is_open() )
+		{
+			Ogre::LogManager::getSingleton().logMessage("*** OgreOggSoundManager::renderToWav() - Unable to open: "+file, Ogre::LML_CRITICAL);
+			return false;
+		}
+
+		const unsigned int blockAlign = mLoopbackChannels * sizeof(short);
+		const size_t totalFrames = static_cast<size_t>(seconds * mLoopbackFrequency);
+		const size_t stepFrames = std::max<size_t>(1, static_cast<size_t>(updateStep * mLoopbackFrequency));
+		const unsigned int dataSize = static_cast<unsigned int>(totalFrames * blockAlign);
+
+		// Canonical 44 byte PCM header, little endian
+		unsigned char header[44];
+		memcpy(header, "RIFF", 4);
+		_writeLE(header+4, 36+dataSize, 4);
+		memcpy(header+8, "WAVEfmt ", 8);
+		_writeLE(header+16, 16, 4);
+		_writeLE(header+20, 1, 2);
+		_writeLE(header+22, mLoopbackChannels, 2);
+		_writeLE(header+24, mLoopbackFrequency, 4);
+		_writeLE(header+28, mLoopbackFrequency * blockAlign, 4);
+		_writeLE(header+32, blockAlign, 2);
+		_writeLE(header+34, 16, 2);
+		memcpy(header+36, "data", 4);
+		_writeLE(header+40, dataSize, 4);
+		out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+		std::vector<short> buffer(stepFrames * mLoopbackChannels);
+		size_t rendered = 0;
+		while ( rendered<totalFrames && out.good() )
+		{
+			const size_t count = std::min(stepFrames, totalFrames - rendered);
+
+			// Advance the scene by the time about to be rendered
+			update(static_cast<float>(count) / mLoopbackFrequency);
+
+			renderSamples(&buffer[0], count);
+			out.write(reinterpret_cast<const char*>(&buffer[0]), count * blockAlign);
+			rendered += count;
+		}
+
+		return out.good();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_writeLE(unsigned char* dest, unsigned int value, int bytes)
+	{
+		for ( int i=0; i<bytes; ++i )
+			dest[i] = static_cast<unsigned char>((value >> (i*8)) & 0xFF);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_serviceLoopback(float fTime)
+	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mMutex);
+#	endif
+
+		// The work of the streaming thread, in rendered time
+		_processQueuedSounds();
+		_updateBuffers(fTime);
+		_processPreloadedSounds();
+#else
+		// Positions and fades are applied by update()
+		ActiveList::const_iterator i=mActiveSounds.begin(); 
+		ActiveList::const_iterator end(mActiveSounds.end()); 
+		while ( i!=end )
+		{
+			(*i)->_updateAudioBuffers();
+			++i;
+		}
+#endif
+	}
 	/*/////////////////////////////////////////////////////////////////*/
 	const StringVector OgreOggSoundManager::getDeviceList() const
 	{
@@ -558,7 +812,8 @@ namespace OgreOggSound
 			#endif
 
 			// Add to list
-			mSoundMap[name]=sound;
+			_addSoundSlot(sound);
+			mSoundMap[name]=sound->getHandle();
 
 			#if OGGSOUND_THREADED
 				mSoundMutex.unlock();
@@ -594,7 +849,8 @@ namespace OgreOggSound
 			#endif
 
 			// Add to list
-			mSoundMap[name]=sound;
+			_addSoundSlot(sound);
+			mSoundMap[name]=sound->getHandle();
 
 			#if OGGSOUND_THREADED
 				mSoundMutex.unlock();
@@ -603,13 +859,12 @@ namespace OgreOggSound
 #if OGGSOUND_THREADED
 
 			SoundAction action;
-			cSound* c		= OGRE_NEW_T(cSound, Ogre::MEMCATEGORY_GENERAL);
-			c->mFileName	= file;
-			c->mPrebuffer	= preBuffer;
+			sound->mLoadFile = file;
+			action.mSlot	= sound->mSlot;
+			action.mGeneration = sound->mSlotGeneration;
+			action.mParams.mLoad.mPrebuffer = preBuffer;
 			action.mAction	= LQ_LOAD;
-			action.mParams	= c;
 			action.mImmediately = immediate;
-			action.mSound	= sound->getName();
 			_requestSoundAction(action);
 #else
 			// load audio data
@@ -645,7 +900,8 @@ namespace OgreOggSound
 			#endif
 
 			// Add to list
-			mSoundMap[name]=sound;
+			_addSoundSlot(sound);
+			mSoundMap[name]=sound->getHandle();
 
 			#if OGGSOUND_THREADED
 				mSoundMutex.unlock();
@@ -653,13 +909,12 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 			SoundAction action;
-			cSound* c		= OGRE_NEW_T(cSound, Ogre::MEMCATEGORY_GENERAL);
-			c->mFileName	= file;
-			c->mPrebuffer	= preBuffer; 
+			sound->mLoadFile = file;
+			action.mSlot	= sound->mSlot;
+			action.mGeneration = sound->mSlotGeneration;
+			action.mParams.mLoad.mPrebuffer = preBuffer;
 			action.mAction	= LQ_LOAD;
-			action.mParams	= c;
 			action.mImmediately = immediate;
-			action.mSound	= sound->getName();
 			_requestSoundAction(action);
 #else
 			// Load audio file
@@ -749,14 +1004,12 @@ namespace OgreOggSound
 
 		SoundMap::iterator i = mSoundMap.find(name);
 		if(i == mSoundMap.end()) return 0;
-#if OGGSOUND_THREADED
-		if ( !i->second->_isDestroying() )
-			return i->second;
-		else
-			return 0;
-#else
-		return i->second;
-#endif
+		return getSoundByHandle(i->second);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggISound* OgreOggSoundManager::getSoundByHandle(SoundHandle handle)
+	{
+		return _getSoundFromSlot(static_cast<unsigned int>(handle & 0xFFFFFFFF), static_cast<unsigned int>(handle >> 32));
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	bool OgreOggSoundManager::hasSound(const std::string& name)
@@ -772,13 +1025,69 @@ namespace OgreOggSound
 		SoundMap::iterator i = mSoundMap.find(name);
 		if(i == mSoundMap.end())
 			return false;
+		return getSoundByHandle(i->second)!=0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::hasSoundByHandle(SoundHandle handle)
+	{
+		return getSoundByHandle(handle)!=0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::playSoundByHandle(SoundHandle handle, bool immediate)
+	{
+		_soundActionByHandle(handle, LQ_PLAY, immediate);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::pauseSoundByHandle(SoundHandle handle, bool immediate)
+	{
+		_soundActionByHandle(handle, LQ_PAUSE, immediate);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::stopSoundByHandle(SoundHandle handle, bool immediate)
+	{
+		_soundActionByHandle(handle, LQ_STOP, immediate);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_soundActionByHandle(SoundHandle handle, SOUND_ACTION action, bool immediate)
+	{
 #if OGGSOUND_THREADED
-		if ( !i->second->_isDestroying() )
-			return true;
-		else
-			return false;
+		// No lookup required, stale handles are rejected by the streaming thread
+		SoundAction act;
+		act.mSlot = static_cast<unsigned int>(handle & 0xFFFFFFFF);
+		act.mGeneration = static_cast<unsigned int>(handle >> 32);
+		act.mAction = action;
+		act.mImmediately = immediate;
+		_requestSoundAction(act);
 #else
-		return true;
+		OgreOggISound* sound=0;
+		if ( !(sound = getSoundByHandle(handle)) ) return;
+
+		switch ( action )
+		{
+		case LQ_PLAY:	sound->_playImpl(); break;
+		case LQ_PAUSE:	sound->_pauseImpl(); break;
+		case LQ_STOP:	sound->_stopImpl(); break;
+		default: break;
+		}
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::playVoice(SoundHandle handle, const Ogre::Vector3& pos, float gain, float pitch)
+	{
+#if OGGSOUND_THREADED
+		SoundAction action;
+		action.mSlot = static_cast<unsigned int>(handle & 0xFFFFFFFF);
+		action.mGeneration = static_cast<unsigned int>(handle >> 32);
+		action.mAction = LQ_PLAY_VOICE;
+		action.mImmediately = false;
+		action.mParams.mVoice.mPosition[0] = pos.x;
+		action.mParams.mVoice.mPosition[1] = pos.y;
+		action.mParams.mVoice.mPosition[2] = pos.z;
+		action.mParams.mVoice.mGain = gain;
+		action.mParams.mVoice.mPitch = pitch;
+		_requestSoundAction(action);
+#else
+		_playVoiceImpl(getSoundByHandle(handle), pos, gain, pitch);
 #endif
 	}
 	/*/////////////////////////////////////////////////////////////////*/
@@ -793,8 +1102,8 @@ namespace OgreOggSound
 		SoundAction action;
 		action.mAction	= LQ_STOP_ALL;
 		action.mImmediately = false;
-		action.mParams	= 0;
-		action.mSound	= "";
+		action.mSlot	= 0;
+		action.mGeneration = 0;
 		_requestSoundAction(action);
 #else
 		_stopAllSoundsImpl();
@@ -809,9 +1118,9 @@ namespace OgreOggSound
 #if OGGSOUND_THREADED 
 		SoundAction action;
 		action.mAction	= LQ_GLOBAL_PITCH;
-		action.mParams	= 0;
+		action.mSlot	= 0;
+		action.mGeneration = 0;
 		action.mImmediately = false;
-		action.mSound	= "";
 		_requestSoundAction(action);
 #else
 		_setGlobalPitchImpl();
@@ -823,8 +1132,8 @@ namespace OgreOggSound
 #if OGGSOUND_THREADED
 		SoundAction action;
 		action.mAction = LQ_PAUSE_ALL;
-		action.mSound = "";
-		action.mParams = 0;
+		action.mSlot = 0;
+		action.mGeneration = 0;
 		action.mImmediately = false;
 		_requestSoundAction(action);
 #else
@@ -844,8 +1153,8 @@ namespace OgreOggSound
 #if OGGSOUND_THREADED
 		SoundAction action;
 		action.mAction = LQ_RESUME_ALL;
-		action.mSound = "";
-		action.mParams = 0;
+		action.mSlot = 0;
+		action.mGeneration = 0;
 		action.mImmediately = false;
 		_requestSoundAction(action);
 #else
@@ -867,6 +1176,13 @@ namespace OgreOggSound
 		_destroySoundImpl(sound);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::destroySoundByHandle(SoundHandle handle)
+	{
+		OgreOggISound* sound=0;
+		if ( !(sound = getSoundByHandle(handle)) ) return;
+		_destroySoundImpl(sound);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::setDistanceModel(ALenum value)
 	{
 		alDistanceModel(value);
@@ -884,8 +1200,13 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::update(float fTime)
 	{
+		OGGSOUND_PROFILE_SCOPE("OgreOggSoundManager::update");
+
 #if OGGSOUND_THREADED == 0
 		static float rTime=0.f;
+
+		// Batch this ticks state changes
+		_deferStateUpdates();
 	
 		if ( !mActiveSounds.empty() )
 		{
@@ -895,6 +1216,7 @@ namespace OgreOggSound
 			while ( i!=end )
 			{
 				(*i)->update(fTime);
+				(*i)->_flushState();
 				(*i)->_updateAudioBuffers();
 				// Update recorder
 				if ( mRecorder ) mRecorder->_updateRecording();
@@ -902,9 +1224,27 @@ namespace OgreOggSound
 			}
 		}
 
+		// Top up decode-ahead rings
+		if ( mStreamDecoder ) mStreamDecoder->update();
+
+		// Reclaim finished voices
+		_updateVoices();
+
+		// Refresh source stealing order
+		_updateSourceHeap();
+
+		// Advance and realise virtual sounds
+		_updateVirtualSounds(fTime);
+
 		// Update listener
 		mListener->update();
 
+		// Apply batched state changes
+		_processStateUpdates();
+
+		// Publish per-second statistics
+		_updateStatistics(fTime);
+
 		// Limit re-activation
 		if ( (rTime+=fTime) > 0.05 )
 		{
@@ -984,63 +1324,154 @@ namespace OgreOggSound
 		return mResourceGroupName;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
-	struct OgreOggSoundManager::_sortNearToFar
+	void OgreOggSoundManager::_addActiveSound(OgreOggISound* sound)
 	{
-		_sortNearToFar(const Ogre::Vector3 & listenerPos) : mListenerPos(listenerPos) { }
+		if ( !sound || _isActiveSound(sound) ) return;
 
-		bool operator()(OgreOggISound*& sound1, OgreOggISound*& sound2)
-		{
-			if ( !sound1->isMono() ) return false;
+		sound->mActivePosition = mActiveSounds.insert(mActiveSounds.end(), sound);
 
-			// Check sort order
-			if ( !sound1->isMono() && sound2->isMono() ) return false;
+		_updateSourceHeapKey(sound, mListener ? mListener->getPosition() : Ogre::Vector3::ZERO);
+		sound->mSourceHeapIndex = mSourceHeap.size();
+		mSourceHeap.push_back(sound);
+		_sourceHeapSiftUp(sound->mSourceHeapIndex);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_removeActiveSound(OgreOggISound* sound)
+	{
+		if ( !sound || !_isActiveSound(sound) ) return;
 
-			const Ogre::Real d1 = OgreOggSoundManager::_calculateDistanceToListener(sound1, mListenerPos);
-			const Ogre::Real d2 = OgreOggSoundManager::_calculateDistanceToListener(sound2, mListenerPos);
+		mActiveSounds.erase(sound->mActivePosition);
 
-			if ( d1<d2 )	return true;
-			if ( d1>d2 )	return false;
+		// Fill the hole with the last entry
+		size_t index = sound->mSourceHeapIndex;
+		OgreOggISound* last = mSourceHeap.back();
+		mSourceHeap.pop_back();
+		sound->mSourceHeapIndex = static_cast<size_t>(-1);
 
-			// Equal - don't sort
-			return false;
+		if ( index<mSourceHeap.size() )
+		{
+			mSourceHeap[index] = last;
+			last->mSourceHeapIndex = index;
+			_sourceHeapSiftUp(index);
+			_sourceHeapSiftDown(last->mSourceHeapIndex);
 		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_isActiveSound(OgreOggISound* sound) const
+	{
+		// Index is left stale when the lists are cleared, so check the entry too
+		return sound->mSourceHeapIndex<mSourceHeap.size() && mSourceHeap[sound->mSourceHeapIndex]==sound;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_updateSourceHeapKey(OgreOggISound* sound, const Ogre::Vector3& listenerPos)
+	{
+		sound->mSourceKeyDirty = false;
+		sound->mSourceKeyStopped = sound->isStopped();
+		sound->mSourceKeyPriority = sound->getPriority();
+		// Only mono sounds are positional
+		sound->mSourceKeyDistance = sound->isMono() ? _calculateDistanceToListener(sound, listenerPos) : 0.f;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_isBetterSourceVictim(const OgreOggISound* a, const OgreOggISound* b)
+	{
+		// Stopped, then lowest priority, then furthest away
+		if ( a->mSourceKeyStopped!=b->mSourceKeyStopped ) return a->mSourceKeyStopped;
+		if ( a->mSourceKeyPriority!=b->mSourceKeyPriority ) return a->mSourceKeyPriority<b->mSourceKeyPriority;
+		return a->mSourceKeyDistance>b->mSourceKeyDistance;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_sourceHeapSiftUp(size_t index)
+	{
+		OgreOggISound* sound = mSourceHeap[index];
+		while ( index>0 )
+		{
+			size_t parent = (index-1)/2;
+			if ( !_isBetterSourceVictim(sound, mSourceHeap[parent]) ) break;
 
-		private:
-
-			Ogre::Vector3 mListenerPos;
-	};
+			mSourceHeap[index] = mSourceHeap[parent];
+			mSourceHeap[index]->mSourceHeapIndex = index;
+			index = parent;
+		}
+		mSourceHeap[index] = sound;
+		sound->mSourceHeapIndex = index;
+	}
 	/*/////////////////////////////////////////////////////////////////*/
-	struct OgreOggSoundManager::_sortFarToNear
+	void OgreOggSoundManager::_sourceHeapSiftDown(size_t index)
 	{
-		_sortFarToNear(const Ogre::Vector3 & listenerPos) : mListenerPos(listenerPos) { }
+		const size_t count = mSourceHeap.size();
+		OgreOggISound* sound = mSourceHeap[index];
+		while ( true )
+		{
+			size_t child = index*2+1;
+			if ( child>=count ) break;
+			if ( child+1<count && _isBetterSourceVictim(mSourceHeap[child+1], mSourceHeap[child]) ) ++child;
+			if ( !_isBetterSourceVictim(mSourceHeap[child], sound) ) break;
+
+			mSourceHeap[index] = mSourceHeap[child];
+			mSourceHeap[index]->mSourceHeapIndex = index;
+			index = child;
+		}
+		mSourceHeap[index] = sound;
+		sound->mSourceHeapIndex = index;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_updateSourceHeap()
+	{
+		if ( mSourceHeap.empty() ) return;
+
+		OGGSOUND_PROFILE_SCOPE("OgreOggSoundManager::_updateSourceHeap");
 
-		bool operator()(OgreOggISound*& sound1, OgreOggISound*& sound2)
+		const Ogre::Vector3 listenerPos(mListener ? mListener->getPosition() : Ogre::Vector3::ZERO);
+
+		// Listener moved - every distance changes so rebuild bottom up
+		if ( listenerPos!=mSourceHeapListenerPos )
 		{
-			if ( !sound1->isMono() ) return false;
+			mSourceHeapListenerPos = listenerPos;
 
-			// Check sort order
-			if ( !sound1->isMono() && sound2->isMono() ) return true;
+			for ( size_t i=0; i<mSourceHeap.size(); ++i )
+				_updateSourceHeapKey(mSourceHeap[i], listenerPos);
 
-			const Ogre::Real d1 = OgreOggSoundManager::_calculateDistanceToListener(sound1, mListenerPos);
-			const Ogre::Real d2 = OgreOggSoundManager::_calculateDistanceToListener(sound2, mListenerPos);
+			for ( size_t i=mSourceHeap.size()/2; i-->0; )
+				_sourceHeapSiftDown(i);
+			return;
+		}
 
-			if ( d1>d2 )	return true;
-			if ( d1<d2 )	return false;
+		// Collect first, sifting moves entries around
+		mSourceHeapDirty.clear();
+		for ( size_t i=0; i<mSourceHeap.size(); ++i )
+		{
+			OgreOggISound* sound = mSourceHeap[i];
+			if ( sound->mSourceKeyDirty || sound->isStopped()!=sound->mSourceKeyStopped )
+				mSourceHeapDirty.push_back(sound);
+		}
 
-			// Equal - don't sort
-			return false;
+		// Re-key and restore order one entry at a time
+		for ( size_t i=0; i<mSourceHeapDirty.size(); ++i )
+		{
+			OgreOggISound* sound = mSourceHeapDirty[i];
+			_updateSourceHeapKey(sound, listenerPos);
+			_sourceHeapSiftUp(sound->mSourceHeapIndex);
+			_sourceHeapSiftDown(sound->mSourceHeapIndex);
 		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggISound* OgreOggSoundManager::_getSourceHeapTop()
+	{
+		if ( mSourceHeap.empty() ) return 0;
 
-		private:
+		// Pick up anything changed since the last update
+		_updateSourceHeap();
 
-			Ogre::Vector3 mListenerPos;
-	};
+		return mSourceHeap.front();
+	}
 	/*/////////////////////////////////////////////////////////////////*/
 	bool OgreOggSoundManager::_requestSoundSource(OgreOggISound* sound)
 	{
 		// Does sound need a source?
 		if (!sound) return false;
 
+		OGGSOUND_PROFILE_SCOPE("OgreOggSoundManager::_requestSoundSource");
+
 		if (sound->getSource()!=AL_NONE) return true;
 		
 		ALuint src = AL_NONE;
@@ -1068,131 +1499,90 @@ namespace OgreOggSound
 				}
 			}
 			// Add new sound to active list
-			mActiveSounds.push_back(sound);
+			_addActiveSound(sound);
 			return true;
 		}
 		// All sources in use
 		// Re-use an active source
-		// Use either a non-playing source or a lower priority source
-		else
+		// Use either a non-playing source, a lower priority source or a further away source
+		else if ( OgreOggISound* victim = _getSourceHeapTop() )
 		{
-			// Get iterator for list
-			ActiveList::iterator iter = mActiveSounds.begin();
+			ALuint src = victim->getSource();
+			ALuint nullSrc = AL_NONE;
 
-			// Search for a stopped sound
-			while ( iter!=mActiveSounds.end() )
+			// Stopped sound - reuse its source
+			if ( victim->isStopped() )
 			{
-				// Find a stopped sound - reuse its source
-				if ( (*iter)->isStopped() )
-				{
-					ALuint src = (*iter)->getSource();
-					ALuint nullSrc = AL_NONE;
-					// Remove source
-					(*iter)->setSource(nullSrc);
-					// Attach source to new sound
-					sound->setSource(src);
-					// Add new sound to active list
-					mActiveSounds.erase(iter);
-					// Add new sound to active list
-					mActiveSounds.push_back(sound);
-					// Return success
-					return true;
-				}
-				else
-					++iter;
+				// Remove source
+				victim->setSource(nullSrc);
+				_removeActiveSound(victim);
+				// Attach source to new sound
+				sound->setSource(src);
+				_addActiveSound(sound);
+				// Return success
+				return true;
 			}
 
-			// Check priority...
-			Ogre::uint8 priority = sound->getPriority();
-			iter = mActiveSounds.begin();
+			// Lower priority sound
+			bool byPriority = victim->getPriority()<sound->getPriority();
+			bool byDistance = false;
 
-			// Search for a lower priority sound
-			while ( iter!=mActiveSounds.end() )
+			// Same priority sound further away
+			if ( !byPriority && mListener && victim->isMono() && victim->getPriority()==sound->getPriority() )
 			{
-				// Find a stopped sound - reuse its source
-				if ( (*iter)->getPriority()<sound->getPriority() )
-				{
-					ALuint src = (*iter)->getSource();
-					ALuint nullSrc = AL_NONE;
-
-					if ((*iter)->getState() != SS_DESTROYED)
-					{
-						// Pause sounds
-						(*iter)->pause();
-					}
-
-					// Remove source
-					(*iter)->setSource(nullSrc);
-					// Attach source to new sound
-					sound->setSource(src);
-
-					// Add to reactivate list
-					if ((*iter)->getState() != SS_DESTROYED)
-					{
-						mSoundsToReactivate.push_back((*iter));
-					}
-
-					// Remove relinquished sound from active list
-					mActiveSounds.erase(iter);
-					// Add new sound to active list
-					mActiveSounds.push_back(sound);
-					// Return success
-					return true;
-				}
-				else
-					++iter;
+				const Ogre::Vector3 listenerPos(mListener->getPosition());
+				byDistance = _calculateDistanceToListener(victim, listenerPos) > _calculateDistanceToListener(sound, listenerPos);
 			}
 
-			if (mListener)
+			if ( byPriority || byDistance )
 			{
-				const Ogre::Vector3 listenerPos(mListener->getPosition());
-
-				// Sort list by distance
-				mActiveSounds.sort(_sortFarToNear(listenerPos));
-
-				// Lists should be sorted:	Active-->furthest to Nearest
-				//							Reactivate-->Nearest to furthest
-				OgreOggISound* snd1 = mActiveSounds.front();
+				++mSourcesStolen;
 
-				// Sort by distance
-				const Ogre::Real d1 = _calculateDistanceToListener(snd1, listenerPos);
-				const Ogre::Real d2 = _calculateDistanceToListener(sound, listenerPos);
-
-				// Needs swapping?
-				if ( d1>d2 )
+				// Keep victim playing without a source
+				if ( mVirtualVoices && victim->getState()==SS_PLAYING && _canVirtualise(victim) )
 				{
-					ALuint src = snd1->getSource();
-					ALuint nullSrc = AL_NONE;
+					float playPos = victim->getPlayPosition();
 
-					if (snd1->getState() != SS_DESTROYED)
-					{
-						// Pause sounds
-						snd1->pause();
-						snd1->_markPlayPosition();
-					}
+					victim->setSource(nullSrc);
+					_removeActiveSound(victim);
+					_virtualiseSound(victim, playPos>0.f ? playPos : 0.f);
 
-					// Remove source
-					snd1->setSource(nullSrc);
-					// Attach source to new sound
 					sound->setSource(src);
-					sound->_recoverPlayPosition();
+					_addActiveSound(sound);
+					return true;
+				}
 
-					// Add to reactivate list
-					if (snd1->getState() != SS_DESTROYED)
-					{
-						mSoundsToReactivate.push_back(snd1);
-					}
+				if (victim->getState() != SS_DESTROYED)
+				{
+					// Pause sounds
+					victim->pause();
+					if ( byDistance ) victim->_markPlayPosition();
+				}
 
-					// Remove relinquished sound from active list
-					mActiveSounds.erase(mActiveSounds.begin());					 
-					// Add new sound to active list
-					mActiveSounds.push_back(sound);
-					// Return success
-					return true;
+				// Remove source
+				victim->setSource(nullSrc);
+				// Attach source to new sound
+				sound->setSource(src);
+				if ( byDistance ) sound->_recoverPlayPosition();
+
+				// Add to reactivate list
+				if (victim->getState() != SS_DESTROYED)
+				{
+					mSoundsToReactivate.push_back(victim);
 				}
+
+				// Remove relinquished sound from active list
+				_removeActiveSound(victim);
+				// Add new sound to active list
+				_addActiveSound(sound);
+				// Return success
+				return true;
 			}
 		}
 
+		// Virtual sounds don't wait for a source
+		if ( mVirtualVoices && _canVirtualise(sound) ) return false;
+
 		// If no opportunity to grab a source add to queue
 		if ( !mWaitingSounds.empty() )
 		{
@@ -1230,15 +1620,7 @@ namespace OgreOggSound
 			mSourcePool.push_back(src);
 
 			// Remove from actives list
-			ActiveList::iterator iter=mActiveSounds.begin(); 
-			while ( iter!=mActiveSounds.end() )
-			{
-				// Find sound in actives list
-				if ( (*iter)==sound )
-					iter = mActiveSounds.erase(iter);
-				else
-					++iter;
-			}
+			_removeActiveSound(sound);
 			return true;
 		}
 
@@ -1384,13 +1766,13 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 		SoundAction action;
-		efxProperty* e	= OGRE_NEW_T(efxProperty, Ogre::MEMCATEGORY_GENERAL);
-		e->mEffectName	= effectName;
-		e->mFilterName	= filterName;
-		e->mSlotID		= slotID;
+		efxProperty& e	= action.mParams.mEfx;
+		e.mEffect		= _getEFXEffect(effectName);
+		e.mFilter		= _getEFXFilter(filterName);
+		e.mSlotID		= slotID;
 		action.mAction	= LQ_ATTACH_EFX;
-		action.mParams	= e;
-		action.mSound	= sound->getName();
+		action.mSlot	= sound->mSlot;
+		action.mGeneration = sound->mSlotGeneration;
 		action.mImmediately = false;
 		_requestSoundAction(action);
 		return true;
@@ -1408,13 +1790,13 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 		SoundAction action;
-		efxProperty* e	= OGRE_NEW_T(efxProperty, Ogre::MEMCATEGORY_GENERAL);
-		e->mEffectName	= "";
-		e->mFilterName	= filterName;
-		e->mSlotID		= 255;
+		efxProperty& e	= action.mParams.mEfx;
+		e.mEffect		= AL_EFFECT_NULL;
+		e.mFilter		= _getEFXFilter(filterName);
+		e.mSlotID		= 255;
 		action.mAction	= LQ_ATTACH_EFX;
-		action.mParams	= e;
-		action.mSound	= sound->getName();
+		action.mSlot	= sound->mSlot;
+		action.mGeneration = sound->mSlotGeneration;
 		action.mImmediately = false;
 		_requestSoundAction(action);
 		return true;
@@ -1429,18 +1811,21 @@ namespace OgreOggSound
 	{
 		if ( !hasEFXSupport() || !sound ) return false;
 
-		ALuint effect;
-		ALuint filter;
-		ALuint slot;
-
 		// Get effect id's
-		slot	= _getEFXSlot(slotID);
-		effect	= _getEFXEffect(effectName);
-		filter	= _getEFXFilter(filterName);
+		return _attachEffectToSoundImpl(sound, slotID, _getEFXEffect(effectName), _getEFXFilter(filterName));
+	}
 
-		// Attach effect and filter to slot
-		if ( _attachEffectToSlot(slot, effect) )
-		{
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_attachEffectToSoundImpl(OgreOggISound* sound, ALuint slotID, ALuint effect, ALuint filter)
+	{
+		if ( !hasEFXSupport() || !sound ) return false;
+
+		// Get slot
+		ALuint slot = _getEFXSlot(slotID);
+
+		// Attach effect and filter to slot
+		if ( _attachEffectToSlot(slot, effect) )
+		{
 			ALuint src = sound->getSource();
 			if ( src!=AL_NONE )
 			{
@@ -1469,7 +1854,13 @@ namespace OgreOggSound
 	{
 		if ( !hasEFXSupport() || !sound ) return false;
 
-		ALuint filter = _getEFXFilter(filterName);
+		return _attachFilterToSoundImpl(sound, _getEFXFilter(filterName));
+	}
+
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_attachFilterToSoundImpl(OgreOggISound* sound, ALuint filter)
+	{
+		if ( !hasEFXSupport() || !sound ) return false;
 
 		if ( filter!=AL_FILTER_NULL )
 		{
@@ -1564,16 +1955,16 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 		SoundAction action;
-		efxProperty* e	= OGRE_NEW_T(efxProperty, Ogre::MEMCATEGORY_GENERAL);
-		e->mEffectName	= "";
-		e->mFilterName	= "";
-		e->mSlotID		= slotID;
-		e->mAirAbsorption= 0.f;
-		e->mRolloff		= 0.f;
-		e->mConeHF		= 0.f;
+		efxProperty& e	= action.mParams.mEfx;
+		e.mEffect		= AL_EFFECT_NULL;
+		e.mFilter		= AL_FILTER_NULL;
+		e.mSlotID		= slotID;
+		e.mAirAbsorption= 0.f;
+		e.mRolloff		= 0.f;
+		e.mConeHF		= 0.f;
 		action.mAction	= LQ_DETACH_EFX;
-		action.mParams	= e;
-		action.mSound	= sound->getName();
+		action.mSlot	= sound->mSlot;
+		action.mGeneration = sound->mSlotGeneration;
 		action.mImmediately = false;
 		_requestSoundAction(action);
 		return true;
@@ -1591,16 +1982,16 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 		SoundAction action;
-		efxProperty* e	= OGRE_NEW_T(efxProperty, Ogre::MEMCATEGORY_GENERAL);
-		e->mEffectName	= "";
-		e->mFilterName	= "";
-		e->mSlotID		= 255;
-		e->mAirAbsorption= 0.f;
-		e->mRolloff		= 0.f;
-		e->mConeHF		= 0.f;
+		efxProperty& e	= action.mParams.mEfx;
+		e.mEffect		= AL_EFFECT_NULL;
+		e.mFilter		= AL_FILTER_NULL;
+		e.mSlotID		= 255;
+		e.mAirAbsorption= 0.f;
+		e.mRolloff		= 0.f;
+		e.mConeHF		= 0.f;
 		action.mAction	= LQ_DETACH_EFX;
-		action.mParams	= e;
-		action.mSound	= sound->getName();
+		action.mSlot	= sound->mSlot;
+		action.mGeneration = sound->mSlotGeneration;
 		action.mImmediately = false;
 		_requestSoundAction(action);
 		return true;
@@ -1773,16 +2164,16 @@ namespace OgreOggSound
 
 #if OGGSOUND_THREADED
 		SoundAction action;
-		efxProperty* e	= OGRE_NEW_T(efxProperty, Ogre::MEMCATEGORY_GENERAL);
-		e->mEffectName	= "";
-		e->mFilterName	= "";
-		e->mSlotID		= 255;
-		e->mAirAbsorption= airAbsorption;
-		e->mRolloff		= roomRolloff;
-		e->mConeHF		= coneOuterHF;
+		efxProperty& e	= action.mParams.mEfx;
+		e.mEffect		= AL_EFFECT_NULL;
+		e.mFilter		= AL_FILTER_NULL;
+		e.mSlotID		= 255;
+		e.mAirAbsorption= airAbsorption;
+		e.mRolloff		= roomRolloff;
+		e.mConeHF		= coneOuterHF;
 		action.mAction	= LQ_SET_EFX_PROPERTY;
-		action.mParams	= e;
-		action.mSound	= sound->getName();
+		action.mSlot	= sound->mSlot;
+		action.mGeneration = sound->mSlotGeneration;
 		action.mImmediately = false;
 		_requestSoundAction(action);
 		return true;
@@ -2158,7 +2549,7 @@ namespace OgreOggSound
 #	endif
 #endif
 		// Destroy all sounds
-		StringVector soundList;
+		std::vector<SoundHandle> soundList;
 
 		#if OGGSOUND_THREADED
 		#	ifdef POCO_THREAD
@@ -2168,33 +2559,42 @@ namespace OgreOggSound
 		#	endif
 		#endif
 
-		// Get a list of all sound names
-		for ( SoundMap::iterator i=mSoundMap.begin(); i!=mSoundMap.end(); ++i )
-			soundList.push_back(i->first);
+		// Get a list of all sound handles
+		for ( SoundSlotList::iterator i=mSoundSlots.begin(); i!=mSoundSlots.end(); ++i )
+			if ( i->mSound ) soundList.push_back(i->mSound->getHandle());
 
-		// Destroy individually outside mSoundMap iteration
-		for ( StringVector::iterator i=soundList.begin(); i!=soundList.end(); ++i )
+		// Destroy individually outside mSoundSlots iteration
+		for ( std::vector<SoundHandle>::iterator i=soundList.begin(); i!=soundList.end(); ++i )
 		{
 			OgreOggISound* sound=0;
-			if ( sound=getSound((*i)) ) 
+			if ( sound=getSoundByHandle((*i)) ) 
 				_destroySoundImpl(sound);
 		}
 		soundList.clear();
 
+		// Voices
+		for (VoiceList::iterator v=mVoices.begin(); v!=mVoices.end(); ++v)
+			_releaseVoice(*v);
+		mVoices.clear();
+
 		// Shared buffers
 		SharedBufferList::iterator b = mSharedBuffers.begin();
 		while (b != mSharedBuffers.end())
 		{
-			if ( b->second->mRefCount>0 )
-				alDeleteBuffers(1, &b->second->mAudioBuffer);
-			OGRE_FREE(b->second, Ogre::MEMCATEGORY_GENERAL);
+			alDeleteBuffers(1, &b->second->mAudioBuffer);
+			OGRE_DELETE_T(b->second, sharedAudioBuffer, Ogre::MEMCATEGORY_GENERAL);
 			++b;
 		}
 
 		mSharedBuffers.clear();
+		mSharedBufferCache.clear();
+		mSharedBufferCacheSize = 0;
+		mPreloadedSounds.clear();
 
 		// Clear queues
 		mActiveSounds.clear();
+		mSourceHeap.clear();
+		mVirtualSounds.clear();
 		mPausedSounds.clear();
 		mSoundsToReactivate.clear();
 		mWaitingSounds.clear();
@@ -2202,6 +2602,15 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::_stopAllSoundsImpl()
 	{
+		// Voices are reclaimed on the next update
+		for (VoiceList::iterator v=mVoices.begin(); v!=mVoices.end(); ++v)
+			alSourceStop(v->mSource);
+
+		// Stopping removes sounds from the virtual list
+		ActiveList virtualSounds(mVirtualSounds);
+		for (ActiveList::const_iterator iter=virtualSounds.begin(); iter!=virtualSounds.end(); ++iter)
+			(*iter)->_stopImpl();
+
 		if (mActiveSounds.empty()) return;
 
 		for (ActiveList::const_iterator iter=mActiveSounds.begin(); iter!=mActiveSounds.end(); ++iter)
@@ -2214,6 +2623,280 @@ namespace OgreOggSound
 		}
 	}
 	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_playVoiceImpl(OgreOggISound* sound, const Ogre::Vector3& pos, float gain, float pitch)
+	{
+		if ( !sound || sound->mStream ) return;
+
+		// Only sounds with a shared buffer can be instanced
+		SharedBufferList::iterator b = mSharedBuffers.find(sound->getFileName());
+		if ( b==mSharedBuffers.end() ) return;
+
+		// Voices never steal a source
+		if ( mSourcePool.empty() ) return;
+
+		SoundVoice voice;
+		voice.mSource = mSourcePool.back();
+		voice.mBuffer = b;
+		voice.mPitch = pitch;
+		mSourcePool.pop_back();
+
+		ALuint src = voice.mSource;
+		alSourcei (src, AL_BUFFER, b->second->mAudioBuffer);
+		alSourcef (src, AL_GAIN, gain);
+		alSourcef (src, AL_MAX_GAIN, sound->mMaxGain);
+		alSourcef (src, AL_MIN_GAIN, sound->mMinGain);
+		alSourcef (src, AL_MAX_DISTANCE, sound->mMaxDistance);	
+		alSourcef (src, AL_ROLLOFF_FACTOR, sound->mRolloffFactor);
+		alSourcef (src, AL_REFERENCE_DISTANCE, sound->mReferenceDistance);
+		alSourcef (src, AL_CONE_OUTER_GAIN, sound->mOuterConeGain);
+		alSourcef (src, AL_CONE_INNER_ANGLE, sound->mInnerConeAngle);
+		alSourcef (src, AL_CONE_OUTER_ANGLE, sound->mOuterConeAngle);
+		alSource3f(src, AL_POSITION, pos.x, pos.y, pos.z);
+		alSource3f(src, AL_DIRECTION, 0.f, 0.f, 0.f);
+		alSource3f(src, AL_VELOCITY, 0.f, 0.f, 0.f);
+		alSourcef (src, AL_PITCH, pitch * mGlobalPitch);
+		alSourcei (src, AL_SOURCE_RELATIVE, AL_FALSE);
+		alSourcei (src, AL_LOOPING, AL_FALSE);
+		alSourcePlay(src);
+
+		// Keep buffer alive should the sound be destroyed
+		_addSharedBufferRef(b->second);
+
+		mVoices.push_back(voice);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_updateVoices()
+	{
+		size_t i=0;
+		while ( i<mVoices.size() )
+		{
+			ALint state;
+			alGetSourcei(mVoices[i].mSource, AL_SOURCE_STATE, &state);
+
+			if ( state!=AL_STOPPED )
+			{
+				++i;
+				continue;
+			}
+
+			_releaseVoice(mVoices[i]);
+
+			// Order doesn't matter
+			mVoices[i] = mVoices.back();
+			mVoices.pop_back();
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_releaseVoice(SoundVoice& voice)
+	{
+		alSourceStop(voice.mSource);
+		alSourcei(voice.mSource, AL_BUFFER, 0);
+		mSourcePool.push_back(voice.mSource);
+		voice.mSource = AL_NONE;
+
+		// Buffer may be deleted so copy name and id
+		Ogre::String name = voice.mBuffer->first;
+		ALuint buffer = voice.mBuffer->second->mAudioBuffer;
+		_releaseSharedBuffer(name, buffer);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_canVirtualise(const OgreOggISound* sound)
+	{
+		// Position must be trackable and restorable
+		return sound->mSeekable && sound->mPlayTime>0.f && sound->mState!=SS_DESTROYED;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_virtualiseSound(OgreOggISound* sound, float playPos)
+	{
+		if ( !sound || !mVirtualVoices || !_canVirtualise(sound) ) return false;
+		if ( sound->mVirtual ) return true;
+
+		sound->mVirtual = true;
+		sound->mVirtualPlayPos = playPos;
+		sound->mState = SS_PLAYING;
+		mVirtualSounds.push_back(sound);
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_removeVirtualSound(OgreOggISound* sound)
+	{
+		if ( !sound || !sound->mVirtual ) return;
+
+		sound->mVirtual = false;
+		mVirtualSounds.remove(sound);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_deferStateUpdates()
+	{
+		if ( mALDeferUpdates ) mALDeferUpdates();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_processStateUpdates()
+	{
+		if ( mALProcessUpdates ) mALProcessUpdates();
+
+		mALCallsPerFrame = mALCalls;
+		mALCalls = 0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_notifyStreamRefill(size_t bytes, unsigned long startTime)
+	{
+		unsigned long elapsed = mStatisticsTimer.getMicroseconds() - startTime;
+
+		++mStreamRefills;
+		mWindowDecodeBytes += static_cast<unsigned long>(bytes);
+		++mWindowRefills;
+		mWindowRefillTime += elapsed;
+		if ( elapsed>mWindowMaxRefillTime ) mWindowMaxRefillTime = elapsed;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_updateStatistics(float fTime)
+	{
+		if ( (mStatisticsWindow+=fTime)<1.f ) return;
+
+		mDecodeBytesPerSecond = mWindowDecodeBytes / mStatisticsWindow;
+		mRefillLatency = mWindowRefills ? (mWindowRefillTime / static_cast<float>(mWindowRefills)) * 0.001f : 0.f;
+		mMaxRefillLatency = mWindowMaxRefillTime * 0.001f;
+
+		mStatisticsWindow = 0.f;
+		mWindowDecodeBytes = 0;
+		mWindowRefills = 0;
+		mWindowRefillTime = 0;
+		mWindowMaxRefillTime = 0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	SoundStatistics OgreOggSoundManager::getStatistics()
+	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::recursive_mutex::scoped_lock lock(mMutex);
+#	endif
+#endif
+
+		SoundStatistics stats;
+		stats.mActiveSounds = static_cast<unsigned int>(mActiveSounds.size());
+		stats.mWaitingSounds = static_cast<unsigned int>(mWaitingSounds.size());
+		stats.mReactivatingSounds = static_cast<unsigned int>(mSoundsToReactivate.size());
+		stats.mVirtualSounds = static_cast<unsigned int>(mVirtualSounds.size());
+		stats.mVoices = static_cast<unsigned int>(mVoices.size());
+		stats.mSourcesFree = static_cast<unsigned int>(mSourcePool.size());
+		stats.mSourcesTotal = mNumSources;
+		stats.mSourcesStolen = mSourcesStolen;
+		stats.mStreamUnderruns = mStreamUnderruns;
+		stats.mStreamRefills = mStreamRefills;
+		stats.mDecodeBytesPerSecond = mDecodeBytesPerSecond;
+		stats.mRefillLatency = mRefillLatency;
+		stats.mMaxRefillLatency = mMaxRefillLatency;
+		stats.mActionQueueHighWater = static_cast<unsigned int>(mActionQueueHighWater.load());
+		stats.mActionsDropped = mActionsDropped.load();
+		stats.mDecodeCacheHits = mDecodeCache ? mDecodeCache->getHits() : 0;
+		stats.mDecodeCacheMisses = mDecodeCache ? mDecodeCache->getMisses() : 0;
+
+		// Queue depth of playing streams
+		stats.mQueuedBuffers = 0;
+		stats.mMinQueueDepth = 0;
+		bool first = true;
+		for ( ActiveList::const_iterator i=mActiveSounds.begin(); i!=mActiveSounds.end(); ++i )
+		{
+			if ( !(*i)->mStream || !(*i)->isPlaying() || (*i)->getSource()==AL_NONE ) continue;
+
+			ALint queued=0;
+			alGetSourcei((*i)->getSource(), AL_BUFFERS_QUEUED, &queued);
+			stats.mQueuedBuffers += queued;
+			if ( first || static_cast<unsigned int>(queued)<stats.mMinQueueDepth ) stats.mMinQueueDepth = queued;
+			first = false;
+		}
+
+		return stats;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_updateVirtualSounds(float fTime)
+	{
+		if ( mVirtualSounds.empty() ) return;
+
+		const Ogre::Vector3 listenerPos(mListener ? mListener->getPosition() : Ogre::Vector3::ZERO);
+
+		ActiveList::iterator best = mVirtualSounds.end();
+		Ogre::Real bestDistance = 0.f;
+
+		ActiveList::iterator i = mVirtualSounds.begin();
+		while ( i!=mVirtualSounds.end() )
+		{
+			OgreOggISound* sound = (*i);
+
+			// update pos/fade
+			sound->update(fTime);
+
+			// Advance play position
+			sound->mVirtualPlayPos += fTime * sound->mPitch;
+			if ( sound->mVirtualPlayPos>=sound->mPlayTime )
+			{
+				if ( sound->mLoop )
+					sound->mVirtualPlayPos = std::fmod(sound->mVirtualPlayPos, sound->mPlayTime);
+				else
+				{
+					// Finished whilst virtual
+					i = mVirtualSounds.erase(i);
+					sound->mVirtual = false;
+					sound->mState = SS_STOPPED;
+
+					if ( sound->mSoundListener )
+					{
+						sound->mSoundListener->soundStopped(sound);
+						sound->mSoundListener->soundFinished(sound);
+					}
+
+					if ( sound->mTemporary )
+					{
+						sound->mState = SS_DESTROYED;
+						_destroyTemporarySound(sound);
+					}
+					continue;
+				}
+			}
+
+			// Find most audible
+			Ogre::Real distance = sound->isMono() ? _calculateDistanceToListener(sound, listenerPos) : 0.f;
+			if ( best==mVirtualSounds.end() || 
+				sound->getPriority()>(*best)->getPriority() || 
+				( sound->getPriority()==(*best)->getPriority() && distance<bestDistance ) )
+			{
+				best = i;
+				bestDistance = distance;
+			}
+
+			++i;
+		}
+
+		if ( best==mVirtualSounds.end() ) return;
+
+		OgreOggISound* sound = (*best);
+
+		// Would it get a source?
+		bool realise = !mSourcePool.empty();
+		if ( !realise )
+		{
+			if ( OgreOggISound* victim = _getSourceHeapTop() )
+			{
+				// Some leeway on distance to stop sounds swapping back and forth
+				realise = victim->isStopped() || 
+					victim->getPriority()<sound->getPriority() ||
+					( victim->getPriority()==sound->getPriority() && victim->isMono() && victim->mSourceKeyDistance>bestDistance*1.1f );
+			}
+		}
+
+		if ( !realise ) return;
+
+		// Play for real from the virtual position
+		mVirtualSounds.erase(best);
+		sound->mVirtual = false;
+		sound->mState = SS_PAUSED;
+		sound->setPlayPosition(sound->mVirtualPlayPos);
+		sound->_playImpl();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::_setGlobalPitchImpl()
 	{
 		#if OGGSOUND_THREADED
@@ -2224,15 +2907,27 @@ namespace OgreOggSound
 		#	endif
 		#endif
 
+		// Voices may outlive their sounds
+		for (VoiceList::const_iterator iter=mVoices.begin(); iter!=mVoices.end(); ++iter)
+			alSourcef(iter->mSource, AL_PITCH, iter->mPitch * mGlobalPitch);
+
 		if (mSoundMap.empty() ) return;
 
 		// Affect all sounds
-		for (SoundMap::const_iterator iter=mSoundMap.begin(); iter!=mSoundMap.end(); ++iter)
-			iter->second->setPitch(mGlobalPitch);
+		for (SoundSlotList::const_iterator iter=mSoundSlots.begin(); iter!=mSoundSlots.end(); ++iter)
+			if ( iter->mSound ) iter->mSound->setPitch(mGlobalPitch);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::_pauseAllSoundsImpl()
 	{
+		// Pausing removes sounds from the virtual list
+		ActiveList virtualSounds(mVirtualSounds);
+		for (ActiveList::const_iterator iter=virtualSounds.begin(); iter!=virtualSounds.end(); ++iter)
+		{
+			(*iter)->_pauseImpl();
+			mPausedSounds.push_back((*iter));
+		}
+
 		if (mActiveSounds.empty()) return;
 
 		for (ActiveList::const_iterator iter=mActiveSounds.begin(); iter!=mActiveSounds.end(); ++iter)
@@ -2273,12 +2968,29 @@ namespace OgreOggSound
 		sharedAudioBuffer* buffer=0;
 
 		if ( !sound->mStream )
+		{
 			// Is there a shared buffer?
 			buffer = _getSharedBuffer(file);
+			if ( buffer )
+				++mSharedBufferHits;
+			else
+				++mSharedBufferMisses;
+		}
 
 		if (!buffer)
 		{
-		    Ogre::DataStreamPtr stream = _openStream(file);
+			Ogre::DataStreamPtr stream;
+
+			// Read from the in memory copy if there is one
+			Ogre::MemoryDataStreamPtr data = _getCompressedSound(file);
+			if ( !data.isNull() )
+			{
+				sound->mCompressedData = data;
+				stream.bind(OGRE_NEW Ogre::MemoryDataStream(file, data->getPtr(), data->size(), false, true));
+			}
+			else
+				stream = _openStream(file);
+
 			// Load audio file
 			sound->_openImpl(stream);
 		}
@@ -2288,7 +3000,7 @@ namespace OgreOggSound
 			sound->_openImpl(file, buffer);
 
 			// Increment the reference count since this buffer is now being used for another sound.
-			++buffer->mRefCount;
+			_addSharedBufferRef(buffer);
 		}
 
 		// If requested to preBuffer - grab free source and init
@@ -2302,6 +3014,65 @@ namespace OgreOggSound
 		}
 	}
 	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_addSoundSlot(OgreOggISound* sound)
+	{
+		if ( !sound ) return;
+
+		unsigned int slot;
+
+		// Reuse a released slot if possible
+		if ( !mFreeSoundSlots.empty() )
+		{
+			slot = mFreeSoundSlots.back();
+			mFreeSoundSlots.pop_back();
+		}
+		else
+		{
+			SoundSlot s;
+			s.mSound = 0;
+			s.mGeneration = 1;
+			slot = static_cast<unsigned int>(mSoundSlots.size());
+			mSoundSlots.push_back(s);
+		}
+
+		mSoundSlots[slot].mSound = sound;
+		sound->mSlot = slot;
+		sound->mSlotGeneration = mSoundSlots[slot].mGeneration;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_releaseSoundSlot(OgreOggISound* sound)
+	{
+		if ( !sound || sound->mSlot>=mSoundSlots.size() ) return;
+
+		SoundSlot& s = mSoundSlots[sound->mSlot];
+		if ( s.mSound!=sound ) return;
+
+		// Invalidate any outstanding requests and handles, 0 is reserved
+		s.mSound = 0;
+		if ( ++s.mGeneration==0 ) s.mGeneration = 1;
+		mFreeSoundSlots.push_back(sound->mSlot);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggISound* OgreOggSoundManager::_getSoundFromSlot(unsigned int slot, unsigned int generation)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock soundLock(mSoundMutex);
+		#else
+				boost::recursive_mutex::scoped_lock soundLock(mSoundMutex);
+		#	endif
+		#endif
+
+		if ( slot>=mSoundSlots.size() ) return 0;
+
+		const SoundSlot& s = mSoundSlots[slot];
+		if ( !s.mSound || s.mGeneration!=generation ) return 0;
+#if OGGSOUND_THREADED
+		if ( s.mSound->_isDestroying() ) return 0;
+#endif
+		return s.mSound;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::_removeFromLists(OgreOggSound::OgreOggISound *sound)
 	{
 		// Remove from reactivate list
@@ -2348,18 +3119,11 @@ namespace OgreOggSound
 		}
 		/** Active sound list
 		*/
-		if ( !mActiveSounds.empty() )
-		{
-			// Remove ALL references to this sound..
-			ActiveList::iterator iter=mActiveSounds.begin(); 
-			while ( iter!=mActiveSounds.end() )
-			{
-				if ( sound==(*iter) )
-					iter=mActiveSounds.erase(iter);
-				else
-					++iter;
-			}
-		}
+		_removeActiveSound(sound);
+
+		/** Virtual sound list
+		*/
+		if ( sound && sound->mVirtual ) _removeVirtualSound(sound);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::_releaseSoundImpl(OgreOggISound* sound)
@@ -2391,6 +3155,7 @@ namespace OgreOggSound
 
 		SoundMap::iterator i = mSoundMap.find(sound->getName());
 		mSoundMap.erase(i);
+		_releaseSoundSlot(sound);
 
 		// Delete sound
 		OGRE_DELETE_T(sound, OgreOggISound, Ogre::MEMCATEGORY_GENERAL);
@@ -2472,6 +3237,41 @@ namespace OgreOggSound
 			Ogre::LogManager::getSingleton().logMessage(msg);
 		}
 
+		// Compressed buffers
+		mIma4Support = alIsExtensionPresent("AL_EXT_IMA4") == AL_TRUE;
+		mMsAdpcmSupport = alIsExtensionPresent("AL_SOFT_MSADPCM") == AL_TRUE;
+		mBlockAlignmentSupport = alIsExtensionPresent("AL_SOFT_block_alignment") == AL_TRUE;
+		Ogre::LogManager::getSingleton().logMessage(mIma4Support ? "*** --- AL_EXT_IMA4 Detected" : "*** --- AL_EXT_IMA4 NOT Detected");
+		Ogre::LogManager::getSingleton().logMessage(mMsAdpcmSupport ? "*** --- AL_SOFT_MSADPCM Detected" : "*** --- AL_SOFT_MSADPCM NOT Detected");
+		Ogre::LogManager::getSingleton().logMessage(mBlockAlignmentSupport ? "*** --- AL_SOFT_block_alignment Detected" : "*** --- AL_SOFT_block_alignment NOT Detected");
+
+		// Float buffers
+		mFloat32Support = alIsExtensionPresent("AL_EXT_FLOAT32") == AL_TRUE;
+		Ogre::LogManager::getSingleton().logMessage(mFloat32Support ? "*** --- AL_EXT_FLOAT32 Detected" : "*** --- AL_EXT_FLOAT32 NOT Detected");
+
+		// Deferred updates
+		if ( alIsExtensionPresent("AL_SOFT_deferred_updates") == AL_TRUE )
+		{
+			mALDeferUpdates = (LPALDEFERUPDATESSOFT)alGetProcAddress("alDeferUpdatesSOFT");
+			mALProcessUpdates = (LPALPROCESSUPDATESSOFT)alGetProcAddress("alProcessUpdatesSOFT");
+		}
+		if ( mALDeferUpdates && mALProcessUpdates )
+			Ogre::LogManager::getSingleton().logMessage("*** --- AL_SOFT_deferred_updates Detected");
+		else
+		{
+			mALDeferUpdates = 0;
+			mALProcessUpdates = 0;
+			Ogre::LogManager::getSingleton().logMessage("*** --- AL_SOFT_deferred_updates NOT Detected");
+		}
+
+		// Block uploads
+		if ( alIsExtensionPresent("AL_SOFT_buffer_sub_data") == AL_TRUE )
+			mALBufferSubData = (LPALBUFFERSUBDATASOFT)alGetProcAddress("alBufferSubDataSOFT");
+		if ( mALBufferSubData )
+			Ogre::LogManager::getSingleton().logMessage("*** --- AL_SOFT_buffer_sub_data Detected");
+		else
+			Ogre::LogManager::getSingleton().logMessage("*** --- AL_SOFT_buffer_sub_data NOT Detected");
+
 #if HAVE_EFX
 		// EFX
 		mEFXSupport = _checkEFXSupport();
@@ -2525,6 +3325,8 @@ namespace OgreOggSound
 		mPausedSounds.clear();
 		mWaitingSounds.clear();
 		mActiveSounds.clear();
+		mSourceHeap.clear();
+		mVirtualSounds.clear();
 
 		stopAllSounds();
 		_destroyAllSoundsImpl();
@@ -2627,11 +3429,6 @@ namespace OgreOggSound
 
 		if (mListener)
 		{
-			const Ogre::Vector3 listenerPos(mListener->getPosition());
-
-			// Sort list by distance
-			mActiveSounds.sort(_sortNearToFar(listenerPos));
-
 			// Get sound object from front of list
 			OgreOggISound* snd = mSoundsToReactivate.front();
 
@@ -2660,8 +3457,8 @@ namespace OgreOggSound
 #if OGGSOUND_THREADED
 		SoundAction action;
 		action.mAction	= LQ_REACTIVATE;
-		action.mParams	= 0;
-		action.mSound	= "";
+		action.mSlot	= 0;
+		action.mGeneration = 0;
 		action.mImmediately = false;
 		_requestSoundAction(action);
 #else
@@ -2719,6 +3516,417 @@ namespace OgreOggSound
 		return result;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_findResourceFileInfo(const Ogre::String& file, Ogre::FileInfo& info) const
+	{
+		Ogre::ResourceGroupManager* groupManager = Ogre::ResourceGroupManager::getSingletonPtr();
+		if ( !groupManager ) return false;
+
+		try
+		{
+			Ogre::String group = getResourceGroupName();
+			if ( group.empty() ) 
+				group = groupManager->findGroupContainingResource(file);
+
+			Ogre::FileInfoListPtr list = groupManager->findResourceFileInfo(group, file);
+			if ( !list.get() || list->empty() || !list->front().archive ) return false;
+
+			info = list->front();
+			return true;
+		}
+		catch (Ogre::Exception&)
+		{
+			return false;
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_getResourcePath(const Ogre::String& file, Ogre::String& path) const
+	{
+		Ogre::FileInfo fi;
+		if ( !_findResourceFileInfo(file, fi) ) return false;
+
+		// Only plain files can be mapped
+		if ( fi.archive->getType()!="FileSystem" ) return false;
+
+		path = fi.archive->getName() + "/" + fi.filename;
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	Ogre::String OgreOggSoundManager::_getDecodeCacheKey(const Ogre::String& file, Ogre::DataStreamPtr& stream) const
+	{
+		Ogre::String key = file + "|" + Ogre::StringConverter::toString(static_cast<unsigned long>(stream->size()));
+
+		Ogre::FileInfo fi;
+		time_t modified = 0;
+		if ( _findResourceFileInfo(file, fi) ) 
+			modified = fi.archive->getModifiedTime(fi.filename);
+
+		if ( modified>0 )
+			return key + "|" + Ogre::StringConverter::toString(static_cast<unsigned long>(modified));
+
+		// No timestamp, hash contents
+		char block[65536];
+		unsigned long long hash = OgreOggSoundDecodeCache::hash(0, 0);
+		size_t read;
+		stream->seek(0);
+		while ( (read = stream->read(block, sizeof(block)))>0 )
+			hash = OgreOggSoundDecodeCache::hash(block, read, hash);
+		stream->seek(0);
+
+		char digest[32];
+		sprintf(digest, "%016llx", hash);
+		return key + "|" + digest;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	const char* OgreOggSoundManager::_findDecodeCache(const Ogre::String& key, int channels, long rate, OgreOggMappedFile& file, size_t& size)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		return mDecodeCache ? mDecodeCache->find(key, channels, rate, file, size) : 0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_storeDecodeCache(const Ogre::String& key, int channels, long rate, const char* data, size_t size)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		if ( mDecodeCache ) mDecodeCache->store(key, channels, rate, data, size);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::preloadSounds(const Ogre::StringVector& files, PreloadListener* listener)
+	{
+		if ( files.empty() )
+		{
+			if ( listener ) listener->preloadFinished();
+			return;
+		}
+
+		std::vector<Ogre::DataStreamPtr> streams(files.size());
+		Ogre::StringVector cacheKeys(files.size());
+		unsigned int floatChannels = 0;
+		{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+			if ( !mPreloader )
+				mPreloader = OGRE_NEW_T(OgreOggSoundPreloader, Ogre::MEMCATEGORY_GENERAL)(mPreloadThreads);
+
+			// Ogg files decode to float as a static sound would, ADPCM is encoded from 16-bit data
+			if ( !( mCompressStaticAudio && mIma4Support ) )
+			{
+				static const int channels[] = { 1, 2, 4, 6, 7, 8 };
+				for ( size_t i=0; i<sizeof(channels)/sizeof(channels[0]); ++i )
+				{
+					ALenum format;
+					if ( _getFloatFormat(channels[i], format) ) floatChannels |= 1u<<channels[i];
+				}
+			}
+
+			// Open here as decode threads can't use the resource system
+			for ( size_t i=0; i<files.size(); ++i )
+			{
+				try
+				{
+					streams[i] = _openStream(files[i]);
+					if ( mDecodeCache && !streams[i].isNull() ) cacheKeys[i] = _getDecodeCacheKey(files[i], streams[i]);
+				}
+				catch (Ogre::Exception&)
+				{
+					// Left null, reported as a failed preload
+				}
+			}
+		}
+
+		mPreloader->queue(files, streams, cacheKeys, floatChannels, listener);
+
+#if OGGSOUND_THREADED == 0
+		_processPreloadedSounds();
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::unloadPreloadedSound(const std::string& file)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		std::set<std::string>::iterator i = mPreloadedSounds.find(file);
+		if ( i==mPreloadedSounds.end() ) return false;
+
+		mPreloadedSounds.erase(i);
+
+		if ( sharedAudioBuffer* buffer = _getSharedBuffer(file) )
+		{
+			ALuint id = buffer->mAudioBuffer;
+			_releaseSharedBuffer(file, id);
+		}
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_bufferCompressed(ALuint buffer, const char* pcm, size_t bytes, int channels, ALsizei rate, ALenum& format)
+	{
+		if ( !mCompressStaticAudio || !mIma4Support || !pcm || (channels!=1 && channels!=2) ) return false;
+
+		OGGSOUND_PROFILE_SCOPE("OgreOggSoundManager::_bufferCompressed");
+
+		// Larger blocks waste less space on headers
+		const int samplesPerBlock = mBlockAlignmentSupport ? IMA4_BLOCK_SAMPLES : IMA4_DEFAULT_BLOCK_SAMPLES;
+		const size_t frames = bytes / (channels * 2);
+
+		std::vector<char> data;
+		OgreOggSoundAdpcm::encodeIma4(reinterpret_cast<const short*>(pcm), frames, channels, samplesPerBlock, data);
+
+		// Nothing encoded, upload the PCM instead
+		if ( data.empty() ) return false;
+
+		format = (channels==1) ? AL_FORMAT_MONO_IMA4 : AL_FORMAT_STEREO_IMA4;
+		if ( mBlockAlignmentSupport ) 
+			alBufferi(buffer, AL_UNPACK_BLOCK_ALIGNMENT_SOFT, samplesPerBlock);
+		alBufferData(buffer, format, &data[0], static_cast<ALsizei>(data.size()), rate);
+
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_getFloatFormat(int channels, ALenum& format) const
+	{
+		if ( !mFloatDecoding || !mFloat32Support ) return false;
+
+		ALenum f = AL_NONE;
+		switch(channels)
+		{
+		case 1: f = AL_FORMAT_MONO_FLOAT32; break;
+		case 2: f = AL_FORMAT_STEREO_FLOAT32; break;
+		case 4: f = alGetEnumValue("AL_FORMAT_QUAD32"); break;
+		case 6: f = alGetEnumValue("AL_FORMAT_51CHN32"); break;
+		case 7: f = alGetEnumValue("AL_FORMAT_61CHN32"); break;
+		case 8: f = alGetEnumValue("AL_FORMAT_71CHN32"); break;
+		}
+
+		if ( f<=0 ) return false;
+
+		format = f;
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::loadCompressedSound(const Ogre::String& file)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		if ( mCompressedSounds.find(file)!=mCompressedSounds.end() ) return true;
+
+		try
+		{
+			Ogre::DataStreamPtr stream = _openStream(file);
+			if ( stream.isNull() ) return false;
+
+			// Read whole file
+			Ogre::MemoryDataStreamPtr data(OGRE_NEW Ogre::MemoryDataStream(file, stream, true, true));
+			mCompressedSounds[file] = data;
+			mCompressedSoundMemory += data->size();
+		}
+		catch (Ogre::Exception& e)
+		{
+			Ogre::LogManager::getSingleton().logMessage("*** OgreOggSoundManager::loadCompressedSound() - Failed to load: "+file+" - "+e.getDescription());
+			return false;
+		}
+
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::unloadCompressedSound(const Ogre::String& file)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		CompressedSoundMap::iterator i = mCompressedSounds.find(file);
+		if ( i==mCompressedSounds.end() ) return false;
+
+		// Sounds reading from it hold their own reference
+		mCompressedSoundMemory -= i->second->size();
+		mCompressedSounds.erase(i);
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::isCompressedSoundLoaded(const Ogre::String& file)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		return mCompressedSounds.find(file)!=mCompressedSounds.end();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	Ogre::MemoryDataStreamPtr OgreOggSoundManager::_getCompressedSound(const Ogre::String& file)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		CompressedSoundMap::iterator i = mCompressedSounds.find(file);
+		return i!=mCompressedSounds.end() ? i->second : Ogre::MemoryDataStreamPtr();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_processPreloadedSounds()
+	{
+		if ( !mPreloader ) return;
+
+		PreloadedSound* sound=0;
+		while ( mPreloader->popDecoded(sound) )
+		{
+			bool success = _uploadPreloadedSound(*sound);
+			if ( !success )
+			{
+				Ogre::String msg="*** OgreOggSoundManager::preloadSounds() - Failed to preload: "+sound->mFile+" - "+sound->mError;
+				Ogre::LogManager::getSingleton().logMessage(msg);
+			}
+
+			PreloadBatch* batch = sound->mBatch;
+			if ( batch->mListener ) batch->mListener->soundPreloaded(sound->mFile, success);
+			OGRE_DELETE_T(sound, PreloadedSound, Ogre::MEMCATEGORY_GENERAL);
+
+			// Whole request handled?
+			if ( --batch->mRemaining==0 )
+			{
+				if ( batch->mListener ) batch->mListener->preloadFinished();
+				OGRE_DELETE_T(batch, PreloadBatch, Ogre::MEMCATEGORY_GENERAL);
+			}
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundManager::_uploadPreloadedSound(PreloadedSound& sound)
+	{
+		if ( !sound.mSuccess ) return false;
+
+		// Already loaded, just hold a reference
+		if ( sharedAudioBuffer* shared = _getSharedBuffer(sound.mFile) )
+		{
+			if ( mPreloadedSounds.insert(sound.mFile).second )
+				_addSharedBufferRef(shared);
+			return true;
+		}
+
+		ALenum format = AL_NONE;
+		if ( sound.mFloat ) 
+			_getFloatFormat(sound.mChannels, format);
+		else
+			format = _getPCMFormat(sound.mChannels, sound.mBitsPerSample);
+		if ( format==AL_NONE )
+		{
+			sound.mError = "Format NOT supported.";
+			return false;
+		}
+
+		ALuint buffer;
+		alGetError();
+		alGenBuffers(1, &buffer);
+		if ( alGetError()!=AL_NO_ERROR )
+		{
+			sound.mError = "Unable to create OpenAL buffer.";
+			return false;
+		}
+
+#if HAVE_EFX
+		// Upload to XRAM buffers if available
+		if ( hasXRamSupport() )
+			setXRamBuffer(1, &buffer);
+#endif
+
+		const char* pcm = sound.mData.empty() ? 0 : &sound.mData[0];
+
+		// Re-encode as a static sound would, 8-bit data is widened first
+		bool compressed = false;
+		if ( !sound.mFloat && pcm )
+		{
+			if ( sound.mBitsPerSample!=8 )
+				compressed = _bufferCompressed(buffer, pcm, sound.mData.size(), sound.mChannels, sound.mSampleRate, format);
+			else if ( mCompressStaticAudio && mIma4Support )
+			{
+				std::vector<short> pcm16(sound.mData.size());
+				OgreOggSoundKernels::convert8To16(reinterpret_cast<const unsigned char*>(pcm), sound.mData.size(), &pcm16[0]);
+				compressed = _bufferCompressed(buffer, reinterpret_cast<const char*>(&pcm16[0]), pcm16.size() * sizeof(short), sound.mChannels, sound.mSampleRate, format);
+			}
+		}
+		if ( !compressed )
+			alBufferData(buffer, format, pcm, static_cast<ALsizei>(sound.mData.size()), sound.mSampleRate);
+		if ( alGetError()!=AL_NO_ERROR )
+		{
+			alDeleteBuffers(1, &buffer);
+			sound.mError = "Unable to load audio data into buffer!";
+			return false;
+		}
+
+		// Register shared buffer, referenced by the manager until unloaded
+		sharedAudioBuffer* buf = OGRE_NEW_T(sharedAudioBuffer, Ogre::MEMCATEGORY_GENERAL);
+		buf->mAudioBuffer = buffer;
+		buf->mRefCount = 1;
+		buf->mBuffers.bind(new BufferList(1, buffer));
+		buf->mPlayTime = static_cast<float>((sound.mData.size()*8.f) / static_cast<float>(sound.mSampleRate * sound.mChannels * sound.mBitsPerSample));
+		buf->mFormat = format;
+		ALint size=0;
+		alGetBufferi(buffer, AL_SIZE, &size);
+		buf->mSize = static_cast<unsigned int>(size);
+		mSharedBuffers[sound.mFile] = buf;
+		mPreloadedSounds.insert(sound.mFile);
+
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	ALenum OgreOggSoundManager::_getPCMFormat(unsigned short channels, unsigned short bitsPerSample) const
+	{
+		bool is8Bit = ( bitsPerSample==8 );
+		ALenum format = AL_NONE;
+
+		switch(channels)
+		{
+		case 1: format = is8Bit ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16; break;
+		case 2: format = is8Bit ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16; break;
+		case 4: format = alGetEnumValue(is8Bit ? "AL_FORMAT_QUAD8" : "AL_FORMAT_QUAD16"); break;
+		case 6: format = alGetEnumValue(is8Bit ? "AL_FORMAT_51CHN8" : "AL_FORMAT_51CHN16"); break;
+		case 7: format = alGetEnumValue(is8Bit ? "AL_FORMAT_61CHN8" : "AL_FORMAT_61CHN16"); break;
+		case 8: format = alGetEnumValue(is8Bit ? "AL_FORMAT_71CHN8" : "AL_FORMAT_71CHN16"); break;
+		}
+
+		return ( format>0 ) ? format : AL_NONE;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	bool OgreOggSoundManager::_releaseSharedBuffer(const String& sName, ALuint& buffer)
 	{
 		if ( sName.empty() ) return false;
@@ -2733,14 +3941,24 @@ namespace OgreOggSound
 				f->second->mRefCount--;
 				if ( f->second->mRefCount==0 )
 				{
-					// Delete buffer object
-					alDeleteBuffers(1, &f->second->mAudioBuffer);
+					if ( mSharedBufferBudget>0 && f->second->mSize<=mSharedBufferBudget )
+					{
+						// Keep in cache as most recently used
+						f->second->mCachePosition = mSharedBufferCache.insert(mSharedBufferCache.begin(), f->first);
+						mSharedBufferCacheSize += f->second->mSize;
+						_trimSharedBufferCache(mSharedBufferBudget);
+					}
+					else
+					{
+						// Delete buffer object
+						alDeleteBuffers(1, &f->second->mAudioBuffer);
 
-					// Delete struct
-					OGRE_DELETE_T(f->second, sharedAudioBuffer, Ogre::MEMCATEGORY_GENERAL);
+						// Delete struct
+						OGRE_DELETE_T(f->second, sharedAudioBuffer, Ogre::MEMCATEGORY_GENERAL);
 
-					// Remove from list
-					mSharedBuffers.erase(f);
+						// Remove from list
+						mSharedBuffers.erase(f);
+					}
 				}
 				return true;
 			}
@@ -2748,6 +3966,96 @@ namespace OgreOggSound
 		return false;
 	}	
 	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_addSharedBufferRef(sharedAudioBuffer* buffer)
+	{
+		if ( !buffer ) return;
+
+		// Revive from cache
+		if ( buffer->mRefCount==0 )
+		{
+			mSharedBufferCache.erase(buffer->mCachePosition);
+			mSharedBufferCacheSize -= buffer->mSize;
+		}
+
+		++buffer->mRefCount;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_trimSharedBufferCache(size_t budget)
+	{
+		// A budget of 0 disables the cache entirely
+		while ( !mSharedBufferCache.empty() && ( mSharedBufferCacheSize>budget || budget==0 ) )
+		{
+			// Least recently used is at the back
+			SharedBufferList::iterator f = mSharedBuffers.find(mSharedBufferCache.back());
+			mSharedBufferCache.pop_back();
+
+			if ( f==mSharedBuffers.end() ) continue;
+
+			mSharedBufferCacheSize -= f->second->mSize;
+			alDeleteBuffers(1, &f->second->mAudioBuffer);
+			OGRE_DELETE_T(f->second, sharedAudioBuffer, Ogre::MEMCATEGORY_GENERAL);
+			mSharedBuffers.erase(f);
+			++mSharedBufferEvictions;
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::setSharedBufferBudget(size_t bytes)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		mSharedBufferBudget = bytes;
+		_trimSharedBufferCache(mSharedBufferBudget);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::setDecodeCache(const Ogre::String& directory, size_t maxBytes)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		if ( mDecodeCache && mDecodeCache->getDirectory()==directory )
+		{
+			mDecodeCache->setMaxSize(maxBytes);
+			return;
+		}
+
+		if ( mDecodeCache )
+		{
+			OGRE_DELETE_T(mDecodeCache, OgreOggSoundDecodeCache, Ogre::MEMCATEGORY_GENERAL);
+			mDecodeCache=0;
+		}
+
+		if ( !directory.empty() )
+			mDecodeCache = OGRE_NEW_T(OgreOggSoundDecodeCache, Ogre::MEMCATEGORY_GENERAL)(directory, maxBytes);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::setStreamDecodeAhead(float seconds)
+	{
+		#if OGGSOUND_THREADED
+		#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+		#	else
+				boost::recursive_mutex::scoped_lock l(mMutex);
+		#	endif
+		#endif
+
+		mStreamDecodeAhead = std::max(seconds, 0.f);
+
+		// Decoder stays around for streams already using it
+		if ( mStreamDecodeAhead>0.f && !mStreamDecoder )
+			mStreamDecoder = OGRE_NEW_T(OgreOggStreamDecoder, Ogre::MEMCATEGORY_GENERAL)(mStreamDecodeThreads);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	bool OgreOggSoundManager::_registerSharedBuffer(const String& sName, ALuint& buffer, OgreOggISound* parent)
 	{
 		if ( sName.empty() ) return false;
@@ -2764,6 +4072,11 @@ namespace OgreOggSound
 			// Set ref count
 			buf->mRefCount = 1;
 
+			// Size counts against the cache budget once unused
+			ALint size=0;
+			alGetBufferi(buffer, AL_SIZE, &size);
+			buf->mSize = static_cast<unsigned int>(size);
+
 			// Copy the shared information into the buffer so it can be passed around to every other sound that needs it.
 			parent->_getSharedProperties(buf->mBuffers, buf->mPlayTime, buf->mFormat);
 
@@ -2779,12 +4092,27 @@ namespace OgreOggSound
 		static Ogre::uint32 cTime;
 		static Ogre::uint32 pTime=0;
 		static Ogre::Timer timer;
-		static float rTime=0.f;
 
 		// Get frame time
-		cTime = timer.getMillisecondsCPU();
+		// NOTE:- Wall clock time, CPU time doesn't advance whilst the thread sleeps
+		cTime = timer.getMilliseconds();
 		float fTime = (cTime-pTime) * 0.001f;
 
+		// Reset timer
+		pTime=cTime;
+
+		_updateBuffers(fTime);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_updateBuffers(float fTime)
+	{
+		OGGSOUND_PROFILE_SCOPE("OgreOggSoundManager::_updateBuffers");
+
+		static float rTime=0.f;
+
+		// Batch this ticks state changes
+		_deferStateUpdates();
+
 		// update Listener
 		if ( mListener ) 
 			mListener->update();
@@ -2796,6 +4124,9 @@ namespace OgreOggSound
 			// update pos/fade
 			(*i)->update(fTime);
 
+			// Submit changed properties
+			(*i)->_flushState();
+
 			// Update buffers
 			(*i)->_updateAudioBuffers();
 
@@ -2806,37 +4137,51 @@ namespace OgreOggSound
 			++i;
 		}
 
+		// Reclaim finished voices
+		_updateVoices();
+
+		// Refresh source stealing order
+		_updateSourceHeap();
+
+		// Advance and realise virtual sounds
+		_updateVirtualSounds(fTime);
+
+		// Apply batched state changes
+		_processStateUpdates();
+
+		// Publish per-second statistics
+		_updateStatistics(fTime);
+
 		// Reactivate 10fps
 		if ( (rTime+=fTime) > 0.1f )
 		{
 			_reactivateQueuedSoundsImpl();
 			rTime=0.f;
 		}
-
-		// Reset timer
-		pTime=cTime;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::_performAction(const SoundAction& act)
 	{
+		OGGSOUND_PROFILE_SCOPE("OgreOggSoundManager::_performAction");
+
 		switch (act.mAction)
 		{
 		case LQ_PLAY:			
 			{ 
-				if ( hasSound(act.mSound) )
-					getSound(act.mSound)->_playImpl(); 
+				if ( OgreOggISound* s = _getSoundFromSlot(act.mSlot, act.mGeneration) )
+					s->_playImpl(); 
 			} 
 			break;
 		case LQ_PAUSE:			
 			{ 
-				if ( hasSound(act.mSound) )
-					getSound(act.mSound)->_pauseImpl(); 
+				if ( OgreOggISound* s = _getSoundFromSlot(act.mSlot, act.mGeneration) )
+					s->_pauseImpl(); 
 			} 
 			break;
 		case LQ_STOP:			
 			{ 
-				if ( hasSound(act.mSound) )
-					getSound(act.mSound)->_stopImpl(); 
+				if ( OgreOggISound* s = _getSoundFromSlot(act.mSlot, act.mGeneration) )
+					s->_stopImpl(); 
 			} 
 			break;
 		case LQ_REACTIVATE:		
@@ -2866,61 +4211,52 @@ namespace OgreOggSound
 			break;
 		case LQ_LOAD:
 			{
-				cSound* c = static_cast<cSound*>(act.mParams);
-				if ( hasSound(act.mSound) )
-				{
-					OgreOggISound* s = getSound(act.mSound); 
-					_loadSoundImpl(s, c->mFileName, c->mPrebuffer);
-				}
+				OGGSOUND_PROFILE_SCOPE("OgreOggSoundManager::_performAction(LQ_LOAD)");
 
-				// Delete
-				OGRE_DELETE_T(c, cSound, Ogre::MEMCATEGORY_GENERAL);
+				if ( OgreOggISound* s = _getSoundFromSlot(act.mSlot, act.mGeneration) )
+					_loadSoundImpl(s, s->mLoadFile, act.mParams.mLoad.mPrebuffer);
 			}
 			break;
 #if HAVE_EFX
 		case LQ_ATTACH_EFX:
 			{
-				efxProperty* e = static_cast<efxProperty*>(act.mParams);
-				if ( hasSound(act.mSound) )
+				const efxProperty& e = act.mParams.mEfx;
+				if ( OgreOggISound* s = _getSoundFromSlot(act.mSlot, act.mGeneration) )
 				{
-					OgreOggISound* s = getSound(act.mSound); 
-					if ( !e->mEffectName.empty() && !e->mFilterName.empty() ) 
-						_attachEffectToSoundImpl(s, e->mSlotID, e->mEffectName, e->mFilterName);
+					if ( e.mSlotID!=255 ) 
+						_attachEffectToSoundImpl(s, e.mSlotID, e.mEffect, e.mFilter);
 					else
-						_attachFilterToSoundImpl(s, e->mFilterName);
+						_attachFilterToSoundImpl(s, e.mFilter);
 				}
-				// Delete
-				OGRE_DELETE_T(e, efxProperty, Ogre::MEMCATEGORY_GENERAL);
 			}
 			break;
 		case LQ_DETACH_EFX:
 			{
-				efxProperty* e = static_cast<efxProperty*>(act.mParams);
-				if ( hasSound(act.mSound) )
+				const efxProperty& e = act.mParams.mEfx;
+				if ( OgreOggISound* s = _getSoundFromSlot(act.mSlot, act.mGeneration) )
 				{
-					OgreOggISound* s = getSound(act.mSound); 
-					if ( e->mSlotID!=255 ) 
-						_detachEffectFromSoundImpl(s, e->mSlotID);
+					if ( e.mSlotID!=255 ) 
+						_detachEffectFromSoundImpl(s, e.mSlotID);
 					else
 						_detachFilterFromSoundImpl(s);
 				}
-				// Delete
-				OGRE_DELETE_T(e, efxProperty, Ogre::MEMCATEGORY_GENERAL);
 			}
 			break;
 		case LQ_SET_EFX_PROPERTY:
 			{
-				efxProperty* e = static_cast<efxProperty*>(act.mParams);
-				if ( hasSound(act.mSound) )
-				{
-					OgreOggISound* s = getSound(act.mSound); 
-					_setEFXSoundPropertiesImpl(s, e->mAirAbsorption, e->mRolloff, e->mConeHF);
-				}
-				// Delete
-				OGRE_DELETE_T(e, efxProperty, Ogre::MEMCATEGORY_GENERAL);
+				const efxProperty& e = act.mParams.mEfx;
+				if ( OgreOggISound* s = _getSoundFromSlot(act.mSlot, act.mGeneration) )
+					_setEFXSoundPropertiesImpl(s, e.mAirAbsorption, e.mRolloff, e.mConeHF);
 			}
 			break;
 #endif
+		case LQ_PLAY_VOICE:
+			{
+				const voiceProperty& v = act.mParams.mVoice;
+				if ( OgreOggISound* s = _getSoundFromSlot(act.mSlot, act.mGeneration) )
+					_playVoiceImpl(s, Ogre::Vector3(v.mPosition[0], v.mPosition[1], v.mPosition[2]), v.mGain, v.mPitch);
+			}
+			break;
 		}
 	}
 	/*/////////////////////////////////////////////////////////////////*/
@@ -2941,7 +4277,21 @@ namespace OgreOggSound
 
 		if ( !mActionsList ) return;
 
-		mActionsList->push(action);
+		if ( mActionsList->push(action) )
+		{
+			// Several threads may queue actions, keep the largest depth seen
+			size_t depth = mActionsList->size();
+			size_t highWater = mActionQueueHighWater.load(std::memory_order_relaxed);
+			while ( depth>highWater && !mActionQueueHighWater.compare_exchange_weak(highWater, depth, std::memory_order_relaxed) ) {}
+		}
+		else
+			++mActionsDropped;
+
+		// Only wake the streaming thread if it's waiting, an awake thread 
+		// collects the action before sleeping so a batch costs one wakeup
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if ( mStreamingSleeping.load(std::memory_order_relaxed) )
+			_notifyStreamingThread();
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggSoundManager::_processQueuedSounds()
@@ -2955,5 +4305,67 @@ namespace OgreOggSound
 			_performAction(act);
 		}
 	}
+	/*/////////////////////////////////////////////////////////////////*/
+	unsigned int OgreOggSoundManager::_getStreamingSleepTime()
+	{
+		float sleepTime = mStreamingMaxSleep * 0.001f;
+
+		// Recorder and queued sounds keep their original update rates
+		if ( mRecorder ) 
+			sleepTime = std::min(sleepTime, 0.01f);
+		if ( !mSoundsToReactivate.empty() || !mWaitingSounds.empty() )
+			sleepTime = std::min(sleepTime, 0.1f);
+
+		// Find earliest deadline
+		for ( ActiveList::const_iterator i=mActiveSounds.begin(); i!=mActiveSounds.end(); ++i )
+			sleepTime = std::min(sleepTime, (*i)->_getRefillDeadline());
+
+		unsigned int ms = static_cast<unsigned int>(sleepTime * 1000.f);
+		return ms>0 ? ms : 1;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_waitForStreamingWork(unsigned int ms)
+	{
+		// Actions queued before the flag was seen are handled straight away
+		mStreamingSleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if ( mActionsList && !mActionsList->empty() )
+		{
+			mStreamingSleeping = false;
+			return;
+		}
+
+#ifdef POCO_THREAD
+		mStreamingEvent.tryWait(ms);
+#else
+		boost::mutex::scoped_lock lock(mStreamingWakeMutex);
+		if ( !mStreamingWakePending )
+			mStreamingWakeCondition.timed_wait(lock, boost::posix_time::milliseconds(ms));
+		mStreamingWakePending = false;
+#endif
+		mStreamingSleeping = false;
+		++mStreamingWakeups;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundManager::_notifyStreamingThread()
+	{
+#ifdef POCO_THREAD
+		mStreamingEvent.set();
+#else
+		{
+			boost::mutex::scoped_lock lock(mStreamingWakeMutex);
+			mStreamingWakePending = true;
+		}
+		mStreamingWakeCondition.notify_one();
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	unsigned long OgreOggSoundManager::getStreamingWakeupsSaved() const
+	{
+		// Number of wakeups a fixed 10ms poll would have made
+		unsigned long polled = mStreamingTimer.getMilliseconds() / 10;
+		unsigned long wakeups = mStreamingWakeups;
+		return polled>wakeups ? polled-wakeups : 0;
+	}
 #endif
 }
@@ -0,0 +1,436 @@
+/**
+* @file OgreOggSoundPreloader.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+*/
+
+#include "OgreOggSoundPreloader.h"
+#include <set>
+#include <string>
+#include "OgreOggSoundManager.h"
+
+#if OGGSOUND_THREADED && defined(POCO_THREAD)
+#	include "Poco/Environment.h"
+#endif
+
+namespace OgreOggSound
+{
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggSoundPreloader::OgreOggSoundPreloader(unsigned int numThreads) :
+		mNumThreads(0)
+#if OGGSOUND_THREADED
+		,mShuttingDown(false)
+#	ifdef POCO_THREAD
+		,mWorker(0)
+#	endif
+#endif
+	{
+#if OGGSOUND_THREADED
+		if ( numThreads==0 )
+		{
+#	ifdef POCO_THREAD
+			numThreads = Poco::Environment::processorCount();
+#	else
+			numThreads = boost::thread::hardware_concurrency();
+#	endif
+			if ( numThreads==0 ) numThreads = 1;
+		}
+
+		mNumThreads = numThreads;
+
+#	ifdef POCO_THREAD
+		mWorker = OGRE_NEW_T(Worker, Ogre::MEMCATEGORY_GENERAL)(this);
+		for ( unsigned int i=0; i<mNumThreads; ++i )
+		{
+			Poco::Thread* t = OGRE_NEW_T(Poco::Thread, Ogre::MEMCATEGORY_GENERAL)();
+			t->start(*mWorker);
+			mThreads.push_back(t);
+		}
+#	else
+		for ( unsigned int i=0; i<mNumThreads; ++i )
+			mThreads.push_back(OGRE_NEW_T(boost::thread, Ogre::MEMCATEGORY_GENERAL)(&OgreOggSoundPreloader::_workerLoop, this));
+#	endif
+
+		Ogre::LogManager::getSingleton().logMessage("*** --- Preloading with " + Ogre::StringConverter::toString(mNumThreads) + " decode thread(s)", Ogre::LML_NORMAL);
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggSoundPreloader::~OgreOggSoundPreloader()
+	{
+		std::set<PreloadBatch*> batches;
+
+#if OGGSOUND_THREADED
+		{
+#	ifdef POCO_THREAD
+			Poco::Mutex::ScopedLock l(mMutex);
+#	else
+			boost::mutex::scoped_lock l(mMutex);
+#	endif
+			mShuttingDown = true;
+		}
+
+#	ifdef POCO_THREAD
+		// Workers pass the event on as they exit
+		mWorkEvent.set();
+		for ( std::vector<Poco::Thread*>::iterator i=mThreads.begin(); i!=mThreads.end(); ++i )
+		{
+			(*i)->join();
+			OGRE_DELETE_T((*i), Thread, Ogre::MEMCATEGORY_GENERAL);
+		}
+		OGRE_DELETE_T(mWorker, Worker, Ogre::MEMCATEGORY_GENERAL);
+		mWorker = 0;
+#	else
+		mWorkCondition.notify_all();
+		for ( std::vector<boost::thread*>::iterator i=mThreads.begin(); i!=mThreads.end(); ++i )
+		{
+			(*i)->join();
+			OGRE_DELETE_T((*i), thread, Ogre::MEMCATEGORY_GENERAL);
+		}
+#	endif
+		mThreads.clear();
+
+		// Discard anything not yet decoded
+		for ( std::deque<PreloadedSound*>::iterator i=mPending.begin(); i!=mPending.end(); ++i )
+		{
+			batches.insert((*i)->mBatch);
+			OGRE_DELETE_T((*i), PreloadedSound, Ogre::MEMCATEGORY_GENERAL);
+		}
+		mPending.clear();
+#endif
+
+		// Discard anything not yet uploaded
+		for ( std::deque<PreloadedSound*>::iterator i=mDecoded.begin(); i!=mDecoded.end(); ++i )
+		{
+			batches.insert((*i)->mBatch);
+			OGRE_DELETE_T((*i), PreloadedSound, Ogre::MEMCATEGORY_GENERAL);
+		}
+		mDecoded.clear();
+
+		for ( std::set<PreloadBatch*>::iterator i=batches.begin(); i!=batches.end(); ++i )
+			OGRE_DELETE_T((*i), PreloadBatch, Ogre::MEMCATEGORY_GENERAL);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundPreloader::queue(const Ogre::StringVector& files, const std::vector<Ogre::DataStreamPtr>& streams, const Ogre::StringVector& cacheKeys, unsigned int floatChannels, PreloadListener* listener)
+	{
+		if ( files.empty() || files.size()!=streams.size() || files.size()!=cacheKeys.size() ) return;
+
+		PreloadBatch* batch = OGRE_NEW_T(PreloadBatch, Ogre::MEMCATEGORY_GENERAL);
+		batch->mListener = listener;
+		batch->mRemaining = static_cast<unsigned int>(files.size());
+
+#if OGGSOUND_THREADED
+		{
+#	ifdef POCO_THREAD
+			Poco::Mutex::ScopedLock l(mMutex);
+#	else
+			boost::mutex::scoped_lock l(mMutex);
+#	endif
+			for ( size_t i=0; i<files.size(); ++i )
+			{
+				PreloadedSound* sound = OGRE_NEW_T(PreloadedSound, Ogre::MEMCATEGORY_GENERAL);
+				sound->mFile = files[i];
+				sound->mStream = streams[i];
+				sound->mCacheKey = cacheKeys[i];
+				sound->mFloatChannels = floatChannels;
+				sound->mBatch = batch;
+				mPending.push_back(sound);
+			}
+		}
+
+#	ifdef POCO_THREAD
+		// Workers pass the event on whilst work remains
+		mWorkEvent.set();
+#	else
+		mWorkCondition.notify_all();
+#	endif
+#else
+		for ( size_t i=0; i<files.size(); ++i )
+		{
+			PreloadedSound* sound = OGRE_NEW_T(PreloadedSound, Ogre::MEMCATEGORY_GENERAL);
+			sound->mFile = files[i];
+			sound->mStream = streams[i];
+			sound->mCacheKey = cacheKeys[i];
+			sound->mFloatChannels = floatChannels;
+			sound->mBatch = batch;
+			decode(*sound);
+			mDecoded.push_back(sound);
+		}
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundPreloader::popDecoded(PreloadedSound*& sound)
+	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mMutex);
+#	else
+		boost::mutex::scoped_lock l(mMutex);
+#	endif
+#endif
+		if ( mDecoded.empty() ) return false;
+
+		sound = mDecoded.front();
+		mDecoded.pop_front();
+		return true;
+	}
+#if OGGSOUND_THREADED
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundPreloader::_workerLoop()
+	{
+		OGGSOUND_PROFILE_THREAD("OgreOggSound preloader");
+
+		while ( true )
+		{
+			PreloadedSound* sound=0;
+			{
+#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+				while ( !mShuttingDown && mPending.empty() )
+				{
+					mMutex.unlock();
+					mWorkEvent.wait();
+					mMutex.lock();
+				}
+#	else
+				boost::mutex::scoped_lock l(mMutex);
+				while ( !mShuttingDown && mPending.empty() )
+					mWorkCondition.wait(l);
+#	endif
+				if ( mShuttingDown )
+				{
+#	ifdef POCO_THREAD
+					// Event only releases a single waiter, wake the next one
+					mWorkEvent.set();
+#	endif
+					return;
+				}
+
+				sound = mPending.front();
+				mPending.pop_front();
+
+#	ifdef POCO_THREAD
+				// Event only releases a single waiter
+				if ( !mPending.empty() ) mWorkEvent.set();
+#	endif
+			}
+
+			decode(*sound);
+
+			{
+#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mMutex);
+#	else
+				boost::mutex::scoped_lock l(mMutex);
+#	endif
+				mDecoded.push_back(sound);
+			}
+
+			// Wake streaming thread to upload
+			OgreOggSoundManager::getSingleton()._notifyStreamingThread();
+		}
+	}
+#endif
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundPreloader::decode(PreloadedSound& sound)
+	{
+		OGGSOUND_PROFILE_SCOPE("OgreOggSoundPreloader::decode");
+
+		try
+		{
+			Ogre::DataStreamPtr& stream = sound.mStream;
+
+			if ( stream.isNull() )
+				sound.mError = "Could not open file.";
+			else if ( sound.mFile.find(".ogg")!=sound.mFile.npos || sound.mFile.find(".OGG")!=sound.mFile.npos )
+				_decodeOgg(stream, sound);
+			else if ( sound.mFile.find(".wav")!=sound.mFile.npos || sound.mFile.find(".WAV")!=sound.mFile.npos )
+				_decodeWav(stream, sound);
+			else
+				sound.mError = "Sound does not have (.ogg | .wav) extension";
+		}
+		catch (Ogre::Exception& e)
+		{
+			sound.mError = e.getFullDescription();
+		}
+
+		if ( !sound.mSuccess ) sound.mData.clear();
+
+		// Done with the file
+		sound.mStream.setNull();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundPreloader::_decodeOgg(Ogre::DataStreamPtr& stream, PreloadedSound& sound)
+	{
+		OggVorbis_File oggStream;
+		ov_callbacks callbacks;
+		callbacks.read_func	= OOSStreamRead;
+		callbacks.close_func= OOSStreamClose;
+		callbacks.seek_func	= OOSStreamSeek;
+		callbacks.tell_func	= OOSStreamTell;
+
+		if ( ov_open_callbacks(&stream, &oggStream, NULL, 0, callbacks) < 0 )
+		{
+			sound.mError = "Could not open Ogg stream.";
+			return;
+		}
+
+		vorbis_info* info = ov_info(&oggStream, -1);
+		sound.mChannels = static_cast<unsigned short>(info->channels);
+		sound.mFloat = info->channels<32 && ( sound.mFloatChannels & (1u<<info->channels) )!=0;
+		sound.mBitsPerSample = sound.mFloat ? 32 : 16;
+		sound.mSampleRate = static_cast<unsigned int>(info->rate);
+
+		// Float data is cached separately
+		if ( !sound.mCacheKey.empty() && sound.mFloat ) sound.mCacheKey += "|f32";
+
+		// Use previously decoded data if available
+		if ( !sound.mCacheKey.empty() )
+		{
+			OgreOggMappedFile cached;
+			size_t size = 0;
+			const char* pcm = OgreOggSoundManager::getSingleton()._findDecodeCache(sound.mCacheKey, info->channels, info->rate, cached, size);
+			if ( pcm )
+			{
+				sound.mData.assign(pcm, pcm + size);
+				sound.mSuccess = true;
+				ov_clear(&oggStream);
+				return;
+			}
+		}
+
+		// Size for the whole file when known, otherwise grow as we go
+		const size_t sampleSize = sound.mBitsPerSample / 8;
+		const size_t chunk = static_cast<size_t>(sound.mSampleRate * sound.mChannels) * sampleSize / 4;
+		ogg_int64_t pcmTotal = ov_pcm_total(&oggStream, -1);
+		if ( pcmTotal>0 )
+			sound.mData.resize(static_cast<size_t>(pcmTotal) * sound.mChannels * sampleSize);
+		else
+			sound.mData.resize(chunk);
+
+		size_t sizeRead = 0;
+		int bitStream;
+		const size_t frameSize = sound.mChannels * sampleSize;
+		sound.mSuccess = true;
+		while ( true )
+		{
+			// Only whole frames are decoded
+			if ( sound.mData.size() - sizeRead<frameSize )
+				sound.mData.resize(sound.mData.size() + chunk);
+
+			const int size = static_cast<int>(sound.mData.size() - sizeRead);
+			long bytes = sound.mFloat ?
+				OgreOggISound::_readFloat(oggStream, &sound.mData[sizeRead], size, sound.mChannels, &bitStream) :
+				OgreOggISound::_readShort(oggStream, &sound.mData[sizeRead], size, sound.mChannels, &bitStream);
+
+			if ( bytes==0 ) break;
+			if ( bytes==OV_HOLE ) continue;
+			if ( bytes<0 )
+			{
+				sound.mError = "Error decoding Ogg stream.";
+				sound.mSuccess = false;
+				break;
+			}
+
+			sizeRead += bytes;
+		}
+		sound.mData.resize(sizeRead);
+
+		ov_clear(&oggStream);
+
+		// Keep for next time
+		if ( sound.mSuccess && !sound.mCacheKey.empty() )
+			OgreOggSoundManager::getSingleton()._storeDecodeCache(sound.mCacheKey, sound.mChannels, sound.mSampleRate, sound.mData.empty() ? 0 : &sound.mData[0], sound.mData.size());
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundPreloader::_decodeWav(Ogre::DataStreamPtr& stream, PreloadedSound& sound)
+	{
+		WaveHeader header;
+		ChunkHeader c;
+
+		stream->read(&header, sizeof(WaveHeader));
+
+		if ( header.mRIFF[0]!='R' || header.mRIFF[1]!='I' || header.mRIFF[2]!='F' || header.mRIFF[3]!='F' )
+		{
+			sound.mError = "Not a valid RIFF file!";
+			return;
+		}
+		if ( header.mWAVE[0]!='W' || header.mWAVE[1]!='A' || header.mWAVE[2]!='V' || header.mWAVE[3]!='E' )
+		{
+			sound.mError = "Not a valid WAVE file!";
+			return;
+		}
+		if ( header.mFMT[0]!='f' || header.mFMT[1]!='m' || header.mFMT[2]!='t' || header.mFMT[3]!=' ' || header.mHeaderSize<16 )
+		{
+			sound.mError = "Invalid Format!";
+			return;
+		}
+		if ( header.mFormatTag!=0x0001 && header.mFormatTag!=0xFFFE )
+		{
+			sound.mError = "Compressed wav NOT supported!";
+			return;
+		}
+		if ( header.mBitsPerSample!=16 && header.mBitsPerSample!=8 )
+		{
+			sound.mError = "BitsPerSample NOT 8/16!";
+			return;
+		}
+		if ( header.mChannels==0 || header.mBlockAlign==0 )
+		{
+			sound.mError = "Invalid channel count or block alignment!";
+			return;
+		}
+
+		// Skip any extra format info, including WAVEFORMATEXTENSIBLE attributes
+		stream->skip(header.mHeaderSize - (sizeof(WaveHeader) - 20));
+
+		while ( !stream->eof() )
+		{
+			if ( stream->read(&c, sizeof(ChunkHeader))!=sizeof(ChunkHeader) ) break;
+
+			// 'data' chunk...
+			if ( c.chunkID[0]=='d' && c.chunkID[1]=='a' && c.chunkID[2]=='t' && c.chunkID[3]=='a' )
+			{
+				sound.mData.resize(c.length - (c.length % header.mBlockAlign));
+				if ( !sound.mData.empty() )
+					sound.mData.resize(stream->read(&sound.mData[0], sound.mData.size()));
+
+				sound.mChannels = header.mChannels;
+				sound.mBitsPerSample = header.mBitsPerSample;
+				sound.mSampleRate = header.mSamplesPerSec;
+				sound.mSuccess = true;
+				return;
+			}
+			// Unsupported chunk...
+			else
+				stream->skip(c.length);
+		}
+
+		sound.mError = "No data chunk found!";
+	}
+}
@@ -0,0 +1,257 @@
+/**
+* @file OgreOggSoundProfiler.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+*/
+
+#include "OgreOggSoundProfiler.h"
+#include <OgreProfiler.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace OgreOggSound
+{
+	namespace
+	{
+		//! A single recorded scope
+		struct TraceSpan
+		{
+			const char* mName;
+			unsigned long long mStart;
+			unsigned long long mEnd;
+		};
+
+		//! Ring buffer of spans recorded by one thread
+		struct TraceThread
+		{
+			std::mutex mMutex;
+			std::vector<TraceSpan> mSpans;	// Ring storage
+			size_t mWritten;				// Total spans written
+			const char* mName;				// Thread name
+			unsigned int mId;				// Trace thread id
+		};
+
+		//! Registry of every thread which has recorded spans
+		struct TraceRegistry
+		{
+			std::mutex mMutex;
+			std::vector<TraceThread*> mThreads;
+			std::atomic<bool> mTracing;
+			size_t mCapacity;
+			std::chrono::steady_clock::time_point mEpoch;
+			std::thread::id mMainThread;
+
+			TraceRegistry() : mTracing(false), mCapacity(0), mEpoch(std::chrono::steady_clock::now()), mMainThread(std::this_thread::get_id()) {}
+			~TraceRegistry()
+			{
+				for ( size_t i=0; i<mThreads.size(); ++i ) delete mThreads[i];
+			}
+		};
+
+		TraceRegistry gRegistry;
+		thread_local TraceThread* tThread = 0;
+		thread_local const char* tThreadName = 0;
+
+		/** Gets the calling threads ring buffer, registering it if needed.
+		 */
+		TraceThread* _getTraceThread()
+		{
+			if ( tThread ) return tThread;
+
+			std::lock_guard<std::mutex> l(gRegistry.mMutex);
+			tThread = new TraceThread;
+			tThread->mSpans.resize(gRegistry.mCapacity);
+			tThread->mWritten = 0;
+			tThread->mName = tThreadName;
+			tThread->mId = static_cast<unsigned int>(gRegistry.mThreads.size()) + 1;
+			if ( !tThread->mName && std::this_thread::get_id()==gRegistry.mMainThread ) tThread->mName = "Main";
+			gRegistry.mThreads.push_back(tThread);
+			return tThread;
+		}
+
+		/** Writes a string as a JSON literal.
+		 */
+		void _writeJSONString(std::ofstream& out, const char* str)
+		{
+			out << '"';
+			for ( ; *str; ++str )
+			{
+				if ( *str=='"' || *str=='\\' ) out << '\\';
+				out << *str;
+			}
+			out << '"';
+		}
+	}
+
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundProfiler::startTrace(size_t spansPerThread)
+	{
+		if ( !spansPerThread ) return;
+
+		std::lock_guard<std::mutex> l(gRegistry.mMutex);
+
+		gRegistry.mCapacity = spansPerThread;
+		for ( size_t i=0; i<gRegistry.mThreads.size(); ++i )
+		{
+			TraceThread* t = gRegistry.mThreads[i];
+			std::lock_guard<std::mutex> tl(t->mMutex);
+			t->mSpans.assign(spansPerThread, TraceSpan());
+			t->mWritten = 0;
+		}
+		gRegistry.mTracing = true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundProfiler::stopTrace()
+	{
+		gRegistry.mTracing = false;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundProfiler::isTracing()
+	{
+		return gRegistry.mTracing.load(std::memory_order_relaxed);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundProfiler::setThreadName(const char* name)
+	{
+		tThreadName = name;
+		if ( tThread ) 
+		{
+			std::lock_guard<std::mutex> l(tThread->mMutex);
+			tThread->mName = name;
+		}
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	unsigned long long OgreOggSoundProfiler::_getTime()
+	{
+		return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gRegistry.mEpoch).count());
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundProfiler::_isMainThread()
+	{
+		return std::this_thread::get_id()==gRegistry.mMainThread;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggSoundProfiler::_recordSpan(const char* name, unsigned long long start, unsigned long long end)
+	{
+		if ( !isTracing() ) return;
+
+		TraceThread* t = _getTraceThread();
+
+		std::lock_guard<std::mutex> l(t->mMutex);
+		if ( t->mSpans.empty() ) return;
+
+		TraceSpan& span = t->mSpans[t->mWritten % t->mSpans.size()];
+		span.mName = name;
+		span.mStart = start;
+		span.mEnd = end;
+		++t->mWritten;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggSoundProfiler::writeChromeTrace(const Ogre::String& file)
+	{
+		std::ofstream out(file.c_str(), std::ios::out | std::ios::trunc);
+		if ( !out.is_open() )
+		{
+			Ogre::LogManager::getSingleton().logMessage("*** OgreOggSoundProfiler::writeChromeTrace() - Unable to open: " + file);
+			return false;
+		}
+
+		out << std::fixed << std::setprecision(3);
+		out << "{\"traceEvents\":[";
+
+		bool first = true;
+
+		std::lock_guard<std::mutex> l(gRegistry.mMutex);
+		for ( size_t i=0; i<gRegistry.mThreads.size(); ++i )
+		{
+			TraceThread* t = gRegistry.mThreads[i];
+			std::lock_guard<std::mutex> tl(t->mMutex);
+
+			// Thread name metadata
+			if ( t->mName )
+			{
+				out << (first ? "\n" : ",\n");
+				out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->mId << ",\"args\":{\"name\":";
+				_writeJSONString(out, t->mName);
+				out << "}}";
+				first = false;
+			}
+
+			// Oldest span first
+			size_t capacity = t->mSpans.size();
+			size_t count = t->mWritten<capacity ? t->mWritten : capacity;
+			for ( size_t s=t->mWritten-count; s<t->mWritten; ++s )
+			{
+				const TraceSpan& span = t->mSpans[s % capacity];
+				out << (first ? "\n" : ",\n");
+				out << "{\"name\":";
+				_writeJSONString(out, span.mName);
+				out << ",\"cat\":\"OgreOggSound\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->mId;
+				out << ",\"ts\":" << span.mStart / 1000.0 << ",\"dur\":" << (span.mEnd - span.mStart) / 1000.0 << "}";
+				first = false;
+			}
+		}
+
+		out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		return out.good();
+	}
+#if OGGSOUND_PROFILE
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggSoundProfileScope::OgreOggSoundProfileScope(const char* name) :
+	mName(name)
+	,mStart(0)
+	,mTracing(OgreOggSoundProfiler::isTracing())
+	,mOgreProfile(false)
+	{
+#if OGRE_PROFILING
+		// Ogre's profiler isn't thread safe
+		if ( Ogre::Profiler::getSingletonPtr() && OgreOggSoundProfiler::_isMainThread() )
+		{
+			Ogre::Profiler::getSingleton().beginProfile(mName);
+			mOgreProfile = true;
+		}
+#endif
+		if ( mTracing ) mStart = OgreOggSoundProfiler::_getTime();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggSoundProfileScope::~OgreOggSoundProfileScope()
+	{
+		if ( mTracing ) OgreOggSoundProfiler::_recordSpan(mName, mStart, OgreOggSoundProfiler::_getTime());
+#if OGRE_PROFILING
+		if ( mOgreProfile ) Ogre::Profiler::getSingleton().endProfile(mName);
+#endif
+	}
+#endif
+}
@@ -34,6 +34,8 @@
 #include <string>
 #include <iostream>
 #include "OgreOggSound.h"
+#include "OgreOggSoundAdpcm.h"
+#include "OgreOggSoundKernels.h"
 
 namespace OgreOggSound
 {
@@ -72,12 +74,19 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggStaticSound::_openImpl(Ogre::DataStreamPtr& fileStream)
 	{
+		OGGSOUND_PROFILE_SCOPE("OgreOggStaticSound::_openImpl");
+
 		// Store stream pointer
 		mAudioStream = fileStream;
 
 		// Store file name
 		mAudioName = mAudioStream->getName();
 
+		// Key may need to read the stream so get it before vorbis does
+		OgreOggSoundDecodeCache* cache = OgreOggSoundManager::getSingleton().getDecodeCache();
+		Ogre::String cacheKey;
+		if ( cache ) cacheKey = OgreOggSoundManager::getSingleton()._getDecodeCacheKey(mAudioName, mAudioStream);
+
 		if( ov_open_callbacks(&mAudioStream, &mOggStream, NULL, 0, mOggCallbacks) < 0 )
 		{
 			OGRE_EXCEPT(Ogre::Exception::ERR_FILE_NOT_FOUND, "Could not open Ogg stream.", "OgreOggStaticSound::_openImpl()");
@@ -101,20 +110,65 @@ namespace OgreOggSound
 		if (!_queryBufferInfo())
 			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "Format NOT supported!", "OgreOggStaticSound::_openImpl()");
 
+		// Float data is cached separately
+		if ( cache && mFloat ) cacheKey += "|f32";
+
 		alGenBuffers(1, &(*mBuffers)[0]);
 
-		char* data;
-		int sizeRead = 0;
-		int bitStream;
+		// Use previously decoded data if available
+		OgreOggMappedFile cached;
+		size_t sizeRead = 0;
+		const char* pcm = cache ? cache->find(cacheKey, mVorbisInfo->channels, mVorbisInfo->rate, cached, sizeRead) : 0;
 
-		data = OGRE_ALLOC_T(char, mBufferSize, Ogre::MEMCATEGORY_GENERAL);
-		do
+		if ( !pcm )
 		{
-			sizeRead = ov_read(&mOggStream, data, static_cast<int>(mBufferSize), 0, 2, 1, &bitStream);
-			mBufferData.insert(mBufferData.end(), data, data + sizeRead);
+			// Size buffer from the total sample count so decoding is a single pass,
+			// unseekable streams don't report a length so grow as required instead.
+			ogg_int64_t pcmTotal = ov_pcm_total(&mOggStream, -1);
+			if ( pcmTotal>0 )
+				mBufferData.resize(static_cast<size_t>(pcmTotal) * mVorbisInfo->channels * _getSampleSize());
+			else
+				mBufferData.resize(mBufferSize);
+
+			int bitStream;
+			bool decodeError = false;
+			const size_t frameSize = mVorbisInfo->channels * _getSampleSize();
+
+			for (;;)
+			{
+				// Only whole frames are decoded
+				if ( mBufferData.size() - sizeRead<frameSize )
+				{
+					if ( pcmTotal>0 ) break;
+					mBufferData.resize(mBufferData.size() + mBufferSize);
+				}
+
+				const int size = static_cast<int>(mBufferData.size() - sizeRead);
+				long bytes = mFloat ? 
+					_readFloat(mOggStream, &mBufferData[sizeRead], size, mVorbisInfo->channels, &bitStream) :
+					_readShort(mOggStream, &mBufferData[sizeRead], size, mVorbisInfo->channels, &bitStream);
+
+				// Finished
+				if ( bytes==0 ) break;
+
+				// Skip holes, give up on anything else
+				if ( bytes<0 )
+				{
+					if ( bytes==OV_HOLE ) continue;
+					Ogre::LogManager::getSingleton().logMessage("*** OgreOggStaticSound::_openImpl() - ERROR decoding: "+mAudioName);
+					decodeError = true;
+					break;
+				}
+
+				sizeRead += bytes;
+			}
+
+			pcm = mBufferData.empty() ? 0 : &mBufferData[0];
+
+			// Keep for next time
+			if ( cache && !decodeError ) 
+				cache->store(cacheKey, mVorbisInfo->channels, mVorbisInfo->rate, pcm, sizeRead);
 		}
-		while(sizeRead > 0);
-		OGRE_FREE(data, Ogre::MEMCATEGORY_GENERAL);
 
 #if HAVE_EFX
 		// Upload to XRAM buffers if available
@@ -123,13 +177,25 @@ namespace OgreOggSound
 #endif
 
 		alGetError();
-		alBufferData((*mBuffers)[0], mFormat, &mBufferData[0], static_cast<ALsizei>(mBufferData.size()), mVorbisInfo->rate);
+		if ( !OgreOggSoundManager::getSingleton()._bufferCompressed((*mBuffers)[0], pcm, sizeRead, mVorbisInfo->channels, mVorbisInfo->rate, mFormat) )
+			alBufferData((*mBuffers)[0], mFormat, pcm, static_cast<ALsizei>(sizeRead), mVorbisInfo->rate);
 		if ( alGetError()!=AL_NO_ERROR )
 		{
 			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "Unable to load audio data into buffer.", "OgreOggStaticSound::_openImpl()");
 			return;
 		}
 
+		// OpenAL has its own copy now
+		if ( OgreOggSoundManager::getSingleton().getKeepStaticAudioData() )
+		{
+			if ( cached.isOpen() ) 
+				mBufferData.assign(pcm, pcm + sizeRead);
+			else
+				mBufferData.resize(sizeRead);
+		}
+		else
+			std::vector<char>().swap(mBufferData);
+
 		// Register shared buffer
 		OgreOggSoundManager::getSingleton()._registerSharedBuffer(mAudioName, (*mBuffers)[0], this);
 
@@ -173,7 +239,7 @@ namespace OgreOggSound
 	{
 		if ( !mInitialised ) return false;
 
-		return ( (mFormat==AL_FORMAT_MONO16) || (mFormat==AL_FORMAT_MONO8) );
+		return ( (mFormat==AL_FORMAT_MONO16) || (mFormat==AL_FORMAT_MONO8) || (mFormat==AL_FORMAT_MONO_IMA4) || (mFormat==AL_FORMAT_MONO_FLOAT32) );
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	bool OgreOggStaticSound::_queryBufferInfo()
@@ -255,6 +321,14 @@ namespace OgreOggSound
 			mBufferSize -= (mBufferSize % 2);
 			break;
 		}
+
+		// Decode to float instead if possible, ADPCM is encoded from 16-bit data
+		OgreOggSoundManager& mgr = OgreOggSoundManager::getSingleton();
+		mFloat = !( mgr.getStaticAudioCompression() && mgr.hasIma4Support() ) && mgr._getFloatFormat(mVorbisInfo->channels, mFormat);
+
+		// Same duration at twice the sample size
+		if ( mFloat ) mBufferSize *= 2;
+
 		return true;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
@@ -295,6 +369,8 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		if ( _pauseVirtual() ) return;
+
 		if ( mSource==AL_NONE ) return;
 
 		alSourcePause(mSource);
@@ -309,17 +385,27 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		// Already playing without a source
+		if ( mVirtual ) return;
+
 		if(isPlaying())
 			return;
 
 		if (mSource == AL_NONE)
 			if ( !OgreOggSoundManager::getSingleton()._requestSoundSource(this) )
+			{
+				// Carry on without a source if allowed
+				_playVirtual();
 				return;
+			}
 
 		// Pick up playback position change..
 		if ( mPlayPosChanged )
 			setPlayPosition(mPlayPos);
 
+		// Submit pending properties before starting
+		_flushState();
+
 		alSourcePlay(mSource);
 		mState = SS_PLAYING;
 
@@ -332,6 +418,8 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		if ( _stopVirtual() ) return;
+
 		if ( mSource==AL_NONE || isStopped() ) return;
 
 		alSourceStop(mSource);
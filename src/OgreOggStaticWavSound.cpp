@@ -31,9 +31,13 @@
 */
 
 #include "OgreOggStaticWavSound.h"
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include "OgreOggSoundManager.h"
+#include "OgreOggMappedFile.h"
+#include "OgreOggSoundAdpcm.h"
+#include "OgreOggSoundKernels.h"
 
 namespace OgreOggSound
 {
@@ -71,9 +75,9 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void	OgreOggStaticWavSound::_openImpl(Ogre::DataStreamPtr& fileStream)
 	{
+		OGGSOUND_PROFILE_SCOPE("OgreOggStaticWavSound::_openImpl");
+
 		// WAVE descriptor vars
-		char*			sound_buffer=0;
-		int				bytesRead=0;
 		ChunkHeader		c;
 
 		// Store stream pointer
@@ -100,11 +104,11 @@ namespace OgreOggSound
 					// SmFormatData.mFormat->uld be 16 unless compressed ( compressed NOT supported )
 					if ( mFormatData.mFormat->mHeaderSize>=16 )
 					{
-						// PCM == 1
-						if (mFormatData.mFormat->mFormatTag==0x0001 || mFormatData.mFormat->mFormatTag==0xFFFE)
+						// PCM == 1, MS ADPCM == 2, IMA ADPCM == 0x11
+						if (mFormatData.mFormat->mFormatTag==0x0001 || mFormatData.mFormat->mFormatTag==0xFFFE || _isAdpcm())
 						{
 							// Samples check..
-							if ( (mFormatData.mFormat->mBitsPerSample!=16) && (mFormatData.mFormat->mBitsPerSample!=8) )
+							if ( !_isAdpcm() && (mFormatData.mFormat->mBitsPerSample!=16) && (mFormatData.mFormat->mBitsPerSample!=8) )
 							{
 								OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "BitsPerSample NOT 8/16!", "OgreOggStaticWavSound::_openImpl()");
 							}
@@ -119,6 +123,15 @@ namespace OgreOggSound
 								extraBytes-=static_cast<unsigned int>(mAudioStream->read(&mFormatData.mChannelMask, 2));
 								extraBytes-=static_cast<unsigned int>(mAudioStream->read(&mFormatData.mSubFormat, 16));
 							}
+							// ADPCM block size follows cbSize
+							else if (_isAdpcm())
+							{
+								unsigned short cbSize=0;
+								if ( extraBytes<4 )
+									OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "ADPCM wav has no samples per block!", "OgreOggStaticWavSound::_openImpl()");
+								extraBytes-=static_cast<unsigned int>(mAudioStream->read(&cbSize, 2));
+								extraBytes-=static_cast<unsigned int>(mAudioStream->read(&mFormatData.mSamples, 2));
+							}
 		
 							// Skip
 							mAudioStream->skip(extraBytes);
@@ -140,13 +153,7 @@ namespace OgreOggSound
 									// Store end pos
 									mAudioEnd = mAudioOffset+(c.length-fileCheck);
 
-									// Allocate array
-									sound_buffer = OGRE_ALLOC_T(char, mAudioEnd-mAudioOffset, Ogre::MEMCATEGORY_GENERAL);
-
-									// Read entire sound data
-									bytesRead = static_cast<int>(mAudioStream->read(sound_buffer, mAudioEnd-mAudioOffset));
-
-									// Jump out
+									// Jump out, data is read by _uploadAudioData()
 									break;
 								}
 								// Unsupported chunk...
@@ -201,16 +208,18 @@ namespace OgreOggSound
 			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "Format NOT supported.", "OgreOggStaticWavSound::_openImpl()");
 
 		// Calculate length in seconds
-		mPlayTime = static_cast<float>(((mAudioEnd-mAudioOffset)*8.f) / static_cast<float>((mFormatData.mFormat->mSamplesPerSec * mFormatData.mFormat->mChannels * mFormatData.mFormat->mBitsPerSample)));
+		if ( _isAdpcm() )
+			mPlayTime = static_cast<float>(((mAudioEnd-mAudioOffset) / mFormatData.mFormat->mBlockAlign) * mFormatData.mSamples) / static_cast<float>(mFormatData.mFormat->mSamplesPerSec);
+		else
+			mPlayTime = static_cast<float>(((mAudioEnd-mAudioOffset)*8.f) / static_cast<float>((mFormatData.mFormat->mSamplesPerSec * mFormatData.mFormat->mChannels * mFormatData.mFormat->mBitsPerSample)));
 
 		alGetError();
-		alBufferData((*mBuffers)[0], mFormat, sound_buffer, static_cast<ALsizei>(bytesRead), mFormatData.mFormat->mSamplesPerSec);
+		_uploadAudioData();
 		if ( alGetError()!=AL_NO_ERROR )
 		{
 			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "Unable to load audio data into buffer!", "OgreOggStaticWavSound::_openImpl()");
 			return;
 		}
-		OGRE_FREE(sound_buffer, Ogre::MEMCATEGORY_GENERAL);
 
 		// Register shared buffer
 		OgreOggSoundManager::getSingleton()._registerSharedBuffer(mAudioName, (*mBuffers)[0], this);
@@ -218,6 +227,75 @@ namespace OgreOggSound
 		// Notify listener
 		if ( mSoundListener ) mSoundListener->soundLoaded(this);
 	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void	OgreOggStaticWavSound::_uploadAudioData()
+	{
+		OgreOggSoundManager& mgr = OgreOggSoundManager::getSingleton();
+		const size_t size = mAudioEnd-mAudioOffset;
+		const ALsizei freq = static_cast<ALsizei>(mFormatData.mFormat->mSamplesPerSec);
+		const int channels = mFormatData.mFormat->mChannels;
+
+		// PCM may be re-encoded, which needs all of it at once
+		const bool encode = !_isAdpcm() && 
+			mgr.getStaticAudioCompression() && mgr.hasIma4Support() && channels<=2;
+
+		// ADPCM block size
+		if ( _isAdpcm() && mgr.hasBlockAlignmentSupport() )
+			alBufferi((*mBuffers)[0], AL_UNPACK_BLOCK_ALIGNMENT_SOFT, mFormatData.mSamples);
+
+		// Files on disk are handed to OpenAL straight from the page cache
+		Ogre::String path;
+		OgreOggMappedFile file;
+		if ( mgr._getResourcePath(mAudioName, path) && file.open(path) && file.getSize()>=mAudioEnd )
+		{
+			if ( !encode || !_uploadCompressed(file.getData()+mAudioOffset, size) )
+				alBufferData((*mBuffers)[0], mFormat, file.getData()+mAudioOffset, static_cast<ALsizei>(size), freq);
+			return;
+		}
+
+		// Otherwise fill the buffer a block at a time
+		if ( mgr.hasBufferSubData() && !encode && !_isAdpcm() )
+		{
+			alBufferData((*mBuffers)[0], mFormat, 0, static_cast<ALsizei>(size), freq);
+
+			const size_t blockAlign = mFormatData.mFormat->mBlockAlign;
+			std::vector<char> block(std::min(size, (WAV_UPLOAD_BLOCK / blockAlign) * blockAlign));
+			size_t offset = 0;
+			while ( offset<size )
+			{
+				size_t bytes = mAudioStream->read(&block[0], std::min(block.size(), size-offset));
+				bytes -= bytes % blockAlign;
+				if ( !bytes ) break;
+
+				mgr._bufferSubData((*mBuffers)[0], mFormat, &block[0], static_cast<ALsizei>(offset), static_cast<ALsizei>(bytes));
+				offset += bytes;
+			}
+			return;
+		}
+
+		// Read entire sound data
+		char* sound_buffer = OGRE_ALLOC_T(char, size, Ogre::MEMCATEGORY_GENERAL);
+		size_t bytesRead = mAudioStream->read(sound_buffer, size);
+		if ( !encode || !_uploadCompressed(sound_buffer, bytesRead) )
+			alBufferData((*mBuffers)[0], mFormat, sound_buffer, static_cast<ALsizei>(bytesRead), freq);
+		OGRE_FREE(sound_buffer, Ogre::MEMCATEGORY_GENERAL);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool	OgreOggStaticWavSound::_uploadCompressed(const char* data, size_t size)
+	{
+		OgreOggSoundManager& mgr = OgreOggSoundManager::getSingleton();
+		const ALsizei freq = static_cast<ALsizei>(mFormatData.mFormat->mSamplesPerSec);
+		const int channels = mFormatData.mFormat->mChannels;
+
+		if ( mFormatData.mFormat->mBitsPerSample!=8 )
+			return mgr._bufferCompressed((*mBuffers)[0], data, size, channels, freq, mFormat);
+
+		if ( !size ) return false;
+
+		std::vector<short> pcm(size);
+		OgreOggSoundKernels::convert8To16(reinterpret_cast<const unsigned char*>(data), size, &pcm[0]);
+		return mgr._bufferCompressed((*mBuffers)[0], reinterpret_cast<const char*>(&pcm[0]), size * sizeof(short), channels, freq, mFormat);
+	}
 	/*/////////////////////////////////////////////////////////////////*/	  
 	void	OgreOggStaticWavSound::_openImpl(const Ogre::String& fName, sharedAudioBuffer* buffer)
 	{
@@ -237,13 +315,46 @@ namespace OgreOggSound
 	{
 		if ( !mInitialised ) return false;
 
-		return ( (mFormat==AL_FORMAT_MONO16) || (mFormat==AL_FORMAT_MONO8) );
+		return ( (mFormat==AL_FORMAT_MONO16) || (mFormat==AL_FORMAT_MONO8) || (mFormat==AL_FORMAT_MONO_IMA4) || (mFormat==AL_FORMAT_MONO_MSADPCM_SOFT) );
 	}					   
 	/*/////////////////////////////////////////////////////////////////*/
 	bool	OgreOggStaticWavSound::_queryBufferInfo()
 	{
 		if ( !mFormatData.mFormat ) return false;
 
+		// ADPCM is passed straight through if the device can play it
+		if ( _isAdpcm() )
+		{
+			OgreOggSoundManager& mgr = OgreOggSoundManager::getSingleton();
+			const bool ima = mFormatData.mFormat->mFormatTag==0x0011;
+			const bool mono = mFormatData.mFormat->mChannels==1;
+
+			if ( ima ? !mgr.hasIma4Support() : !mgr.hasMsAdpcmSupport() )
+			{
+				Ogre::LogManager::getSingleton().logMessage(ima ? "*** --- IMA ADPCM wav needs AL_EXT_IMA4" : "*** --- MS ADPCM wav needs AL_SOFT_MSADPCM");
+				return false;
+			}
+			if ( mFormatData.mFormat->mChannels>2 )
+			{
+				Ogre::LogManager::getSingleton().logMessage("*** --- ADPCM wav must be mono or stereo");
+				return false;
+			}
+			if ( mFormatData.mSamples!=(ima ? IMA4_DEFAULT_BLOCK_SAMPLES : MSADPCM_DEFAULT_BLOCK_SAMPLES) && !mgr.hasBlockAlignmentSupport() )
+			{
+				Ogre::LogManager::getSingleton().logMessage("*** --- ADPCM wav block size needs AL_SOFT_block_alignment");
+				return false;
+			}
+
+			if ( ima )
+				mFormat = mono ? AL_FORMAT_MONO_IMA4 : AL_FORMAT_STEREO_IMA4;
+			else
+				mFormat = mono ? AL_FORMAT_MONO_MSADPCM_SOFT : AL_FORMAT_STEREO_MSADPCM_SOFT;
+
+			// Whole blocks only
+			mBufferSize = mFormatData.mFormat->mBlockAlign;
+			return true;
+		}
+
 		switch(mFormatData.mFormat->mChannels)
 		{
 		case 1:
@@ -420,6 +531,8 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		if ( _pauseVirtual() ) return;
+
 		if ( mSource==AL_NONE ) return;
 
 		alSourcePause(mSource);
@@ -433,17 +546,27 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		// Already playing without a source
+		if ( mVirtual ) return;
+
 		if(isPlaying())
 			return;
 
 		if (mSource == AL_NONE)
 			if ( !OgreOggSoundManager::getSingleton()._requestSoundSource(this) )
+			{
+				// Carry on without a source if allowed
+				_playVirtual();
 				return;
+			}
 
 		// Pick up position change
 		if ( mPlayPosChanged )
 			setPlayPosition(mPlayPos);
 
+		// Submit pending properties before starting
+		_flushState();
+
 		alSourcePlay(mSource);
 		mState = SS_PLAYING;
 
@@ -455,6 +578,8 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		if ( _stopVirtual() ) return;
+
 		if ( mSource==AL_NONE ) return;
 
 		alSourceStop(mSource);
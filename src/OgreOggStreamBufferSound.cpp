@@ -154,6 +154,9 @@ namespace OgreOggSound
 			if ( !OgreOggSoundManager::getSingleton()._requestSoundSource(this) )
 				return;
 
+		// Submit pending properties before starting
+		_flushState();
+
 		alSourcePlay(mSource);
 		mState = SS_PLAYING;
 
@@ -186,6 +189,13 @@ namespace OgreOggSound
 			OgreOggSoundManager::getSingleton()._releaseSoundSource(this);
 	}
 	/*/////////////////////////////////////////////////////////////////*/
+	float OgreOggStreamBufferSound::_getRefillDeadline() const
+	{
+		if ( !isPlaying() ) return OgreOggISound::_getRefillDeadline();
+
+		return 0.01f;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggStreamBufferSound::_updateAudioBuffers()
 	{
 		// do nothing when not playing
@@ -0,0 +1,320 @@
+/**
+* @file OgreOggStreamDecoder.cpp
+* @author  Ian Stangoe
+* @version v1.26
+*
+* @section LICENSE
+* 
+* This source file is part of OgreOggSound, an OpenAL wrapper library for   
+* use with the Ogre Rendering Engine.										 
+*                                                                           
+* Copyright (c) 2013 Ian Stangoe
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.  
+*
+*/
+
+#include "OgreOggStreamDecoder.h"
+#include <algorithm>
+#include "OgreOggSoundManager.h"
+#include "OgreOggStreamSound.h"
+
+#if OGGSOUND_THREADED && defined(POCO_THREAD)
+#	include "Poco/Environment.h"
+#endif
+
+// Longest a decode thread sleeps without being woken (ms)
+#define DECODE_IDLE_TIME 50
+
+namespace OgreOggSound
+{
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggStreamDecoder::OgreOggStreamDecoder(unsigned int numThreads) :
+		mNumThreads(0)
+		,mNextQueue(0)
+		,mPendingJobs(0)
+		,mJobsRun(0)
+		,mJobsStolen(0)
+#if OGGSOUND_THREADED
+		,mShuttingDown(false)
+#endif
+	{
+#if OGGSOUND_THREADED
+		if ( numThreads==0 )
+		{
+#	ifdef POCO_THREAD
+			numThreads = Poco::Environment::processorCount();
+#	else
+			numThreads = boost::thread::hardware_concurrency();
+#	endif
+			if ( numThreads==0 ) numThreads = 1;
+		}
+
+		mNumThreads = numThreads;
+
+		for ( unsigned int i=0; i<mNumThreads; ++i )
+			mQueues.push_back(OGRE_NEW_T(WorkQueue, Ogre::MEMCATEGORY_GENERAL)());
+
+#	ifdef POCO_THREAD
+		for ( unsigned int i=0; i<mNumThreads; ++i )
+		{
+			Worker* w = OGRE_NEW_T(Worker, Ogre::MEMCATEGORY_GENERAL)(this, i);
+			Poco::Thread* t = OGRE_NEW_T(Poco::Thread, Ogre::MEMCATEGORY_GENERAL)();
+			t->start(*w);
+			mWorkers.push_back(w);
+			mThreads.push_back(t);
+		}
+#	else
+		for ( unsigned int i=0; i<mNumThreads; ++i )
+			mThreads.push_back(OGRE_NEW_T(boost::thread, Ogre::MEMCATEGORY_GENERAL)(&OgreOggStreamDecoder::_workerLoop, this, static_cast<size_t>(i)));
+#	endif
+
+		Ogre::LogManager::getSingleton().logMessage("*** --- Stream decoding with " + Ogre::StringConverter::toString(mNumThreads) + " thread(s)", Ogre::LML_NORMAL);
+#else
+		// Single queue serviced by update()
+		mQueues.push_back(OGRE_NEW_T(WorkQueue, Ogre::MEMCATEGORY_GENERAL)());
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	OgreOggStreamDecoder::~OgreOggStreamDecoder()
+	{
+#if OGGSOUND_THREADED
+		mShuttingDown = true;
+
+#	ifdef POCO_THREAD
+		for ( unsigned int i=0; i<mThreads.size(); ++i )
+			mWakeEvent.set();
+		for ( std::vector<Poco::Thread*>::iterator i=mThreads.begin(); i!=mThreads.end(); ++i )
+		{
+			(*i)->join();
+			OGRE_DELETE_T((*i), Thread, Ogre::MEMCATEGORY_GENERAL);
+		}
+		for ( std::vector<Worker*>::iterator i=mWorkers.begin(); i!=mWorkers.end(); ++i )
+			OGRE_DELETE_T((*i), Worker, Ogre::MEMCATEGORY_GENERAL);
+		mWorkers.clear();
+#	else
+		{
+			boost::mutex::scoped_lock l(mWakeMutex);
+		}
+		mWakeCondition.notify_all();
+		for ( std::vector<boost::thread*>::iterator i=mThreads.begin(); i!=mThreads.end(); ++i )
+		{
+			(*i)->join();
+			OGRE_DELETE_T((*i), thread, Ogre::MEMCATEGORY_GENERAL);
+		}
+#	endif
+		mThreads.clear();
+
+		Ogre::LogManager::getSingleton().logMessage("*** --- Stream decoding ran " + Ogre::StringConverter::toString(static_cast<unsigned long>(mJobsRun)) + 
+			" jobs, " + Ogre::StringConverter::toString(static_cast<unsigned long>(mJobsStolen)) + " stolen", Ogre::LML_NORMAL);
+#endif
+
+		// Streams left queued are simply forgotten
+		for ( std::vector<WorkQueue*>::iterator i=mQueues.begin(); i!=mQueues.end(); ++i )
+			OGRE_DELETE_T((*i), WorkQueue, Ogre::MEMCATEGORY_GENERAL);
+		mQueues.clear();
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggStreamDecoder::add(OgreOggStreamSound* sound)
+	{
+		sound->mDecodeRemoved = false;
+		sound->mDecodeState = DS_IDLE;
+
+		wake(sound);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggStreamDecoder::remove(OgreOggStreamSound* sound)
+	{
+		// Stops the stream being queued again
+		sound->mDecodeRemoved = true;
+
+		for ( std::vector<WorkQueue*>::iterator i=mQueues.begin(); i!=mQueues.end(); ++i )
+		{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+			Poco::Mutex::ScopedLock l((*i)->mMutex);
+#	else
+			boost::mutex::scoped_lock l((*i)->mMutex);
+#	endif
+#endif
+			std::deque<OgreOggStreamSound*>::iterator j = std::find((*i)->mJobs.begin(), (*i)->mJobs.end(), sound);
+			if ( j!=(*i)->mJobs.end() )
+			{
+				// Only ever queued once
+				(*i)->mJobs.erase(j);
+				--mPendingJobs;
+				sound->mDecodeState = DS_IDLE;
+				return;
+			}
+		}
+
+#if OGGSOUND_THREADED
+		// Being decoded, wait for it to be let go
+		while ( sound->mDecodeState!=DS_IDLE )
+		{
+#	ifdef POCO_THREAD
+			Poco::Thread::yield();
+#	else
+			boost::this_thread::yield();
+#	endif
+		}
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggStreamDecoder::wake(OgreOggStreamSound* sound)
+	{
+		int state = sound->mDecodeState;
+		while ( true )
+		{
+			// Already running, make sure it runs again
+			if ( state==DS_RESCHEDULE ) return;
+			if ( state==DS_SCHEDULED )
+			{
+				if ( sound->mDecodeState.compare_exchange_weak(state, DS_RESCHEDULE) ) return;
+				continue;
+			}
+			if ( sound->mDecodeState.compare_exchange_weak(state, DS_SCHEDULED) ) break;
+		}
+
+		// Spread woken streams across threads
+		_push(sound, mNextQueue++ % mQueues.size());
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggStreamDecoder::update()
+	{
+#if OGGSOUND_THREADED == 0
+		OgreOggStreamSound* sound=0;
+		while ( _pop(0, sound) ) 
+			_run(sound, 0);
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggStreamDecoder::_push(OgreOggStreamSound* sound, size_t queue)
+	{
+		{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+			Poco::Mutex::ScopedLock l(mQueues[queue]->mMutex);
+#	else
+			boost::mutex::scoped_lock l(mQueues[queue]->mMutex);
+#	endif
+#endif
+			// Checked under the lock so remove() either sees the job or it isn't added
+			if ( !sound->mDecodeRemoved )
+			{
+				mQueues[queue]->mJobs.push_back(sound);
+				++mPendingJobs;
+			}
+			else
+			{
+				// Last access, remove() may be waiting on this
+				sound->mDecodeState = DS_IDLE;
+				return;
+			}
+		}
+
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		mWakeEvent.set();
+#	else
+		{
+			boost::mutex::scoped_lock l(mWakeMutex);
+		}
+		mWakeCondition.notify_one();
+#	endif
+#endif
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggStreamDecoder::_pop(size_t queue, OgreOggStreamSound*& sound)
+	{
+		for ( size_t i=0; i<mQueues.size(); ++i )
+		{
+			const size_t index = (queue + i) % mQueues.size();
+			WorkQueue* q = mQueues[index];
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+			Poco::Mutex::ScopedLock l(q->mMutex);
+#	else
+			boost::mutex::scoped_lock l(q->mMutex);
+#	endif
+#endif
+			if ( q->mJobs.empty() ) continue;
+
+			// Own work oldest first, steal the newest
+			if ( index==queue )
+			{
+				sound = q->mJobs.front();
+				q->mJobs.pop_front();
+			}
+			else
+			{
+				sound = q->mJobs.back();
+				q->mJobs.pop_back();
+				++mJobsStolen;
+			}
+			--mPendingJobs;
+			return true;
+		}
+
+		return false;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggStreamDecoder::_run(OgreOggStreamSound* sound, size_t queue)
+	{
+		const bool more = sound->_decodeAhead();
+		++mJobsRun;
+
+		// Keep going whilst there's room in the ring
+		if ( !more )
+		{
+			int state = DS_SCHEDULED;
+			if ( sound->mDecodeState.compare_exchange_strong(state, DS_IDLE) ) return;
+		}
+
+		// Woken during the decode or still room
+		sound->mDecodeState = DS_SCHEDULED;
+		_push(sound, queue);
+	}
+#if OGGSOUND_THREADED
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggStreamDecoder::_workerLoop(size_t queue)
+	{
+		OGGSOUND_PROFILE_THREAD("OgreOggSound decoder");
+
+		while ( !mShuttingDown )
+		{
+			OgreOggStreamSound* sound=0;
+			if ( _pop(queue, sound) ) 
+			{
+				_run(sound, queue);
+				continue;
+			}
+
+			// Nothing anywhere, wait for a stream to be woken
+#	ifdef POCO_THREAD
+			mWakeEvent.tryWait(DECODE_IDLE_TIME);
+#	else
+			boost::mutex::scoped_lock l(mWakeMutex);
+			if ( mPendingJobs==0 && !mShuttingDown ) 
+				mWakeCondition.timed_wait(l, boost::posix_time::milliseconds(DECODE_IDLE_TIME));
+#	endif
+		}
+	}
+#endif
+}
@@ -31,9 +31,15 @@
 */
 
 #include "OgreOggStreamSound.h"
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include "OgreOggSoundManager.h"
+#include "OgreOggSoundKernels.h"
+#include "OgreOggStreamDecoder.h"
+
+// Largest block decoded ahead in one go (bytes)
+#define DECODE_AHEAD_BLOCK 16384
 
 namespace OgreOggSound
 {
@@ -53,9 +59,13 @@ namespace OgreOggSound
 	,mVorbisComment(0)
 	,mStreamEOF(false)
 	,mLastOffset(0.f)
+	,mDecodeRing(0)
+	,mDecodeEOF(false)
+	,mDecodeState(DS_IDLE)
+	,mDecodeRemoved(false)
 	{
 		mStream=true;															
-		mBuffers.bind(new BufferList(NUM_BUFFERS, AL_NONE));
+		mBuffers.bind(new BufferList());
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	OgreOggStreamSound::~OgreOggStreamSound()
@@ -70,6 +80,8 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggStreamSound::_openImpl(Ogre::DataStreamPtr& fileStream)
 	{
+		OGGSOUND_PROFILE_SCOPE("OgreOggStreamSound::_openImpl");
+
 		// Store stream pointer
 		mAudioStream = fileStream;
 
@@ -93,18 +105,16 @@ namespace OgreOggSound
 		mPlayTime = static_cast<float>(ov_time_total(&mOggStream, -1));
 
 		// Generate audio buffers
-		alGenBuffers(NUM_BUFFERS, &(*mBuffers)[0]);
+		if (!_resizeStreamBuffers())
+			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "Unable to create OpenAL buffers.", "OgreOggStreamSound::_openImpl()");
+
+		// Decode to float if possible, fixed whilst open as decoded audio may be queued
+		mFloat = OgreOggSoundManager::getSingleton()._getFloatFormat(mVorbisInfo->channels, mFormat);
 
 			// Check format support
 		if (!_queryBufferInfo())			
 			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "Format NOT supported!", "OgreOggStreamSound::_openImpl()");
 
-#if HAVE_EFX
-		// Upload to XRAM buffers if available
-		if ( OgreOggSoundManager::getSingleton().hasXRamSupport() )
-			OgreOggSoundManager::getSingleton().setXRamBuffer(NUM_BUFFERS, &(*mBuffers)[0]);
-#endif
-
 		// In case loop point set BEFORE loaded re-check here
 		if ( mLoopOffset>0.f )
 		{
@@ -114,6 +124,21 @@ namespace OgreOggSound
 				mLoopOffset=0.f;
 			}
 		}
+
+		// Decode ahead of the buffer queue if requested
+		float decodeAhead = OgreOggSoundManager::getSingleton().getStreamDecodeAhead();
+		OgreOggStreamDecoder* decoder = OgreOggSoundManager::getSingleton()._getStreamDecoder();
+		if ( decodeAhead>0.f && decoder && !mDecodeRing )
+		{
+			size_t bytes = static_cast<size_t>(decodeAhead * mVorbisInfo->rate) * mVorbisInfo->channels * _getSampleSize();
+
+			// Ring rounds up to a power of two, round down here so it never grows past the request
+			size_t ringSize = DECODE_AHEAD_BLOCK * 2;
+			while ( ringSize * 2<=bytes ) ringSize *= 2;
+			mDecodeRing = OGRE_NEW_T(LocklessQueue<char>, Ogre::MEMCATEGORY_GENERAL)(ringSize);
+			mDecodeEOF = false;
+			decoder->add(this);
+		}
 		
 		// Notify listener
 		if ( mSoundListener ) mSoundListener->soundLoaded(this);
@@ -123,11 +148,20 @@ namespace OgreOggSound
 	{
 		ALuint src=AL_NONE;
 		setSource(src);
-		for (int i=0; i<NUM_BUFFERS; i++)
+		for (size_t i=0; i<mBuffers->size(); i++)
 		{										   
 			if ((*mBuffers)[i]!=AL_NONE)
 				alDeleteBuffers(1, &(*mBuffers)[i]);
 		}
+		mBuffers->clear();
+		if ( mDecodeRing )
+		{
+			// Wait for decoder to let go first
+			if ( OgreOggStreamDecoder* decoder = OgreOggSoundManager::getSingleton()._getStreamDecoder() ) 
+				decoder->remove(this);
+			OGRE_DELETE_T(mDecodeRing, LocklessQueue, Ogre::MEMCATEGORY_GENERAL);
+			mDecodeRing = 0;
+		}
 		if ( !mAudioStream.isNull() ) ov_clear(&mOggStream);
 		mPlayPosChanged = false;
 		mPlayPos = 0.f;
@@ -152,7 +186,7 @@ namespace OgreOggSound
 	{
 		if ( !mInitialised ) return false;
 
-		return ( (mFormat==AL_FORMAT_MONO16) || (mFormat==AL_FORMAT_MONO8) );
+		return ( (mFormat==AL_FORMAT_MONO16) || (mFormat==AL_FORMAT_MONO8) || (mFormat==AL_FORMAT_MONO_FLOAT32) );
 	}					  
 	/*/////////////////////////////////////////////////////////////////*/
 	bool OgreOggStreamSound::_queryBufferInfo()
@@ -163,64 +197,43 @@ namespace OgreOggSound
 			return false;
 		}
 
+		// Chosen on opening
+		const ALenum floatFormat = mFormat;
+
 		switch(mVorbisInfo->channels)
 		{
 		case 1:
 			{
 				mFormat = AL_FORMAT_MONO16;
-				// Set BufferSize to 250ms (Frequency * 2 (16bit) divided by 4 (quarter of a second))
-				mBufferSize = mVorbisInfo->rate >> 1;
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % 2);
 			}
 			break;
 		case 2:
 			{
 				mFormat = AL_FORMAT_STEREO16;
-				// Set BufferSize to 250ms (Frequency * 4 (16bit stereo) divided by 4 (quarter of a second))
-				mBufferSize = mVorbisInfo->rate;
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % 4);
 			}
 			break;
 		case 4:
 			{
 				mFormat = alGetEnumValue("AL_FORMAT_QUAD16");
 				if (!mFormat) return false;
-				// Set BufferSize to 250ms (Frequency * 8 (16bit 4-channel) divided by 4 (quarter of a second))
-				mBufferSize = mVorbisInfo->rate * 2;
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % 8);
 			}
 			break;
 		case 6:
 			{
 				mFormat = alGetEnumValue("AL_FORMAT_51CHN16");
 				if (!mFormat) return false;
-				// Set BufferSize to 250ms (Frequency * 12 (16bit 6-channel) divided by 4 (quarter of a second))
-				mBufferSize = mVorbisInfo->rate * 3;
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % 12);
 			}
 			break;
 		case 7:
 			{
 				mFormat = alGetEnumValue("AL_FORMAT_61CHN16");
 				if (!mFormat) return false;
-				// Set BufferSize to 250ms (Frequency * 16 (16bit 7-channel) divided by 4 (quarter of a second))
-				mBufferSize = mVorbisInfo->rate * 4;
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % 16);
 			}
 			break;
 		case 8:
 			{
 				mFormat = alGetEnumValue("AL_FORMAT_71CHN16");
 				if (!mFormat) return false;
-				// Set BufferSize to 250ms (Frequency * 20 (16bit 8-channel) divided by 4 (quarter of a second))
-				mBufferSize = mVorbisInfo->rate * 5;
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % 20);
 			}
 			break;
 		default:
@@ -228,12 +241,15 @@ namespace OgreOggSound
 			Ogre::LogManager::getSingleton().logMessage("!!WARNING!! Could not determine buffer format!  Defaulting to MONO");
 
 			mFormat = AL_FORMAT_MONO16;
-			// Set BufferSize to 250ms (Frequency * 2 (16bit) divided by 4 (quarter of a second))
-			mBufferSize = mVorbisInfo->rate >> 1;
-			// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-			mBufferSize -= (mBufferSize % 2);
 			break;
 		}
+
+		if ( mFloat ) mFormat = floatFormat;
+
+		// Queue audio in chunks of the requested duration
+		unsigned int blockAlign = mVorbisInfo->channels * _getSampleSize();
+		_calculateBufferSize(mVorbisInfo->rate * blockAlign, blockAlign);
+
 		return true;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
@@ -241,8 +257,12 @@ namespace OgreOggSound
 	{
 		if (mSource==AL_NONE) return;
 
-		int i=0;
-		while ( i<NUM_BUFFERS )
+		// Pick up buffer count/duration changes whilst nothing is queued
+		if ( mBufferTime!=mStreamBufferTime ) _queryBufferInfo();
+		_resizeStreamBuffers();
+
+		size_t i=0;
+		while ( i<mBuffers->size() )
 		{															   
 			if ( _stream((*mBuffers)[i]) )
 				alSourceQueueBuffers(mSource, 1, &(*mBuffers)[i++]);
@@ -301,6 +321,11 @@ namespace OgreOggSound
 			}
 			else
 			{
+				// Starved - record it and deepen the queue if adaptive
+				++mUnderruns;
+				OgreOggSoundManager::getSingleton()._notifyStreamUnderrun();
+				_adaptStreamBuffers(true);
+
 				// Clear audio data already played...
 				_dequeue();
 
@@ -316,6 +341,20 @@ namespace OgreOggSound
 
 		alGetSourcei(mSource, AL_BUFFERS_PROCESSED, &processed);
 
+		if ( processed>0 )
+		{
+			// Pick up buffer duration changes
+			if ( mBufferTime!=mStreamBufferTime ) _queryBufferInfo();
+
+			// Measure how early the refill is
+			if ( mAdaptiveStreamBuffers )
+			{
+				int queued=0;
+				alGetSourcei(mSource, AL_BUFFERS_QUEUED, &queued);
+				_adaptStreamBuffers(false, queued, processed);
+			}
+		}
+
 		while(processed--)
 		{
 			ALuint buffer;
@@ -342,9 +381,27 @@ namespace OgreOggSound
 				if ( mSoundListener ) mSoundListener->soundLooping(this);
 			}
 
+			// Give up surplus buffers
+			if ( _removeStreamBuffer(buffer) ) continue;
+
 			if ( _stream(buffer) ) alSourceQueueBuffers(mSource, 1, &buffer);
 		}
 
+		// Deepen the queue whilst playing
+		while ( !mStreamEOF && mBuffers->size()<mStreamBufferTarget )
+		{
+			ALuint buffer = _addStreamBuffer();
+			if ( buffer==AL_NONE ) break;
+
+			// Nothing left to read - don't keep an unqueued buffer
+			if ( !_stream(buffer) )
+			{
+				_removeStreamBuffer(buffer, true);
+				break;
+			}
+			alSourceQueueBuffers(mSource, 1, &buffer);
+		}
+
 		// handle play position change 
 		if ( mPlayPosChanged ) 
 		{
@@ -354,21 +411,77 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	bool OgreOggStreamSound::_stream(ALuint buffer)
 	{
-		std::vector<char> audioData;
-		char* data;
-		int  section = 0;
+		OGGSOUND_PROFILE_SCOPE("OgreOggStreamSound::_stream");
+
 		int  result = 0;
 
-		// Create buffer
-		data = OGRE_ALLOC_T(char, mBufferSize, Ogre::MEMCATEGORY_GENERAL);
-		memset(data, 0, mBufferSize);
-		
+		unsigned long start = OgreOggSoundManager::getSingleton()._getStatisticsTime();
+
+		// Decode straight into the reusable upload buffer
+		char* data = _getDecodeBuffer(mBufferSize);
+
+		if ( mDecodeRing )
+		{
+			// Take what has been decoded ahead
+			result = static_cast<int>(mDecodeRing->pop_n(data, mBufferSize));
+
+			// Ring ran short, decode the rest here
+			if ( result<static_cast<int>(mBufferSize) )
+			{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+				Poco::Mutex::ScopedLock l(mDecodeMutex);
+#	else
+				boost::mutex::scoped_lock l(mDecodeMutex);
+#	endif
+#endif
+				// Anything decoded before the lock comes first
+				result += static_cast<int>(mDecodeRing->pop_n(data + result, mBufferSize - result));
+				if ( result<static_cast<int>(mBufferSize) && !mDecodeEOF )
+				{
+					bool eof = false;
+					result += _decode(data + result, static_cast<int>(mBufferSize) - result, eof);
+					if ( eof ) mDecodeEOF = true;
+				}
+				if ( mDecodeEOF && mDecodeRing->empty() ) mStreamEOF = true;
+			}
+
+			// Room for more
+			if ( OgreOggStreamDecoder* decoder = OgreOggSoundManager::getSingleton()._getStreamDecoder() ) 
+				decoder->wake(this);
+		}
+		else if ( !mStreamEOF )
+		{
+			bool eof = false;
+			result = _decode(data, static_cast<int>(mBufferSize), eof);
+			if ( eof ) mStreamEOF = true;
+		}
+
+		// EOF
+		if(result == 0)
+			return false;
+
+		alGetError();
+		// Copy buffer data
+		alBufferData(buffer, mFormat, data, static_cast<ALsizei>(result), mVorbisInfo->rate);
+
+		OgreOggSoundManager::getSingleton()._notifyStreamRefill(result, start);
+
+		return true;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	int OgreOggStreamSound::_decode(char* data, int size, bool& eof)
+	{
+		int section = 0;
+		int result = 0;
+
 		// Read only what was asked for
-		while( !mStreamEOF && (static_cast<int>(audioData.size()) < mBufferSize) )
+		while( result < size )
 		{
-			int  bytes = 0;
-			// Read up to a buffer's worth of data
-			bytes = ov_read(&mOggStream, data, static_cast<int>(mBufferSize), 0, 2, 1, &section);
+			// Read up to the remainder of the buffer
+			long bytes = mFloat ? 
+				_readFloat(mOggStream, data + result, size - result, mVorbisInfo->channels, &section) :
+				_readShort(mOggStream, data + result, size - result, mVorbisInfo->channels, &section);
 			// EOF check
 			if (bytes == 0)
 			{
@@ -383,32 +496,72 @@ namespace OgreOggSound
 				}
 				else
 				{
-					mStreamEOF=true;
+					eof=true;
 					// Don't loop - finish.
 					break;
 				}
 			}
-			// Append to end of buffer
-			audioData.insert(audioData.end(), data, data + bytes);
+			// Skip holes, give up on anything else
+			else if (bytes < 0)
+			{
+				if (bytes == OV_HOLE) continue;
+				Ogre::LogManager::getSingleton().logMessage("***--- OgreOggStream::_stream() - ERROR decoding stream!");
+				break;
+			}
 			// Keep track of read data
 			result+=bytes;
 		}
 
-		// EOF
-		if(result == 0)
-		{
-			OGRE_FREE(data, Ogre::MEMCATEGORY_GENERAL);
-			return false;
-		}
+		return result;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	bool OgreOggStreamSound::_decodeAhead()
+	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mDecodeMutex);
+#	else
+		boost::mutex::scoped_lock l(mDecodeMutex);
+#	endif
+#endif
 
-		alGetError();
-		// Copy buffer data
-		alBufferData(buffer, mFormat, &audioData[0], static_cast<ALsizei>(audioData.size()), mVorbisInfo->rate);
+		if ( !mDecodeRing || mDecodeEOF ) return false;
 
-		// Cleanup
-		OGRE_FREE(data, Ogre::MEMCATEGORY_GENERAL);
+		// Wait until there's room for a worthwhile block of whole frames
+		const size_t frameSize = mVorbisInfo->channels * _getSampleSize();
+		size_t size = std::min(mDecodeRing->capacity() - mDecodeRing->size(), static_cast<size_t>(DECODE_AHEAD_BLOCK));
+		size -= size % frameSize;
+		if ( size<DECODE_AHEAD_BLOCK / 4 ) return false;
 
-		return true;
+		// Aligned for either sample type
+		float block[DECODE_AHEAD_BLOCK / sizeof(float)];
+		bool eof = false;
+		int bytes = _decode(reinterpret_cast<char*>(block), static_cast<int>(size), eof);
+		if ( bytes>0 ) mDecodeRing->push_n(reinterpret_cast<char*>(block), bytes);
+
+		// Stop on errors too rather than retrying forever
+		if ( eof || bytes<=0 ) mDecodeEOF = true;
+
+		return bytes>0;
+	}
+	/*/////////////////////////////////////////////////////////////////*/
+	void OgreOggStreamSound::_seek(float seconds)
+	{
+#if OGGSOUND_THREADED
+#	ifdef POCO_THREAD
+		Poco::Mutex::ScopedLock l(mDecodeMutex);
+#	else
+		boost::mutex::scoped_lock l(mDecodeMutex);
+#	endif
+#endif
+
+		ov_time_seek(&mOggStream, seconds);
+
+		if ( mDecodeRing )
+		{
+			mDecodeRing->clear();
+			mDecodeEOF = false;
+		}
 	}
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggStreamSound::_dequeue()
@@ -459,7 +612,7 @@ namespace OgreOggSound
 
 		// Seek...
 		pause();
-		ov_time_seek(&mOggStream, mPlayPos);
+		_seek(mPlayPos);
 
 		// Unqueue all buffers
 		_dequeue();
@@ -477,6 +630,17 @@ namespace OgreOggSound
 		mLastOffset = mPlayPos;
 	}			   
 	/*/////////////////////////////////////////////////////////////////*/
+	float OgreOggStreamSound::_getRefillDeadline() const
+	{
+		if ( !isPlaying() || mFade || !mVorbisInfo ) 
+			return OgreOggISound::_getRefillDeadline();
+
+		// Duration of a single buffer
+		float bufferTime = static_cast<float>(mBufferSize) / (mVorbisInfo->rate * mVorbisInfo->channels * _getSampleSize());
+
+		return _getStreamingDeadline(bufferTime, mStreamEOF);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggStreamSound::setPlayPosition(float seconds)
 	{
 		if ( !mSeekable || seconds<0.f ) 
@@ -515,6 +679,8 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		if ( _pauseVirtual() ) return;
+
 		if(mSource == AL_NONE) return;
 
 		alSourcePause(mSource);
@@ -528,13 +694,23 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		// Already playing without a source
+		if ( mVirtual ) return;
+
 		if (isPlaying())
 			return;
 
 		// Grab a source if not already attached
 		if (mSource == AL_NONE)
 			if ( !OgreOggSoundManager::getSingleton()._requestSoundSource(this) )
+			{
+				// Carry on without a source if allowed
+				_playVirtual();
 				return;
+			}
+
+		// Submit pending properties before starting
+		_flushState();
 
 		alGetError();
 		// Play source
@@ -555,6 +731,8 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		if ( _stopVirtual() ) return;
+
 		if(mSource != AL_NONE)
 		{
 			// Remove audio data from source
@@ -573,7 +751,7 @@ namespace OgreOggSound
 			// Jump to beginning if seeking available
 			if ( mSeekable ) 
 			{
-				ov_time_seek(&mOggStream,0);
+				_seek(0);
 				mLastOffset=0;
 				mStreamEOF=false;
 			}
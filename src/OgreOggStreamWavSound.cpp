@@ -54,7 +54,7 @@ namespace OgreOggSound
 	, mStreamEOF(false)
 	, mLastOffset(0.f)
 	{																			   
-		mBuffers.bind(new BufferList(NUM_BUFFERS, AL_NONE));
+		mBuffers.bind(new BufferList());
 		mFormatData.mFormat=0;
 		mStream = true;	   
 	}
@@ -70,6 +70,8 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggStreamWavSound::_openImpl(Ogre::DataStreamPtr& fileStream)
 	{
+		OGGSOUND_PROFILE_SCOPE("OgreOggStreamWavSound::_openImpl");
+
 		// WAVE descriptor vars
 		ChunkHeader		c;
 
@@ -169,9 +171,7 @@ namespace OgreOggSound
 		}
 
 		// Create OpenAL buffer
-		alGetError();							   
-		alGenBuffers(NUM_BUFFERS, &(*mBuffers)[0]);
-		if ( alGetError()!=AL_NO_ERROR )
+		if ( !_resizeStreamBuffers() )
 			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "Unable to create OpenAL buffer.", "OgreOggStreamWavSound::_openImpl()");
 
 		// Check format support
@@ -183,11 +183,6 @@ namespace OgreOggSound
 		// Calculate length in seconds
 		mPlayTime = static_cast<float>(((mAudioEnd-mAudioOffset)*8.f) / static_cast<float>((mFormatData.mFormat->mSamplesPerSec * mFormatData.mFormat->mChannels * mFormatData.mFormat->mBitsPerSample)));
 
-#if HAVE_EFX
-		// Upload to XRAM buffers if available
-		if ( OgreOggSoundManager::getSingleton().hasXRamSupport() )
-			OgreOggSoundManager::getSingleton().setXRamBuffer(NUM_BUFFERS, &(*mBuffers)[0]);
-#endif
 		// Calculate loop offset in bytes
 		// Set BEFORE sound loaded
 		if ( mLoopOffset>0.f )
@@ -228,20 +223,11 @@ namespace OgreOggSound
 				{
 					// 8-bit mono
 					mFormat = AL_FORMAT_MONO8;
-
-					// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-					mBufferSize = mFormatData.mFormat->mSamplesPerSec/4;
 				}
 				else
 				{
 					// 16-bit mono
 					mFormat = AL_FORMAT_MONO16;
-
-					// Queue 250ms of audio data
-					mBufferSize = mFormatData.mFormat->mAvgBytesPerSec >> 2;
-
-					// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-					mBufferSize -= (mBufferSize % mFormatData.mFormat->mBlockAlign);
 				}
 			}
 			break;
@@ -251,23 +237,11 @@ namespace OgreOggSound
 				{
 					// 8-bit stereo
 					mFormat = AL_FORMAT_STEREO8;
-
-					// Set BufferSize to 250ms (Frequency * 2 (8bit stereo) divided by 4 (quarter of a second))
-					mBufferSize = mFormatData.mFormat->mSamplesPerSec >> 1;
-
-					// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-					mBufferSize -= (mBufferSize % 2);
 				}
 				else
 				{
 					// 16-bit stereo
 					mFormat = AL_FORMAT_STEREO16;
-
-					// Queue 250ms of audio data
-					mBufferSize = mFormatData.mFormat->mAvgBytesPerSec >> 2;
-
-					// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-					mBufferSize -= (mBufferSize % mFormatData.mFormat->mBlockAlign);
 				}
 			}
 			break;
@@ -276,12 +250,6 @@ namespace OgreOggSound
 				// 16-bit Quad surround
 				mFormat = alGetEnumValue("AL_FORMAT_QUAD16");
 				if (!mFormat) return false;
-
-				// Queue 250ms of audio data
-				mBufferSize = mFormatData.mFormat->mAvgBytesPerSec >> 2;
-
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % mFormatData.mFormat->mBlockAlign);
 			}
 			break;
 		case 6:
@@ -289,12 +257,6 @@ namespace OgreOggSound
 				// 16-bit 5.1 surround
 				mFormat = alGetEnumValue("AL_FORMAT_51CHN16");
 				if (!mFormat) return false;
-
-				// Queue 250ms of audio data
-				mBufferSize = mFormatData.mFormat->mAvgBytesPerSec >> 2;
-
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % mFormatData.mFormat->mBlockAlign);
 			}
 			break;
 		case 7:
@@ -302,12 +264,6 @@ namespace OgreOggSound
 				// 16-bit 7.1 surround
 				mFormat = alGetEnumValue("AL_FORMAT_61CHN16");
 				if (!mFormat) return false;
-
-				// Queue 250ms of audio data
-				mBufferSize = mFormatData.mFormat->mAvgBytesPerSec >> 2;
-
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % mFormatData.mFormat->mBlockAlign);
 			}
 			break;
 		case 8:
@@ -315,12 +271,6 @@ namespace OgreOggSound
 				// 16-bit 8.1 surround
 				mFormat = alGetEnumValue("AL_FORMAT_71CHN16");
 				if (!mFormat) return false;
-
-				// Queue 250ms of audio data
-				mBufferSize = mFormatData.mFormat->mAvgBytesPerSec >> 2;
-
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % mFormatData.mFormat->mBlockAlign);
 			}
 			break;
 		default:
@@ -330,15 +280,13 @@ namespace OgreOggSound
 
 				// 16-bit stereo
 				mFormat = AL_FORMAT_STEREO16;
-
-				// Queue 250ms of audio data
-				mBufferSize = mFormatData.mFormat->mAvgBytesPerSec >> 2;
-
-				// IMPORTANT : The Buffer Size must be an exact multiple of the BlockAlignment ...
-				mBufferSize -= (mBufferSize % mFormatData.mFormat->mBlockAlign);
 			}
 			break;
 		}
+
+		// Queue audio in chunks of the requested duration
+		_calculateBufferSize(mFormatData.mFormat->mAvgBytesPerSec, mFormatData.mFormat->mBlockAlign);
+
 		return true;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
@@ -349,11 +297,12 @@ namespace OgreOggSound
 			ALuint src=AL_NONE;
 			setSource(src);
 		}
-		for (int i=0; i<NUM_BUFFERS; i++)
+		for (size_t i=0; i<mBuffers->size(); i++)
 		{													
 			if ((*mBuffers)[i]!=AL_NONE)
 				alDeleteBuffers(1, &(*mBuffers)[i]);
 		}
+		mBuffers->clear();
 		mPlayPosChanged = false;
 		mPlayPos = 0.f;
 	}
@@ -362,8 +311,12 @@ namespace OgreOggSound
 	{
 		if (mSource==AL_NONE) return;
 
-		int i=0;
-		while ( i<NUM_BUFFERS )
+		// Pick up buffer count/duration changes whilst nothing is queued
+		if ( mBufferTime!=mStreamBufferTime ) _queryBufferInfo();
+		_resizeStreamBuffers();
+
+		size_t i=0;
+		while ( i<mBuffers->size() )
 		{															
 			if ( _stream((*mBuffers)[i]) )
 				alSourceQueueBuffers(mSource, 1, &(*mBuffers)[i++]);
@@ -422,6 +375,11 @@ namespace OgreOggSound
 			}
 			else
 			{
+				// Starved - record it and deepen the queue if adaptive
+				++mUnderruns;
+				OgreOggSoundManager::getSingleton()._notifyStreamUnderrun();
+				_adaptStreamBuffers(true);
+
 				// Clear audio data already played...
 				_dequeue();
 
@@ -437,6 +395,20 @@ namespace OgreOggSound
 
 		alGetSourcei(mSource, AL_BUFFERS_PROCESSED, &processed);
 
+		if ( processed>0 )
+		{
+			// Pick up buffer duration changes
+			if ( mBufferTime!=mStreamBufferTime ) _queryBufferInfo();
+
+			// Measure how early the refill is
+			if ( mAdaptiveStreamBuffers )
+			{
+				int queued=0;
+				alGetSourcei(mSource, AL_BUFFERS_QUEUED, &queued);
+				_adaptStreamBuffers(false, queued, processed);
+			}
+		}
+
 		while(processed--)
 		{
 			ALuint buffer;
@@ -463,12 +435,30 @@ namespace OgreOggSound
 				if ( mSoundListener ) mSoundListener->soundLooping(this);
 			}
 
+			// Give up surplus buffers
+			if ( _removeStreamBuffer(buffer) ) continue;
+
 			if ( _stream(buffer) ) 
 			{
 				alSourceQueueBuffers(mSource, 1, &buffer);
 			}
 		}
 
+		// Deepen the queue whilst playing
+		while ( !mStreamEOF && mBuffers->size()<mStreamBufferTarget )
+		{
+			ALuint buffer = _addStreamBuffer();
+			if ( buffer==AL_NONE ) break;
+
+			// Nothing left to read - don't keep an unqueued buffer
+			if ( !_stream(buffer) )
+			{
+				_removeStreamBuffer(buffer, true);
+				break;
+			}
+			alSourceQueueBuffers(mSource, 1, &buffer);
+		}
+
 		// Handle play position change
 		if ( mPlayPosChanged )
 		{
@@ -499,27 +489,30 @@ namespace OgreOggSound
 	/*/////////////////////////////////////////////////////////////////*/
 	bool OgreOggStreamWavSound::_stream(ALuint buffer)
 	{
-		std::vector<char> audioData;
-		char* data;
+		OGGSOUND_PROFILE_SCOPE("OgreOggStreamWavSound::_stream");
+
 		int  bytes = 0;
 		int  result = 0;
 
-		// Create buffer
-		data = OGRE_ALLOC_T(char, mBufferSize, Ogre::MEMCATEGORY_GENERAL);
-		memset(data, 0, mBufferSize);
+		unsigned long start = OgreOggSoundManager::getSingleton()._getStatisticsTime();
+
+		// Read straight into the reusable upload buffer
+		char* data = _getDecodeBuffer(mBufferSize);
 		
 		// Read only what was asked for
-		while( !mStreamEOF && (static_cast<int>(audioData.size()) < mBufferSize) )
+		while( !mStreamEOF && (result < static_cast<int>(mBufferSize)) )
 		{
+			size_t wanted = mBufferSize - result;
 			size_t currPos = mAudioStream->tell();
 			// Is looping about to occur?
-			if ( (currPos+mBufferSize) > mAudioEnd )
+			if ( (currPos+wanted) > mAudioEnd )
 			{
 				// Calculate remaining data size
 				size_t remaining = mAudioEnd-currPos;
-				// Read up to a buffer's worth of data
+				// Read up to the end of the audio data
+				bytes = 0;
 				if ( remaining )
-					bytes = static_cast<int>(mAudioStream->read(data, remaining));
+					bytes = static_cast<int>(mAudioStream->read(data + result, remaining));
 				// If set to loop wrap to start of stream
 				if ( mLoop )
 				{
@@ -531,15 +524,13 @@ namespace OgreOggSound
 					// EOF - finish.
 					if (bytes==0) break;
 				}
-				// Append to end of buffer
-				audioData.insert(audioData.end(), data, data + bytes);
 				// Keep track of read data
 				result+=bytes;
 			}
 			else
 			{
-				// Read up to a buffer's worth of data
-				bytes = static_cast<int>(mAudioStream->read(data, mBufferSize));
+				// Read up to the remainder of the buffer
+				bytes = static_cast<int>(mAudioStream->read(data + result, wanted));
 				// EOF check
 				if (mAudioStream->eof())
 				{
@@ -567,8 +558,6 @@ namespace OgreOggSound
 						if (bytes==0) break;
 					}
 				}
-				// Append to end of buffer
-				audioData.insert(audioData.end(), data, data + bytes);
 				// Keep track of read data
 				result+=bytes;
 			}
@@ -576,17 +565,13 @@ namespace OgreOggSound
 
 		// EOF
 		if(result == 0)
-		{
-			OGRE_FREE(data, Ogre::MEMCATEGORY_GENERAL);
 			return false;
-		}
 
 		alGetError();
 		// Copy buffer data
-		alBufferData(buffer, mFormat, &audioData[0], static_cast<ALsizei>(audioData.size()), mFormatData.mFormat->mSamplesPerSec);
+		alBufferData(buffer, mFormat, data, static_cast<ALsizei>(result), mFormatData.mFormat->mSamplesPerSec);
 
-		// Cleanup
-		OGRE_FREE(data, Ogre::MEMCATEGORY_GENERAL);
+		OgreOggSoundManager::getSingleton()._notifyStreamRefill(result, start);
 
 		return true;
 	}
@@ -637,6 +622,8 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		if ( _pauseVirtual() ) return;
+
 		if(mSource == AL_NONE) return;
 
 		alSourcePause(mSource);
@@ -650,12 +637,22 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		// Already playing without a source
+		if ( mVirtual ) return;
+
 		if(isPlaying())	return;
 
 		// Grab a source if not already attached
 		if (mSource == AL_NONE)
 			if ( !OgreOggSoundManager::getSingleton()._requestSoundSource(this) )
+			{
+				// Carry on without a source if allowed
+				_playVirtual();
 				return;
+			}
+
+		// Submit pending properties before starting
+		_flushState();
 
 		// Play source
 		alGetError();
@@ -701,6 +698,17 @@ namespace OgreOggSound
 			return mLastOffset+time;
 	}
 	/*/////////////////////////////////////////////////////////////////*/
+	float OgreOggStreamWavSound::_getRefillDeadline() const
+	{
+		if ( !isPlaying() || mFade || !mFormatData.mFormat ) 
+			return OgreOggISound::_getRefillDeadline();
+
+		// Duration of a single buffer
+		float bufferTime = static_cast<float>(mBufferSize) / mFormatData.mFormat->mAvgBytesPerSec;
+
+		return _getStreamingDeadline(bufferTime, mStreamEOF);
+	}
+	/*/////////////////////////////////////////////////////////////////*/
 	void OgreOggStreamWavSound::_updatePlayPosition()
 	{
 		if ( mSource==AL_NONE ) 
@@ -713,8 +721,9 @@ namespace OgreOggSound
 		// Stop playback
 		pause();
 
-		// mBufferSize is 1/4 of a second
-		size_t dataOffset = static_cast<size_t>(mPlayPos * mBufferSize * 4);
+		// Byte offset aligned to a sample frame
+		size_t dataOffset = static_cast<size_t>(mPlayPos * mFormatData.mFormat->mAvgBytesPerSec);
+		dataOffset -= (dataOffset % mFormatData.mFormat->mBlockAlign);
 		mAudioStream->seek(mAudioOffset + dataOffset);
 
 		// Unqueue audio
@@ -737,6 +746,8 @@ namespace OgreOggSound
 	{
 		assert(mState != SS_DESTROYED);
 
+		if ( _stopVirtual() ) return;
+
 		if(mSource != AL_NONE)
 		{
 			// Remove audio data from source